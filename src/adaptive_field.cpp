@@ -0,0 +1,99 @@
+//adaptive_field.cpp
+
+#include "adaptive_field.h"
+#include "palette.h"
+#include <algorithm>
+
+static size_t latticeSlot(uint64_t key, size_t mask){
+    return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 17) & mask;
+}
+
+void AdaptiveField::growLattice(){
+    std::vector<uint64_t> keys(std::max<size_t>(1024, latticeKeys.size() * 2), 0);
+    std::vector<uint32_t> offsets(keys.size());
+    const size_t mask = keys.size() - 1;
+    for(size_t k=0;k<latticeKeys.size();++k){
+        if(!latticeKeys[k]) continue;
+        size_t s = latticeSlot(latticeKeys[k], mask);
+        while(keys[s]) s = (s + 1) & mask;
+        keys[s] = latticeKeys[k];
+        offsets[s] = latticeOffsets[k];
+    }
+    latticeKeys.swap(keys);
+    latticeOffsets.swap(offsets);
+}
+
+uint32_t AdaptiveField::point(const ProbFn& probs, int i, int j){
+    uint64_t key = (uint64_t)i * (uint64_t)(finest + 1) + (uint64_t)j + 1;
+    const size_t mask = latticeKeys.size() - 1;
+    size_t s = latticeSlot(key, mask);
+    for(; latticeKeys[s]; s = (s + 1) & mask)
+        if(latticeKeys[s] == key) return latticeOffsets[s];
+    uint32_t off = (uint32_t)values.size();
+    values.resize(values.size() + numClasses);
+    probs(ox + i * sx, oy + j * sy, &values[off]);
+    ++evaluations;
+    latticeKeys[s] = key;
+    latticeOffsets[s] = off;
+    // stay at most half full so probe runs stay short
+    if(++latticeCount * 2 > latticeKeys.size()) growLattice();
+    return off;
+}
+
+void AdaptiveField::refine(const ProbFn& probs, int i, int j, int size, std::vector<Vertex>& triangles){
+    uint32_t corner[4] = {
+        point(probs, i, j), point(probs, i + size, j),
+        point(probs, i + size, j + size), point(probs, i, j + size)
+    };
+    if(size > 1){
+        // sample the corners and the center; split on a class change or a steep probability change
+        uint32_t samples[5] = { corner[0], corner[1], corner[2], corner[3], point(probs, i + size/2, j + size/2) };
+        int firstClass = -1;
+        bool split = false;
+        float lo = 1.0f, hi = 0.0f;
+        for(uint32_t off : samples){
+            const float* p = &values[off];
+            int best = (int)(std::max_element(p, p + numClasses) - p);
+            if(firstClass < 0) firstClass = best;
+            else if(best != firstClass) split = true;
+            lo = std::min(lo, p[best]); hi = std::max(hi, p[best]);
+        }
+        if(split || hi - lo > probTolerance){
+            int h = size / 2;
+            refine(probs, i,     j,     h, triangles);
+            refine(probs, i + h, j,     h, triangles);
+            refine(probs, i + h, j + h, h, triangles);
+            refine(probs, i,     j + h, h, triangles);
+            return;
+        }
+    }
+
+    // leaf: one quad (two triangles) with per-corner colors
+    Vertex v[4];
+    const int ci[4] = { i, i + size, i + size, i };
+    const int cj[4] = { j, j, j + size, j + size };
+    for(int k=0;k<4;++k){
+        v[k].x = ox + ci[k] * sx;
+        v[k].y = oy + cj[k] * sy;
+        blendClassColors(&values[corner[k]], numClasses, v[k].r, v[k].g, v[k].b);
+    }
+    triangles.push_back(v[0]); triangles.push_back(v[1]); triangles.push_back(v[2]);
+    triangles.push_back(v[0]); triangles.push_back(v[2]); triangles.push_back(v[3]);
+    ++cells;
+}
+
+void AdaptiveField::build(const ProbFn& probs, float x0, float y0, float x1, float y1, std::vector<Vertex>& triangles){
+    triangles.clear();
+    evaluations = 0; cells = 0;
+    if(latticeKeys.empty()) growLattice();
+    else std::fill(latticeKeys.begin(), latticeKeys.end(), 0);
+    latticeCount = 0;
+    values.clear();
+    finest = baseDim << maxDepth;
+    ox = x0; oy = y0;
+    sx = (x1 - x0) / finest; sy = (y1 - y0) / finest;
+    const int cell = 1 << maxDepth;
+    for(int bj=0;bj<baseDim;++bj)
+        for(int bi=0;bi<baseDim;++bi)
+            refine(probs, bi * cell, bj * cell, cell, triangles);
+}
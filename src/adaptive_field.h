@@ -0,0 +1,47 @@
+//adaptive_field.h
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "renderer.h"
+
+// Adaptive evaluation of the class-probability field over a view rectangle.
+// Starts from a coarse baseDim x baseDim grid and subdivides a cell (quadtree)
+// only where the predicted class or the max probability changes across it,
+// down to maxDepth levels. Corner evaluations are shared between neighbouring
+// cells through a lattice cache, so flat regions cost a handful of evaluations.
+struct AdaptiveField{
+    // writes numClasses probabilities for point (x, y); works for any model
+    using ProbFn = std::function<void(float x, float y, float* probs)>;
+
+    int numClasses = 3;
+    int baseDim = 8;
+    int maxDepth = 5;
+    float probTolerance = 0.15f;   // max-probability spread that forces a split
+
+    size_t evaluations = 0;        // model evaluations in the last build
+    size_t cells = 0;              // leaf cells emitted in the last build
+
+    // rebuild the field and write two triangles per leaf cell into triangles
+    void build(const ProbFn& probs, float x0, float y0, float x1, float y1, std::vector<Vertex>& triangles);
+
+    // evaluations a uniform grid with the same finest resolution would need
+    size_t uniformEquivalent() const { size_t n = ((size_t)baseDim << maxDepth) + 1; return n * n; }
+
+private:
+    int finest = 0;
+    float ox = 0.0f, oy = 0.0f, sx = 0.0f, sy = 0.0f;
+    // lattice point -> offset into values: open addressing on key+1 (0 = empty slot),
+    // kept across builds so a steady frame doesn't allocate
+    std::vector<uint64_t> latticeKeys;
+    std::vector<uint32_t> latticeOffsets;
+    size_t latticeCount = 0;
+    std::vector<float> values;                      // numClasses probabilities per cached point
+
+    void growLattice();
+
+    uint32_t point(const ProbFn& probs, int i, int j); // cached evaluation, returns offset into values
+    void refine(const ProbFn& probs, int i, int j, int size, std::vector<Vertex>& triangles);
+};
@@ -0,0 +1,35 @@
+//alloc_counter.cpp
+// Counting replacements of the global allocation functions for the profiler's
+// per-frame allocation stats. Built into the app only: ml_train and ml_bench
+// keep the default allocator, so their timings carry no counting overhead.
+
+#include "profiler.h"
+#include <cstdlib>
+#include <new>
+
+#ifndef ML_VIS_NO_PROFILER
+static void* countedAlloc(size_t bytes){
+    profilerCountAlloc(bytes);
+    for(;;){
+        if(void* p = malloc(bytes ? bytes : 1)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if(!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new(size_t bytes){ return countedAlloc(bytes); }
+void* operator new[](size_t bytes){ return countedAlloc(bytes); }
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept{
+    try{ return countedAlloc(bytes); } catch(...){ return nullptr; }
+}
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept{
+    try{ return countedAlloc(bytes); } catch(...){ return nullptr; }
+}
+void operator delete(void* p) noexcept{ free(p); }
+void operator delete[](void* p) noexcept{ free(p); }
+void operator delete(void* p, size_t) noexcept{ free(p); }
+void operator delete[](void* p, size_t) noexcept{ free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept{ free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept{ free(p); }
+#endif
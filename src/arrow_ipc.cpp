@@ -0,0 +1,413 @@
+//arrow_ipc.cpp
+
+#include "arrow_ipc.h"
+#include <cstring>
+#include <iostream>
+
+// Field slots of the Arrow metadata tables (format/Schema.fbs, Message.fbs,
+// File.fbs); a union takes two slots, its type tag and the table.
+enum{ FOOTER_SCHEMA = 1, FOOTER_DICTIONARIES = 2, FOOTER_RECORD_BATCHES = 3 };
+enum{ SCHEMA_ENDIANNESS = 0, SCHEMA_FIELDS = 1 };
+enum{ FIELD_NAME = 0, FIELD_NULLABLE = 1, FIELD_TYPE_TYPE = 2, FIELD_TYPE = 3, FIELD_DICTIONARY = 4, FIELD_CHILDREN = 5 };
+enum{ MESSAGE_VERSION = 0, MESSAGE_HEADER_TYPE = 1, MESSAGE_HEADER = 2 };
+enum{ BATCH_LENGTH = 0, BATCH_NODES = 1, BATCH_BUFFERS = 2, BATCH_COMPRESSION = 3 };
+enum{ DICTBATCH_ID = 0, DICTBATCH_DATA = 1, DICTBATCH_DELTA = 2 };
+enum{ DICTENC_ID = 0, DICTENC_INDEX_TYPE = 1 };
+
+// MessageHeader and Type union tags
+enum{ HEADER_DICTIONARY_BATCH = 2, HEADER_RECORD_BATCH = 3 };
+enum{
+    TYPE_NULL = 1, TYPE_INT, TYPE_FLOAT, TYPE_BINARY, TYPE_UTF8, TYPE_BOOL, TYPE_DECIMAL, TYPE_DATE, TYPE_TIME,
+    TYPE_TIMESTAMP, TYPE_INTERVAL, TYPE_LIST, TYPE_STRUCT, TYPE_UNION, TYPE_FIXED_SIZE_BINARY, TYPE_FIXED_SIZE_LIST,
+    TYPE_MAP, TYPE_DURATION, TYPE_LARGE_BINARY, TYPE_LARGE_UTF8, TYPE_LARGE_LIST, TYPE_RUN_END_ENCODED,
+    TYPE_BINARY_VIEW, TYPE_UTF8_VIEW, TYPE_LIST_VIEW, TYPE_LARGE_LIST_VIEW
+};
+
+template<class T>
+static T loadAs(const uint8_t* p){
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+// Read-only access to one FlatBuffers table with every offset checked against
+// the buffer; a missing or broken table is invalid and its fields read as the
+// defaults.
+class FbTable{
+public:
+    static FbTable root(const uint8_t* buf, size_t size){
+        return size < 4 ? FbTable() : at(buf, size, loadAs<uint32_t>(buf));
+    }
+    bool valid() const { return buf != nullptr; }
+
+    template<class T>
+    T scalar(int field, T def) const {
+        size_t p = fieldPos(field, sizeof(T));
+        return p ? loadAs<T>(buf + p) : def;
+    }
+    FbTable table(int field) const {
+        size_t t = target(field);
+        return t ? at(buf, size, t) : FbTable();
+    }
+    // count elements of elemSize bytes from start; false when missing or out of bounds
+    bool vector(int field, size_t elemSize, size_t& start, size_t& count) const {
+        size_t t = target(field);
+        if(!t) return false;
+        uint64_t n = loadAs<uint32_t>(buf + t);
+        start = t + 4;
+        if(n * elemSize > size - start) return false;
+        count = (size_t)n;
+        return true;
+    }
+    // element k of a vector of tables (checked by vector() with elemSize 4)
+    FbTable element(size_t start, size_t k) const {
+        size_t p = start + 4 * k;
+        return at(buf, size, (uint64_t)p + loadAs<uint32_t>(buf + p));
+    }
+    std::string string(int field) const {
+        size_t start, n;
+        return vector(field, 1, start, n) ? std::string((const char*)buf + start, n) : std::string();
+    }
+    const uint8_t* data(size_t pos) const { return buf + pos; }
+
+private:
+    const uint8_t* buf = nullptr;
+    size_t size = 0, pos = 0, vt = 0;
+    uint16_t vtSize = 0, tableSize = 0;
+
+    static FbTable at(const uint8_t* buf, size_t size, uint64_t pos){
+        FbTable t;
+        if(pos + 4 > size) return t;
+        int64_t vt = (int64_t)pos - loadAs<int32_t>(buf + pos);
+        if(vt < 0 || (uint64_t)vt + 4 > size) return t;
+        uint16_t vtSize = loadAs<uint16_t>(buf + vt), tableSize = loadAs<uint16_t>(buf + vt + 2);
+        if(vtSize < 4 || (uint64_t)vt + vtSize > size || tableSize < 4 || pos + tableSize > size) return t;
+        t.buf = buf; t.size = size; t.pos = (size_t)pos; t.vt = (size_t)vt;
+        t.vtSize = vtSize; t.tableSize = tableSize;
+        return t;
+    }
+    // absolute position of a field of the given size, 0 when absent
+    size_t fieldPos(int field, size_t bytes) const {
+        if(!buf) return 0;
+        size_t slot = 4 + 2 * (size_t)field;
+        if(slot + 2 > vtSize) return 0;
+        uint16_t off = loadAs<uint16_t>(buf + vt + slot);
+        if(off == 0 || off + bytes > tableSize) return 0;
+        return pos + off;
+    }
+    // where an offset field points, 0 when absent or out of bounds
+    size_t target(int field) const {
+        size_t p = fieldPos(field, 4);
+        if(!p) return 0;
+        uint64_t t = (uint64_t)p + loadAs<uint32_t>(buf + p);
+        return t + 4 <= size ? (size_t)t : 0;
+    }
+};
+
+static int intColumn(const FbTable& intType){
+    int bits = intType.scalar<int32_t>(0, 32);
+    bool isSigned = intType.scalar<uint8_t>(1, 0) != 0;
+    switch(bits){
+        case 8: return isSigned ? COLUMN_I8 : COLUMN_U8;
+        case 16: return isSigned ? COLUMN_I16 : COLUMN_U16;
+        case 32: return isSigned ? COLUMN_I32 : COLUMN_U32;
+        case 64: return isSigned ? COLUMN_I64 : COLUMN_U64;
+        default: return COLUMN_NONE;
+    }
+}
+
+// how a value of the field's type can be read, COLUMN_NONE when it can't
+static int valueColumn(const FbTable& field){
+    FbTable type = field.table(FIELD_TYPE);
+    switch(field.scalar<uint8_t>(FIELD_TYPE_TYPE, 0)){
+        case TYPE_INT: return intColumn(type);
+        case TYPE_FLOAT:{
+            int16_t precision = type.scalar<int16_t>(0, 0);   // HALF, SINGLE, DOUBLE
+            return precision == 1 ? COLUMN_F32 : precision == 2 ? COLUMN_F64 : COLUMN_NONE;
+        }
+        case TYPE_UTF8: case TYPE_BINARY: return COLUMN_UTF8;
+        case TYPE_LARGE_UTF8: case TYPE_LARGE_BINARY: return COLUMN_LARGE_UTF8;
+        default: return COLUMN_NONE;
+    }
+}
+
+// FieldNodes and Buffers the field and its children take in a record batch,
+// so that the columns after it can be found
+static bool countLayout(const FbTable& field, size_t& nodes, size_t& buffers, int depth, std::string& err){
+    if(!field.valid() || depth > 64){ err = "malformed schema field"; return false; }
+    ++nodes;
+    if(field.table(FIELD_DICTIONARY).valid()){ buffers += 2; return true; }   // the values are in dictionary batches
+    int typeId = field.scalar<uint8_t>(FIELD_TYPE_TYPE, 0);
+    switch(typeId){
+        case TYPE_NULL: case TYPE_RUN_END_ENCODED: break;
+        case TYPE_STRUCT: case TYPE_FIXED_SIZE_LIST: buffers += 1; break;
+        case TYPE_UNION: buffers += field.table(FIELD_TYPE).scalar<int16_t>(0, 0) == 1 ? 2 : 1; break;   // dense: type ids + offsets
+        case TYPE_BINARY: case TYPE_UTF8: case TYPE_LARGE_BINARY: case TYPE_LARGE_UTF8:
+        case TYPE_LIST_VIEW: case TYPE_LARGE_LIST_VIEW: buffers += 3; break;
+        case TYPE_BINARY_VIEW: case TYPE_UTF8_VIEW:
+            err = "column '" + field.string(FIELD_NAME) + "' is a view type (variadic buffers), which is not supported";
+            return false;
+        default:
+            if(typeId < TYPE_NULL || typeId > TYPE_LARGE_LIST_VIEW){ err = "unknown column type " + std::to_string(typeId); return false; }
+            buffers += 2;   // validity + values or offsets
+    }
+    size_t start, count;
+    if(field.vector(FIELD_CHILDREN, 4, start, count))
+        for(size_t k=0;k<count;++k) if(!countLayout(field.element(start, k), nodes, buffers, depth + 1, err)) return false;
+    return true;
+}
+
+bool ArrowFile::fail(const std::string& message){
+    err = message;
+    close();
+    return false;
+}
+
+void ArrowFile::close(){
+    map.close();
+    schema.clear();
+    batches.clear();
+    dictionaries.clear();
+    haveDictionary.clear();
+    nodesPerBatch = buffersPerBatch = 0;
+}
+
+// An encapsulated message at a footer Block: its header table of the expected
+// type and its body. Validates everything against the file size.
+static bool readMessage(const uint8_t* file, size_t fileSize, const uint8_t* block, int expectType,
+                        FbTable& header, const uint8_t*& body, uint64_t& bodyLength, std::string& err){
+    int64_t offset = loadAs<int64_t>(block);
+    int64_t metaLength = loadAs<int32_t>(block + 8);
+    int64_t length = loadAs<int64_t>(block + 16);
+    if(offset < 8 || metaLength < 8 || length < 0 || (uint64_t)offset > fileSize || (uint64_t)metaLength > fileSize - offset
+       || (uint64_t)length > fileSize - offset - metaLength){ err = "message block outside the file"; return false; }
+    const uint8_t* p = file + offset;
+    uint32_t first = loadAs<uint32_t>(p);
+    size_t skip = 4;
+    int64_t fbLength = first;
+    if(first == 0xFFFFFFFFu){ fbLength = loadAs<int32_t>(p + 4); skip = 8; }   // continuation marker (format >= 0.15)
+    if(fbLength <= 0 || (uint64_t)fbLength > (uint64_t)metaLength - skip){ err = "bad message metadata length"; return false; }
+    FbTable msg = FbTable::root(p + skip, (size_t)fbLength);
+    if(!msg.valid()){ err = "malformed message metadata"; return false; }
+    if(msg.scalar<int16_t>(MESSAGE_VERSION, 0) < 3){ err = "metadata versions before V4 are not supported"; return false; }
+    if(msg.scalar<uint8_t>(MESSAGE_HEADER_TYPE, 0) != expectType){ err = "unexpected message type in footer block"; return false; }
+    header = msg.table(MESSAGE_HEADER);
+    if(!header.valid()){ err = "message without header"; return false; }
+    body = p + metaLength;
+    bodyLength = (uint64_t)length;
+    return true;
+}
+
+bool ArrowFile::open(const char* path){
+    close();
+    err.clear();
+    if(!map.open(path)) return fail(std::string("cannot open ") + path);
+    const uint8_t* d = map.data();
+    const size_t n = map.size();
+    if(n >= 4 && memcmp(d, "FEA1", 4) == 0) return fail("Feather v1 files are not supported (write Feather v2, i.e. Arrow IPC)");
+    if(n < 18 || memcmp(d, "ARROW1", 6) != 0 || memcmp(d + n - 6, "ARROW1", 6) != 0)
+        return fail("not an Arrow IPC file (the stream format has no footer and is not supported)");
+    int64_t footerLength = loadAs<int32_t>(d + n - 10);
+    if(footerLength <= 0 || (uint64_t)footerLength > n - 18) return fail("bad footer length");
+    FbTable footer = FbTable::root(d + n - 10 - footerLength, (size_t)footerLength);
+    FbTable sch = footer.table(FOOTER_SCHEMA);
+    if(!sch.valid()) return fail("footer has no schema");
+    if(sch.scalar<int16_t>(SCHEMA_ENDIANNESS, 0) != 0) return fail("big-endian Arrow files are not supported");
+
+    size_t start, count;
+    if(!sch.vector(SCHEMA_FIELDS, 4, start, count)) return fail("schema has no fields");
+    for(size_t k=0;k<count;++k){
+        FbTable f = sch.element(start, k);
+        ArrowField field;
+        field.node = nodesPerBatch;
+        field.buffer = buffersPerBatch;
+        if(!countLayout(f, nodesPerBatch, buffersPerBatch, 0, err)) return fail(err);
+        field.name = f.string(FIELD_NAME);
+        field.typeId = f.scalar<uint8_t>(FIELD_TYPE_TYPE, 0);
+        field.nullable = f.scalar<uint8_t>(FIELD_NULLABLE, 0) != 0;
+        FbTable enc = f.table(FIELD_DICTIONARY);
+        field.dictionary = enc.valid();
+        if(field.dictionary){
+            field.dictionaryId = enc.scalar<int64_t>(DICTENC_ID, 0);
+            FbTable index = enc.table(DICTENC_INDEX_TYPE);
+            field.column = index.valid() ? intColumn(index) : COLUMN_I32;
+            field.values = valueColumn(f);
+        } else {
+            field.column = valueColumn(f);
+        }
+        schema.push_back(field);
+    }
+    dictionaries.assign(schema.size(), std::vector<std::string>());
+    haveDictionary.assign(schema.size(), false);
+
+    // dictionary batches: one column of the values, referenced by the field's dictionary id
+    size_t blockSize = 24;  // Block: offset int64, metaDataLength int32 (+4 padding), bodyLength int64
+    if(footer.vector(FOOTER_DICTIONARIES, blockSize, start, count)){
+        for(size_t k=0;k<count;++k){
+            FbTable header;
+            const uint8_t* body;
+            uint64_t bodyLength;
+            if(!readMessage(d, n, footer.data(start + k * blockSize), HEADER_DICTIONARY_BATCH, header, body, bodyLength, err)) return fail(err);
+            int64_t id = header.scalar<int64_t>(DICTBATCH_ID, 0);
+            int f = -1;
+            for(size_t i=0;i<schema.size() && f<0;++i) if(schema[i].dictionary && schema[i].dictionaryId == id) f = (int)i;
+            if(f < 0) continue;     // belongs to a nested field
+            // only string and integer values can name classes; other dictionaries stay unread
+            int valueType = schema[f].values;
+            if(valueType != COLUMN_UTF8 && valueType != COLUMN_LARGE_UTF8 && !(valueType >= COLUMN_I8 && valueType <= COLUMN_U64)) continue;
+            Batch values;
+            if(!parseBatch(header.table(DICTBATCH_DATA), body, bodyLength, values)) return false;
+            ColumnView view;
+            uint64_t length;
+            if(values.numNodes < 1 || !arrayView(values, 0, 0, valueType, view, length)) return fail("malformed dictionary batch: " + err);
+            bool delta = header.scalar<uint8_t>(DICTBATCH_DELTA, 0) != 0;
+            if(haveDictionary[f] && !delta) return fail("dictionary replacement is not allowed in an Arrow file");
+            std::vector<std::string> &names = dictionaries[f];
+            for(uint64_t i=0;i<length;++i){
+                if(!view.valid(i)){ names.emplace_back(); continue; }
+                if(view.isString()){
+                    size_t len;
+                    const char* name = columnString(view, i, len);
+                    names.emplace_back(name, len);
+                } else {
+                    names.push_back(std::to_string(columnInteger(view, i)));
+                }
+            }
+            haveDictionary[f] = true;
+        }
+    }
+
+    if(!footer.vector(FOOTER_RECORD_BATCHES, blockSize, start, count)) return fail("footer has no record batches");
+    for(size_t k=0;k<count;++k){
+        FbTable header;
+        const uint8_t* body;
+        uint64_t bodyLength;
+        if(!readMessage(d, n, footer.data(start + k * blockSize), HEADER_RECORD_BATCH, header, body, bodyLength, err)) return fail(err);
+        Batch b;
+        if(!parseBatch(header, body, bodyLength, b)) return false;
+        if(b.numNodes != nodesPerBatch || b.numBuffers != buffersPerBatch) return fail("record batch layout doesn't match the schema");
+        batches.push_back(b);
+    }
+    return true;
+}
+
+bool ArrowFile::parseBatch(const FbTable& header, const uint8_t* body, uint64_t bodyLength, Batch& out){
+    if(!header.valid()) return fail("malformed record batch");
+    if(header.table(BATCH_COMPRESSION).valid()) return fail("compressed record batches are not supported");
+    int64_t rows = header.scalar<int64_t>(BATCH_LENGTH, 0);
+    size_t nodeStart, nodeCount, bufferStart, bufferCount;
+    if(rows < 0 || !header.vector(BATCH_NODES, 16, nodeStart, nodeCount) || !header.vector(BATCH_BUFFERS, 16, bufferStart, bufferCount))
+        return fail("malformed record batch");
+    out.rows = (uint64_t)rows;
+    out.body = body;
+    out.bodyLength = bodyLength;
+    out.nodes = header.data(nodeStart);
+    out.buffers = header.data(bufferStart);
+    out.numNodes = nodeCount;
+    out.numBuffers = bufferCount;
+    for(size_t k=0;k<bufferCount;++k){
+        int64_t offset = loadAs<int64_t>(out.buffers + 16 * k), length = loadAs<int64_t>(out.buffers + 16 * k + 8);
+        if(offset < 0 || length < 0 || (uint64_t)offset > bodyLength || (uint64_t)length > bodyLength - offset)
+            return fail("record batch buffer outside its message body");
+    }
+    return true;
+}
+
+bool ArrowFile::arrayView(const Batch& b, size_t node, size_t buffer, int type, ColumnView& out, uint64_t& length){
+    const size_t width = columnTypeSize(type);
+    const bool strings = type == COLUMN_UTF8 || type == COLUMN_LARGE_UTF8;
+    if(node >= b.numNodes || buffer + (strings ? 3 : 2) > b.numBuffers){ err = "missing buffers"; return false; }
+    int64_t len = loadAs<int64_t>(b.nodes + 16 * node), nulls = loadAs<int64_t>(b.nodes + 16 * node + 8);
+    if(len < 0 || (uint64_t)len > b.bodyLength * 8 + 8){ err = "bad array length"; return false; }
+    length = (uint64_t)len;
+    auto bufferAt = [&](size_t k, uint64_t& bytes){
+        bytes = (uint64_t)loadAs<int64_t>(b.buffers + 16 * k + 8);
+        return b.body + loadAs<int64_t>(b.buffers + 16 * k);
+    };
+    out = ColumnView();
+    out.type = type;
+    uint64_t bytes;
+    const uint8_t* validity = bufferAt(buffer, bytes);
+    if(nulls > 0){
+        if(bytes < (length + 7) / 8){ err = "validity bitmap too short"; return false; }
+        out.validity = validity;
+    }
+    if(strings){
+        uint64_t offsetWidth = type == COLUMN_UTF8 ? 4 : 8;
+        out.offsets = bufferAt(buffer + 1, bytes);
+        if(bytes < (length + 1) * offsetWidth && length > 0){ err = "string offsets too short"; return false; }
+        out.values = bufferAt(buffer + 2, out.bytes);
+    } else {
+        out.values = bufferAt(buffer + 1, bytes);
+        out.stride = width;
+        if(width == 0 || bytes < length * width){ err = "value buffer too short"; return false; }
+    }
+    return true;
+}
+
+bool ArrowFile::column(size_t batch, int field, ColumnView& out){
+    const ArrowField &f = schema[field];
+    if(f.column == COLUMN_NONE){ err = "column '" + f.name + "' has a type that can't be read"; return false; }
+    uint64_t length;
+    if(!arrayView(batches[batch], f.node, f.buffer, f.column, out, length)){ err = "column '" + f.name + "': " + err; return false; }
+    if(length != batches[batch].rows){ err = "column '" + f.name + "' is not as long as its record batch"; return false; }
+    return true;
+}
+
+int ArrowFile::findField(const std::string& name) const{
+    for(size_t i=0;i<schema.size();++i) if(schema[i].name == name) return (int)i;
+    return -1;
+}
+
+uint64_t ArrowFile::numRows() const{
+    uint64_t n = 0;
+    for(const Batch &b : batches) n += b.rows;
+    return n;
+}
+
+const std::vector<std::string>* ArrowFile::dictionary(int field) const{
+    return haveDictionary[field] ? &dictionaries[field] : nullptr;
+}
+
+std::vector<point2D> loadArrowDataset(const char* filename, LabelDictionary* labels, FeatureScaling* scaling,
+                                      const CsvSchema& schema, LoadProgress* progress){
+    ArrowFile file;
+    if(!file.open(filename)){
+        std::cerr << "Failed to read Arrow file " << filename << ": " << file.error() << "\n";
+        return std::vector<point2D>();
+    }
+    // columns by field name or index, like the header of a CSV
+    const CsvColumn* want[3] = { &schema.x, &schema.y, &schema.label };
+    int cols[3];
+    for(int k=0;k<3;++k){
+        cols[k] = want[k]->name.empty() ? want[k]->index : file.findField(want[k]->name);
+        if(!want[k]->name.empty() && cols[k] < 0){
+            std::cerr << "Arrow file has no column named '" << want[k]->name << "'\n";
+            return std::vector<point2D>();
+        }
+        if(cols[k] >= (int)file.fields().size() || (k < 2 && cols[k] < 0)){
+            std::cerr << "Arrow file has no column " << cols[k] << " (" << file.fields().size() << " columns)\n";
+            return std::vector<point2D>();
+        }
+    }
+    ColumnSource source;
+    for(int k=0;k<2;++k) source.featureNames[k] = file.fields()[cols[k]].name;
+    if(cols[2] >= 0) source.labelColumn = "field " + file.fields()[cols[2]].name;
+    if(cols[2] >= 0 && file.fields()[cols[2]].dictionary){
+        source.labelNames = file.dictionary(cols[2]);
+        if(!source.labelNames){
+            std::cerr << "The dictionary of column '" << file.fields()[cols[2]].name << "' is missing or not strings or integers\n";
+            return std::vector<point2D>();
+        }
+    }
+    for(size_t b=0;b<file.numBatches();++b){
+        ColumnChunk chunk;
+        chunk.rows = file.batchRows(b);
+        if(!file.column(b, cols[0], chunk.x) || !file.column(b, cols[1], chunk.y) || (cols[2] >= 0 && !file.column(b, cols[2], chunk.label))){
+            std::cerr << "Failed to read Arrow file " << filename << ": " << file.error() << "\n";
+            return std::vector<point2D>();
+        }
+        source.chunks.push_back(chunk);
+    }
+    return loadColumns(source, filename, labels, scaling, progress);
+}
@@ -0,0 +1,75 @@
+//arrow_ipc.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "column_source.h"
+#include "mapped_file.h"
+
+class FbTable;
+
+// Reader for the Arrow IPC file format (also Feather v2, .arrow/.feather/.ipc),
+// without the Arrow library. open() maps the file and validates the magic, the
+// footer and every record batch's metadata against the file size; the column
+// data is never copied: column() returns views into the mapping, which stay
+// valid until the file is closed. Only the FlatBuffers metadata is parsed, by a
+// small bounds-checked reader. Little-endian files without buffer compression;
+// top-level columns of any type can be skipped, and float32/float64, integer,
+// utf8 and dictionary-encoded (utf8 or integer values) columns can be read.
+struct ArrowField{
+    std::string name;
+    int typeId = 0;             // the Arrow Type union tag (Int = 2, FloatingPoint = 3, Utf8 = 5, ...)
+    int column = COLUMN_NONE;   // readable as this ColumnType (for dictionary fields: the index type)
+    int values = COLUMN_NONE;   // dictionary fields: the ColumnType of the dictionary values
+    bool nullable = false;
+    bool dictionary = false;
+    int64_t dictionaryId = -1;
+    size_t node = 0, buffer = 0;  // first FieldNode and Buffer of the field in a record batch
+};
+
+class ArrowFile{
+public:
+    bool open(const char* path);
+    void close();
+    const std::string& error() const { return err; }
+
+    const std::vector<ArrowField>& fields() const { return schema; }
+    int findField(const std::string& name) const;     // -1 when missing
+    size_t numBatches() const { return batches.size(); }
+    uint64_t batchRows(size_t batch) const { return batches[batch].rows; }
+    uint64_t numRows() const;
+
+    // a zero-copy view of field (a top-level column) in one record batch; false
+    // (see error()) when its type can't be read or its buffers are too short
+    bool column(size_t batch, int field, ColumnView& out);
+    // the values of a dictionary-encoded field, all dictionary batches (deltas
+    // included) in index order; integer values are written in decimal
+    const std::vector<std::string>* dictionary(int field) const;
+
+private:
+    struct Batch{
+        uint64_t rows;
+        const uint8_t* body;
+        uint64_t bodyLength;
+        const uint8_t* nodes;       // FieldNode structs (length, null_count)
+        const uint8_t* buffers;     // Buffer structs (offset, length), relative to body
+        size_t numNodes, numBuffers;
+    };
+    MappedFile map;
+    std::vector<ArrowField> schema;
+    std::vector<Batch> batches;
+    std::vector<std::vector<std::string>> dictionaries;  // per field, empty unless dictionary-encoded
+    std::vector<bool> haveDictionary;
+    size_t nodesPerBatch = 0, buffersPerBatch = 0;
+    std::string err;
+
+    bool fail(const std::string& message);
+    bool parseBatch(const FbTable& header, const uint8_t* body, uint64_t bodyLength, Batch& out);
+    bool arrayView(const Batch& b, size_t node, size_t buffer, int type, ColumnView& out, uint64_t& length);
+};
+
+// The dataset in an Arrow IPC file: the schema's columns are found by field
+// name or index (as in a CSV header), the data goes through loadColumns.
+std::vector<point2D> loadArrowDataset(const char* filename, LabelDictionary* labels = nullptr, FeatureScaling* scaling = nullptr,
+                                      const CsvSchema& schema = CsvSchema(), LoadProgress* progress = nullptr);
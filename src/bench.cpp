@@ -0,0 +1,469 @@
+//bench.cpp
+// ml_bench: micro-benchmarks of the CPU hot paths (CSV loading, training, loss,
+// prediction, background grid evaluation, boundary clipping). Builds without
+// GLFW/GLEW/OpenGL. Every case runs warmup iterations and then timed repetitions;
+// the report gives median and MAD per repetition, rows/s and bytes/s, and the
+// JSON output keeps the raw samples for later comparison.
+//
+// Compare mode reruns the cases of a stored report and tests each against its
+// baseline samples with a two-sided Mann-Whitney U test; a case regresses when
+// the difference is significant and the median grew by more than the threshold.
+// The exit code is 1 when anything regressed (2 when the baseline is unreadable).
+// Built with ML_BENCH_RENDER (needs EGL), headless render passes are added.
+//
+//   ml_bench [--out results.json] [--reps N] [--warmup N] [--max-rows N]
+//            [--data-dir DIR] [--filter SUBSTRING]
+//            [--compare baseline.json] [--threshold PERCENT] [--alpha P]
+//            [--size WxH]
+
+#include "dataset.h"
+#include "synth.h"
+#include "csv_tail.h"
+#include "dataset_loader.h"
+#include "model.h"
+#include "scene.h"
+#include "frame_arena.h"
+#include "thread_pool.h"
+#ifdef ML_BENCH_RENDER
+#include <GLEW/glew.h>
+#include "renderer.h"
+#include "headless.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchOptions{
+    std::string out;                    // JSON report path (empty = none)
+    std::string dataDir = "bench_data"; // generated CSVs are kept and reused
+    std::string filter;
+    int reps = 15;
+    int warmup = 3;
+    uint64_t maxRows = 1000000;         // loader sizes run from 1K up to this (at most 100M)
+    std::string compare;                // baseline report; only its cases are rerun
+    double threshold = 5.0;             // percent median growth that counts as a regression
+    double alpha = 0.05;                // significance level of the Mann-Whitney test
+    int width = 800, height = 600;      // render cases
+};
+
+struct BenchCase{
+    std::string name;
+    uint64_t rows;                      // rows processed per iteration
+    uint64_t bytes;                     // bytes read per iteration
+    int inner;                          // iterations per timed repetition (for very short kernels)
+    std::function<void()> run;
+};
+
+struct BenchResult{
+    std::string name;
+    uint64_t rows, bytes;
+    std::vector<double> samples;        // ns per iteration, one per repetition
+    double median, mad;
+};
+
+static volatile float g_sink;           // keeps results observable so loops are not optimized away
+static const int kWideCols = 250;       // unused columns of the csv_load_wide case
+
+static double median(std::vector<double> v){
+    if(v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+static double medianAbsDeviation(const std::vector<double>& v, double med){
+    std::vector<double> dev(v.size());
+    for(size_t i=0;i<v.size();++i) dev[i] = std::fabs(v[i] - med);
+    return median(dev);
+}
+
+// iris-like rows (three petal clusters) in the layout LoadIrisDataset expects,
+// optionally followed by extraCols unused numeric columns
+static bool generateCsv(const std::string& path, uint64_t rows, int extraCols = 0){
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) return false;
+    fputs("\"sepal.length\",\"sepal.width\",\"petal.length\",\"petal.width\",\"variety\"", f);
+    for(int c=0;c<extraCols;++c) fprintf(f, ",\"f%d\"", c);
+    fputc('\n', f);
+    static const char* names[3] = { "Setosa", "Versicolor", "Virginica" };
+    static const float meanL[3] = { 1.46f, 4.26f, 5.55f }, meanW[3] = { 0.25f, 1.33f, 2.03f };
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> noise(0.0f, 0.25f);
+    std::vector<char> buf(1 << 20);
+    size_t used = 0;
+    for(uint64_t i=0;i<rows;++i){
+        int c = (int)(i % 3);
+        float pl = std::min(6.9f, std::max(1.0f, meanL[c] + noise(rng)));
+        float pw = std::min(2.5f, std::max(0.1f, meanW[c] + noise(rng) * 0.4f));
+        if(buf.size() - used < 128 + 8 * (size_t)extraCols){ fwrite(buf.data(), 1, used, f); used = 0; }
+        used += snprintf(buf.data() + used, buf.size() - used, "%.1f,%.1f,%.2f,%.2f,\"%s\"",
+                         5.0f + 0.1f * c, 3.0f, pl, pw, names[c]);
+        for(int k=0;k<extraCols;++k) used += snprintf(buf.data() + used, buf.size() - used, ",%.2f", noise(rng));
+        buf[used++] = '\n';
+    }
+    fwrite(buf.data(), 1, used, f);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+static std::string datasetFile(const BenchOptions& opts, uint64_t rows, int extraCols = 0){
+    std::error_code ec;
+    std::filesystem::create_directories(opts.dataDir, ec);
+    std::string path = opts.dataDir + "/bench_" + std::to_string(rows) + (extraCols ? "_wide" + std::to_string(extraCols) : "") + ".csv";
+    if(!std::filesystem::exists(path)){
+        std::cerr << "generating " << path << "\n";
+        if(!generateCsv(path, rows, extraCols)) std::cerr << "failed to write " << path << "\n";
+    }
+    return path;
+}
+
+// the synthetic generator's structured .npy (x, y float32 and label uint16, 10 bytes
+// per row), read in place through strided column views
+static std::string npyFile(const BenchOptions& opts, uint64_t rows){
+    std::error_code ec;
+    std::filesystem::create_directories(opts.dataDir, ec);
+    std::string path = opts.dataDir + "/bench_" + std::to_string(rows) + ".npy";
+    if(!std::filesystem::exists(path)){
+        std::cerr << "generating " << path << "\n";
+        SynthSpec spec;
+        spec.count = rows;
+        if(!writeSynthetic(spec, path.c_str())) std::cerr << "failed to write " << path << "\n";
+    }
+    return path;
+}
+
+static std::string sizeLabel(uint64_t n){
+    if(n >= 1000000 && n % 1000000 == 0) return std::to_string(n / 1000000) + "M";
+    if(n >= 1000 && n % 1000 == 0) return std::to_string(n / 1000) + "K";
+    return std::to_string(n);
+}
+
+static bool parseBenchArgs(int argc, char** argv, BenchOptions& opts){
+    for(int i=1;i<argc;++i){
+        auto next = [&](){ return i + 1 < argc ? argv[++i] : ""; };
+        if(!strcmp(argv[i], "--out")) opts.out = next();
+        else if(!strcmp(argv[i], "--reps")) opts.reps = std::max(1, atoi(next()));
+        else if(!strcmp(argv[i], "--warmup")) opts.warmup = std::max(0, atoi(next()));
+        else if(!strcmp(argv[i], "--max-rows")) opts.maxRows = std::min<uint64_t>(strtoull(next(), nullptr, 10), 100000000ull);
+        else if(!strcmp(argv[i], "--data-dir")) opts.dataDir = next();
+        else if(!strcmp(argv[i], "--filter")) opts.filter = next();
+        else if(!strcmp(argv[i], "--compare")) opts.compare = next();
+        else if(!strcmp(argv[i], "--threshold")) opts.threshold = atof(next());
+        else if(!strcmp(argv[i], "--alpha")) opts.alpha = atof(next());
+        else if(!strcmp(argv[i], "--size")){
+            if(sscanf(next(), "%dx%d", &opts.width, &opts.height) != 2) std::cerr << "--size expects WIDTHxHEIGHT\n";
+        }
+        else if(!strcmp(argv[i], "--help")){
+            printf("usage: ml_bench [--out results.json] [--reps N] [--warmup N] [--max-rows N] [--data-dir DIR] [--filter SUBSTRING]\n"
+                   "                [--compare baseline.json] [--threshold PERCENT] [--alpha P] [--size WxH]\n");
+            return false;
+        }
+        else std::cerr << "Ignoring unknown argument: " << argv[i] << "\n";
+    }
+    return true;
+}
+
+static BenchResult runCase(const BenchCase& bc, const BenchOptions& opts){
+    BenchResult r;
+    r.name = bc.name; r.rows = bc.rows; r.bytes = bc.bytes;
+    // every run counts as one frame for the per-frame arena
+    auto frame = [&]{ frameArena().reset(); bc.run(); };
+    for(int w=0;w<opts.warmup;++w) for(int k=0;k<bc.inner;++k) frame();
+    for(int rep=0;rep<opts.reps;++rep){
+        auto t0 = std::chrono::steady_clock::now();
+        for(int k=0;k<bc.inner;++k) frame();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        r.samples.push_back(ns / bc.inner);
+    }
+    r.median = median(r.samples);
+    r.mad = medianAbsDeviation(r.samples, r.median);
+    return r;
+}
+
+static bool writeJson(const std::string& path, const BenchOptions& opts, const std::vector<BenchResult>& results){
+    FILE* f = fopen(path.c_str(), "w");
+    if(!f) return false;
+    // threads: the pool the cases ran on (ML_VIS_THREADS); hardware_threads: the machine's
+    fprintf(f, "{\n  \"schema\": \"ml_bench/1\",\n  \"timestamp\": %lld,\n  \"threads\": %d,\n  \"hardware_threads\": %u,\n"
+               "  \"warmup\": %d,\n  \"reps\": %d,\n  \"cases\": [\n",
+            (long long)time(nullptr), ThreadPool::instance().size(), std::thread::hardware_concurrency(), opts.warmup, opts.reps);
+    for(size_t i=0;i<results.size();++i){
+        const BenchResult &r = results[i];
+        double secs = r.median * 1e-9;
+        fprintf(f, "    {\"name\": \"%s\", \"rows\": %llu, \"bytes\": %llu, \"median_ns\": %.1f, \"mad_ns\": %.1f, "
+                   "\"rows_per_s\": %.6g, \"bytes_per_s\": %.6g, \"samples_ns\": [",
+                r.name.c_str(), (unsigned long long)r.rows, (unsigned long long)r.bytes, r.median, r.mad,
+                secs > 0 ? r.rows / secs : 0.0, secs > 0 ? r.bytes / secs : 0.0);
+        for(size_t k=0;k<r.samples.size();++k) fprintf(f, "%s%.1f", k ? ", " : "", r.samples[k]);
+        fprintf(f, "]}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// Reads the cases of a report written by writeJson (name + samples_ns) and its pool
+// size (0 when missing); not a general JSON parser
+static bool loadBaseline(const std::string& path, std::vector<BenchResult>& out, int& threads){
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) return false;
+    std::string text;
+    char buf[65536];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+    if(text.find("\"ml_bench/1\"") == std::string::npos) return false;
+    size_t t = text.find("\"threads\"");
+    threads = t == std::string::npos ? 0 : atoi(text.c_str() + text.find(':', t) + 1);
+
+    size_t pos = 0;
+    while((pos = text.find("\"name\"", pos)) != std::string::npos){
+        size_t q0 = text.find('"', text.find(':', pos) + 1);
+        size_t q1 = text.find('"', q0 + 1);
+        size_t s0 = text.find("\"samples_ns\"", q1);
+        if(q0 == std::string::npos || q1 == std::string::npos || s0 == std::string::npos) return false;
+        size_t b0 = text.find('[', s0), b1 = text.find(']', s0);
+        if(b0 == std::string::npos || b1 == std::string::npos) return false;
+        BenchResult r;
+        r.name = text.substr(q0 + 1, q1 - q0 - 1);
+        r.rows = r.bytes = 0;
+        const char* p = text.c_str() + b0 + 1;
+        const char* end = text.c_str() + b1;
+        while(p < end){
+            char* next = nullptr;
+            double v = strtod(p, &next);
+            if(next == p){ ++p; continue; }
+            r.samples.push_back(v);
+            p = next;
+        }
+        r.median = median(r.samples);
+        r.mad = medianAbsDeviation(r.samples, r.median);
+        out.push_back(r);
+        pos = b1;
+    }
+    return !out.empty();
+}
+
+// Two-sided Mann-Whitney U test (normal approximation with tie and continuity correction)
+static double mannWhitneyP(const std::vector<double>& a, const std::vector<double>& b){
+    const size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    if(n1 == 0 || n2 == 0) return 1.0;
+    std::vector<std::pair<double, int>> all;
+    all.reserve(n);
+    for(double v : a) all.push_back({v, 0});
+    for(double v : b) all.push_back({v, 1});
+    std::sort(all.begin(), all.end());
+    double rankSumA = 0.0, tieTerm = 0.0;
+    for(size_t i=0;i<n;){
+        size_t j = i;
+        while(j < n && all[j].first == all[i].first) ++j;
+        double rank = 0.5 * (double)(i + 1 + j);   // average of ranks i+1..j
+        for(size_t k=i;k<j;++k) if(all[k].second == 0) rankSumA += rank;
+        double t = (double)(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+    double u = rankSumA - 0.5 * n1 * (n1 + 1);
+    double mu = 0.5 * n1 * n2;
+    double sigma2 = n1 * n2 / 12.0 * ((n + 1) - tieTerm / ((double)n * (n - 1)));
+    if(sigma2 <= 0.0) return 1.0;
+    double z = std::max(0.0, std::fabs(u - mu) - 0.5) / std::sqrt(sigma2);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+// Ranked comparison table; returns the number of significant regressions
+static int compareResults(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& current, const BenchOptions& opts){
+    struct Row{ std::string name; double base, cur, delta, p; const char* verdict; };
+    std::vector<Row> rows;
+    int regressions = 0;
+    for(const BenchResult &b : baseline){
+        if(!opts.filter.empty() && b.name.find(opts.filter) == std::string::npos) continue;
+        auto it = std::find_if(current.begin(), current.end(), [&](const BenchResult& c){ return c.name == b.name; });
+        if(it == current.end()){ rows.push_back({b.name, b.median, 0.0, 0.0, 1.0, "missing"}); continue; }
+        double delta = b.median > 0.0 ? (it->median / b.median - 1.0) * 100.0 : 0.0;
+        double p = mannWhitneyP(b.samples, it->samples);
+        const char* verdict = "~";
+        if(p < opts.alpha && delta > opts.threshold){ verdict = "REGRESSED"; ++regressions; }
+        else if(p < opts.alpha && delta < -opts.threshold) verdict = "improved";
+        rows.push_back({b.name, b.median, it->median, delta, p, verdict});
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row& x, const Row& y){ return x.delta > y.delta; });
+    printf("\n%-24s %14s %14s %9s %9s  %s\n", "case", "baseline us", "current us", "delta", "p", "verdict");
+    for(const Row &r : rows){
+        printf("%-24s %14.3f %14.3f %8.1f%% %9.2g  %s\n", r.name.c_str(), r.base * 1e-3, r.cur * 1e-3, r.delta, r.p, r.verdict);
+    }
+    printf("%d regression(s) beyond %.1f%% at alpha %.3g\n", regressions, opts.threshold, opts.alpha);
+    return regressions;
+}
+
+int main(int argc, char** argv){
+    BenchOptions opts;
+    if(!parseBenchArgs(argc, argv, opts)) return 0;
+    std::vector<BenchResult> baseline;
+    int baselineThreads = 0;
+    if(!opts.compare.empty() && !loadBaseline(opts.compare, baseline, baselineThreads)){
+        std::cerr << "cannot read baseline " << opts.compare << "\n";
+        return 2;
+    }
+    if(baselineThreads > 0 && baselineThreads != ThreadPool::instance().size())
+        std::cerr << "note: the baseline ran on " << baselineThreads << " threads, this run on " << ThreadPool::instance().size() << "\n";
+    auto selected = [&](const std::string& name){
+        if(!opts.filter.empty() && name.find(opts.filter) == std::string::npos) return false;
+        if(baseline.empty()) return true;
+        for(const BenchResult &b : baseline) if(b.name == name) return true;
+        return false;
+    };
+
+    // datasets are loaded lazily so --filter can skip the large ones
+    std::vector<uint64_t> sizes;
+    for(uint64_t n=1000;n<=opts.maxRows;n*=10) sizes.push_back(n);
+    std::vector<std::vector<point2D>> loaded(sizes.size());
+    auto data = [&](size_t i) -> const std::vector<point2D>& {
+        if(loaded[i].empty()) loaded[i] = LoadIrisDataset(datasetFile(opts, sizes[i]).c_str());
+        return loaded[i];
+    };
+    auto fileBytes = [&](size_t i){
+        std::error_code ec;
+        auto n = std::filesystem::file_size(datasetFile(opts, sizes[i]), ec);
+        return ec ? 0ull : (unsigned long long)n;
+    };
+
+    LogisticModel model(0.5f);
+    model.randomize();
+    std::vector<BenchCase> cases;
+    for(size_t i=0;i<sizes.size();++i){
+        uint64_t n = sizes[i];
+        std::string tag = sizeLabel(n);
+        cases.push_back({ "csv_load/" + tag, n, 0, 1, [&, i]{ g_sink = (float)LoadIrisDataset(datasetFile(opts, sizes[i]).c_str()).size(); } });
+        if(n == 10000){
+            // the same rows with 250 unused columns after them: only line ends are searched there
+            cases.push_back({ "csv_load_wide/" + tag, n, 0, 1, [&]{ g_sink = (float)LoadIrisDataset(datasetFile(opts, 10000, kWideCols).c_str()).size(); } });
+        }
+        if(n == 100000){
+            // follow mode ingest: the whole file as if it had just been appended, in MAX_POLL_BYTES polls
+            cases.push_back({ "csv_tail/" + tag, n, 0, 1, [&, i]{
+                static LabelDictionary dict;
+                static FeatureScaling tailScaling;
+                std::string path = datasetFile(opts, sizes[i]);
+                if(!dict.frozen()) LoadIrisDataset(path.c_str(), &dict, &tailScaling);
+                CsvTail tail;
+                std::vector<point2D> rows;
+                tail.open(path, 0, CsvSchema());
+                while(tail.poll(dict, tailScaling, rows)) {}
+                g_sink = (float)rows.size();
+            } });
+        }
+        cases.push_back({ "npy_load/" + tag, n, n * 10, 1, [&, n]{ g_sink = (float)loadDataset(npyFile(opts, n).c_str()).size(); } });
+        cases.push_back({ "synth_generate/" + tag, n, n * sizeof(point2D), 1, [&, n]{
+            SynthSpec spec;
+            spec.shape = SYNTH_SPIRALS;
+            spec.count = n;
+            g_sink = generateSynthetic(spec).back().x;
+        } });
+        cases.push_back({ "train_epoch/" + tag, n, n * sizeof(point2D), 1, [&, i]{ model.train_epoch(data(i)); g_sink = model.last_loss; } });
+        cases.push_back({ "compute_loss/" + tag, n, n * sizeof(point2D), 1, [&, i]{ g_sink = model.compute_loss(data(i)); } });
+        cases.push_back({ "predict_probs/" + tag, n, n * sizeof(point2D), 1, [&, i]{
+            float s = 0.0f, probs[3];
+            for(const point2D &p : data(i)){ model.predict_probs(p.x, p.y, probs); s += probs[0]; }
+            g_sink = s;
+        } });
+    }
+
+    // per-frame scene passes at the default view
+    Scene scene;
+    scene.opts.adaptiveBackground = false;
+    const uint64_t gridCells = (uint64_t)Scene::GRID_COLS * Scene::GRID_ROWS;
+    cases.push_back({ "grid_eval/uniform", gridCells, gridCells * sizeof(Vertex), 1, [&]{
+        scene.updateBackground(model); g_sink = scene.gridVertices[0].r;
+    } });
+    Scene adaptive;
+    cases.push_back({ "grid_eval/adaptive", 0, 0, 1, [&]{
+        adaptive.updateBackground(model); g_sink = (float)adaptive.field.evaluations;
+    } });
+    cases.push_back({ "boundary_clip", 1, 0, 1000, [&]{
+        scene.updateBoundaries(model); g_sink = (float)scene.lines.size();
+    } });
+    // exact region boundaries stay cheap with many classes: O(K^2 log K)
+    LogisticModel model50(0.5f, 50);
+    model50.randomize();
+    cases.push_back({ "boundary_clip/k50", 50, 0, 10, [&]{
+        scene.updateBoundaries(model50); g_sink = (float)scene.lines.size();
+    } });
+
+#ifdef ML_BENCH_RENDER
+    // headless render passes on the largest dataset up to 100K points
+    OffscreenGL gl;
+    Scene renderScene;
+    size_t renderSet = std::max<size_t>(std::min<size_t>(sizes.size(), 3), 1) - 1;
+    std::vector<unsigned char> pixels((size_t)opts.width * opts.height * 4);
+    bool renderCases = false;
+    if(!sizes.empty() && (selected("render/scene_update") || selected("render/upload") || selected("render/draw") || selected("render/readback"))){
+        renderCases = createOffscreenGL(opts.width, opts.height, gl);
+    }
+    if(renderCases){
+        const auto &rd = data(renderSet);
+        windowWidth = opts.width; windowHeight = opts.height;
+        initSceneRenderer(std::vector<Vertex>(), axesVertex());
+        renderScene.setDataset(rd);
+        renderScene.update(model, rd, opts.width, opts.height);
+        const uint64_t px = (uint64_t)opts.width * opts.height;
+        cases.push_back({ "render/scene_update", rd.size(), 0, 1, [&]{ renderScene.update(model, data(renderSet), opts.width, opts.height); } });
+        cases.push_back({ "render/upload", rd.size(), 0, 1, [&]{ uploadScene(renderScene); glFinish(); } });
+        cases.push_back({ "render/draw", px, px * 4, 1, [&]{
+            glViewport(0, 0, opts.width, opts.height);
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawScene(renderScene);
+            glFinish();
+        } });
+        cases.push_back({ "render/readback", px, px * 4, 1, [&]{
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, opts.width, opts.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            g_sink = pixels[0];
+        } });
+    }
+#endif
+
+    std::vector<BenchResult> results;
+    printf("%-24s %14s %12s %14s %14s\n", "case", "median us", "MAD us", "rows/s", "MB/s");
+    for(auto &bc : cases){
+        if(!selected(bc.name)) continue;
+        if(bc.name.rfind("csv_load/", 0) == 0){
+            size_t i = std::find(sizes.begin(), sizes.end(), bc.rows) - sizes.begin();
+            bc.bytes = fileBytes(i);
+        }
+        if(bc.name.rfind("csv_load_wide/", 0) == 0){
+            std::error_code ec;
+            bc.bytes = std::filesystem::file_size(datasetFile(opts, bc.rows, kWideCols), ec);
+        }
+        BenchResult r = runCase(bc, opts);
+        if(bc.name == "grid_eval/adaptive") r.rows = adaptive.field.evaluations;
+        double secs = r.median * 1e-9;
+        printf("%-24s %14.3f %12.3f %14.4g %14.4g\n", r.name.c_str(), r.median * 1e-3, r.mad * 1e-3,
+               secs > 0 ? r.rows / secs : 0.0, secs > 0 ? r.bytes / secs / 1e6 : 0.0);
+        results.push_back(r);
+    }
+
+#ifdef ML_BENCH_RENDER
+    if(renderCases) destroyOffscreenGL(gl);
+#endif
+
+    if(!opts.out.empty()){
+        if(!writeJson(opts.out, opts, results)){ std::cerr << "failed to write " << opts.out << "\n"; return 1; }
+        printf("wrote %s\n", opts.out.c_str());
+    }
+    if(!baseline.empty()) return compareResults(baseline, results, opts) > 0 ? 1 : 0;
+    return 0;
+}
@@ -0,0 +1,338 @@
+//column_source.cpp
+
+#include "column_source.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+size_t columnTypeSize(int type){
+    switch(type){
+        case COLUMN_I8: case COLUMN_U8: return 1;
+        case COLUMN_I16: case COLUMN_U16: return 2;
+        case COLUMN_F32: case COLUMN_I32: case COLUMN_U32: return 4;
+        case COLUMN_F64: case COLUMN_I64: case COLUMN_U64: return 8;
+        default: return 0;
+    }
+}
+
+template<class T>
+static T loadAs(const uint8_t* p){
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+float columnFloat(const ColumnView& c, uint64_t i){
+    const uint8_t* p = c.values + i * c.stride;
+    return c.type == COLUMN_F32 ? loadAs<float>(p) : (float)loadAs<double>(p);
+}
+
+int64_t columnInteger(const ColumnView& c, uint64_t i){
+    const uint8_t* p = c.values + i * c.stride;
+    switch(c.type){
+        case COLUMN_I8: return loadAs<int8_t>(p);
+        case COLUMN_I16: return loadAs<int16_t>(p);
+        case COLUMN_I32: return loadAs<int32_t>(p);
+        case COLUMN_I64: return loadAs<int64_t>(p);
+        case COLUMN_U8: return loadAs<uint8_t>(p);
+        case COLUMN_U16: return loadAs<uint16_t>(p);
+        case COLUMN_U32: return loadAs<uint32_t>(p);
+        default: return (int64_t)loadAs<uint64_t>(p);
+    }
+}
+
+static const size_t BLOCK_ROWS = 1024;
+
+template<class T>
+static void widen(const uint8_t* p, size_t stride, size_t n, int64_t* out){
+    for(size_t j=0;j<n;++j) out[j] = (int64_t)loadAs<T>(p + j * stride);
+}
+
+static void readIntegers(const ColumnView& c, uint64_t b, size_t n, int64_t* out){
+    const uint8_t* p = c.values + b * c.stride;
+    switch(c.type){
+        case COLUMN_I8: widen<int8_t>(p, c.stride, n, out); break;
+        case COLUMN_I16: widen<int16_t>(p, c.stride, n, out); break;
+        case COLUMN_I32: widen<int32_t>(p, c.stride, n, out); break;
+        case COLUMN_U8: widen<uint8_t>(p, c.stride, n, out); break;
+        case COLUMN_U16: widen<uint16_t>(p, c.stride, n, out); break;
+        case COLUMN_U32: widen<uint32_t>(p, c.stride, n, out); break;
+        default: widen<int64_t>(p, c.stride, n, out); break;
+    }
+}
+
+// rows [b, b+n) of a float (or integer) column as float32, into a block buffer
+static void readFloats(const ColumnView& c, uint64_t b, size_t n, float* out){
+    const uint8_t* p = c.values + b * c.stride;
+    if(c.type == COLUMN_F32 && c.stride == 4) memcpy(out, p, n * 4);
+    else if(c.type == COLUMN_F32) for(size_t j=0;j<n;++j) out[j] = loadAs<float>(p + j * c.stride);
+    else if(c.type == COLUMN_F64) for(size_t j=0;j<n;++j) out[j] = (float)loadAs<double>(p + j * c.stride);
+    else {
+        int64_t v[BLOCK_ROWS];
+        readIntegers(c, b, n, v);
+        for(size_t j=0;j<n;++j) out[j] = (float)v[j];
+    }
+}
+
+const char* columnString(const ColumnView& c, uint64_t i, size_t& len){
+    uint64_t b, e;
+    if(c.type == COLUMN_UTF8){ b = (uint32_t)loadAs<int32_t>(c.offsets + 4 * i); e = (uint32_t)loadAs<int32_t>(c.offsets + 4 * (i + 1)); }
+    else { b = (uint64_t)loadAs<int64_t>(c.offsets + 8 * i); e = (uint64_t)loadAs<int64_t>(c.offsets + 8 * (i + 1)); }
+    b = std::min(b, c.bytes);
+    e = std::min(std::max(e, b), c.bytes);
+    len = (size_t)(e - b);
+    return (const char*)c.values + b;
+}
+
+// Labels either arrive as small integer codes, mapped to ids through a table
+// (dictionary columns, integer labels of a narrow range, no label column), or as
+// names hashed per row (strings, integers spread too wide for a table).
+enum{ LABELS_CODES, LABELS_NAMES };
+
+std::vector<point2D> loadColumns(const ColumnSource& source, const char* filename, LabelDictionary* labels,
+                                 FeatureScaling* scaling, LoadProgress* progress){
+    std::vector<point2D> data;
+    if(source.chunks.empty()) return data;
+    const ColumnView &label0 = source.chunks[0].label;
+    if(label0.type != COLUMN_NONE && !label0.isInteger() && !label0.isString()){
+        std::cerr << "The label column must hold integers, strings or dictionary codes\n";
+        return data;
+    }
+    for(const ColumnChunk &c : source.chunks){
+        if(!(c.x.isFloat() || c.x.isInteger()) || !(c.y.isFloat() || c.y.isInteger())){ std::cerr << "The x and y columns must hold numbers\n"; return data; }
+    }
+
+    // row ranges of at most a few million rows, so cancelling stays quick
+    ThreadPool &pool = ThreadPool::instance();
+    struct Part{ size_t chunk; uint64_t begin, end; };
+    uint64_t totalRows = 0;
+    for(const ColumnChunk &c : source.chunks) totalRows += c.rows;
+    const uint64_t partRows = std::min<uint64_t>(1 << 22, std::max<uint64_t>(1 << 16, totalRows / (pool.size() * 4)));
+    std::vector<Part> parts;
+    for(size_t c=0;c<source.chunks.size();++c)
+        for(uint64_t b=0;b<source.chunks[c].rows;b+=partRows) parts.push_back({ c, b, std::min(source.chunks[c].rows, b + partRows) });
+    const size_t numParts = parts.size();
+    if(progress) progress->total = 2 * totalRows;
+
+    // integer labels without names: one table slot per value when their range is narrow
+    int mode = LABELS_CODES;
+    int64_t codeBase = 0;
+    size_t codeCount = 0;           // codes 0..codeCount-1 have names; codeCount stands for a missing label
+    if(source.labelNames && label0.isInteger()) codeCount = source.labelNames->size();
+    else if(label0.isString()) mode = LABELS_NAMES;
+    else if(label0.isInteger()){
+        struct Range{ int64_t lo = INT64_MAX, hi = INT64_MIN; };
+        Range r = pool.parallel_reduce(numParts, 1, Range(), [&](size_t b, size_t e){
+            Range m;
+            int64_t v[BLOCK_ROWS];
+            for(size_t k=b;k<e;++k){
+                const ColumnView &l = source.chunks[parts[k].chunk].label;
+                for(uint64_t i=parts[k].begin;i<parts[k].end;i+=BLOCK_ROWS){
+                    size_t n = (size_t)std::min<uint64_t>(BLOCK_ROWS, parts[k].end - i);
+                    readIntegers(l, i, n, v);
+                    for(size_t j=0;j<n;++j){
+                        if(!l.valid(i + j)) continue;
+                        m.lo = std::min(m.lo, v[j]);
+                        m.hi = std::max(m.hi, v[j]);
+                    }
+                }
+            }
+            return m;
+        }, [](Range a, Range b){ return Range{ std::min(a.lo, b.lo), std::max(a.hi, b.hi) }; });
+        if(r.lo > r.hi) codeCount = 0;
+        else if((uint64_t)r.hi - (uint64_t)r.lo < (1u << 16)){ codeBase = r.lo; codeCount = (size_t)(r.hi - r.lo) + 1; }
+        else mode = LABELS_NAMES;
+    }
+    const int64_t nullCode = (int64_t)codeCount;
+    auto codeName = [&](size_t code) -> std::string {
+        if(code == codeCount) return std::string();
+        if(source.labelNames) return (*source.labelNames)[code];
+        return std::to_string(codeBase + (int64_t)code);
+    };
+    // the codes of a block; -1 = not a valid code (a dictionary index out of range)
+    auto readCodes = [&](const ColumnView& l, uint64_t b, size_t n, int64_t* out){
+        if(l.type == COLUMN_NONE){ std::fill(out, out + n, nullCode); return; }
+        readIntegers(l, b, n, out);
+        for(size_t j=0;j<n;++j){
+            int64_t c = out[j] - codeBase;
+            out[j] = !l.valid(b + j) ? nullCode : c >= 0 && c < nullCode ? c : -1;
+        }
+    };
+    // integers spread too wide for the table are named in decimal, like in a CSV
+    auto nameAt = [](const ColumnView& l, uint64_t i, char* buf, size_t& len) -> const char* {
+        if(!l.valid(i)){ len = 0; return buf; }
+        if(l.isString()) return columnString(l, i, len);
+        len = (size_t)(std::to_chars(buf, buf + 24, columnInteger(l, i)).ptr - buf);
+        return buf;
+    };
+
+    LabelDictionary own;
+    LabelResolver resolver(labels ? *labels : own, filename, label0.type == COLUMN_NONE ? std::string() : source.labelColumn);
+    LabelDictionary &dict = resolver.dict;
+    const bool fixed = resolver.fixed;
+    std::vector<int> codeId(mode == LABELS_CODES ? codeCount + 1 : 0, -1);
+    if(fixed) for(size_t c=0;c<codeId.size();++c) codeId[c] = dict.find(codeName(c));
+
+    // pass 1: statistics, class names and the rows each part keeps. Rows are
+    // decoded a block at a time, so the column reads are tight loops per type.
+    std::vector<ColumnStats> colStats(numParts * 2);
+    std::vector<uint64_t> kept(numParts, 0), missing(numParts, 0), badCode(numParts, 0), rejected(numParts, 0);
+    std::vector<std::vector<std::string>> rejectedNames(numParts);
+    std::vector<std::atomic<uint8_t>> used(mode == LABELS_CODES && !fixed ? codeCount + 1 : 0);     // codes seen
+    std::vector<LabelDictionary> local(mode == LABELS_NAMES && !fixed ? numParts : 0);
+    pool.parallel_for(numParts, 1, [&](size_t b, size_t e){
+        float fx[BLOCK_ROWS], fy[BLOCK_ROWS];
+        int64_t codes[BLOCK_ROWS];
+        char buf[24];
+        const int* ids = codeId.data();
+        std::vector<uint8_t> seen(used.size(), 0);     // this thread's, merged below
+        for(size_t k=b;k<e;++k){
+            if(progress && progress->cancelled()) break;
+            const ColumnChunk &c = source.chunks[parts[k].chunk];
+            const bool checkValid = c.x.validity || c.y.validity;
+            uint64_t nKept = 0, nMissing = 0, nBad = 0;
+            for(uint64_t r=parts[k].begin;r<parts[k].end;r+=BLOCK_ROWS){
+                size_t n = (size_t)std::min<uint64_t>(BLOCK_ROWS, parts[k].end - r), m = 0;
+                readFloats(c.x, r, n, fx);
+                readFloats(c.y, r, n, fy);
+                if(mode == LABELS_CODES) readCodes(c.label, r, n, codes);
+                for(size_t j=0;j<n;++j){
+                    if(checkValid && !(c.x.valid(r + j) && c.y.valid(r + j))){ ++nMissing; continue; }
+                    if(mode == LABELS_CODES){
+                        int64_t code = codes[j];
+                        if(code < 0){ ++nBad; continue; }
+                        if(!fixed) seen[code] = 1;
+                        else if(ids[code] < 0){
+                            if(++rejected[k] <= 3) rejectedNames[k].push_back(codeName((size_t)code));
+                            continue;
+                        }
+                    } else {
+                        size_t len;
+                        const char* name = nameAt(c.label, r + j, buf, len);
+                        if((fixed ? dict.find(name, len) : local[k].intern(name, len)) < 0){
+                            if(++rejected[k] <= 3) rejectedNames[k].emplace_back(name, len);
+                            continue;
+                        }
+                    }
+                    fx[m] = fx[j];
+                    fy[m] = fy[j];
+                    ++m;
+                }
+                colStats[k*2].add(fx, m);
+                colStats[k*2+1].add(fy, m);
+                nKept += m;
+            }
+            kept[k] = nKept;
+            missing[k] = nMissing;
+            badCode[k] = nBad;
+            if(progress) progress->done += parts[k].end - parts[k].begin;
+        }
+        for(size_t code=0;code<seen.size();++code) if(seen[code]) used[code].store(1, std::memory_order_relaxed);
+    });
+    // a cancelled load leaves the sidecar and the caller's dictionary alone
+    if(progress && progress->cancelled()) return data;
+
+    std::vector<std::vector<int>> remap(local.size());
+    if(!fixed){
+        std::vector<std::string> classes;
+        if(mode == LABELS_CODES){
+            for(size_t code=0;code<=codeCount;++code) if(used[code].load()) classes.push_back(codeName(code));
+        } else {
+            for(const auto &d : local) for(int i=0;i<d.size();++i) classes.push_back(d.name(i));
+        }
+        resolver.build(std::move(classes));
+        for(size_t c=0;c<codeId.size();++c) codeId[c] = dict.find(codeName(c));
+        for(size_t k=0;k<remap.size();++k){
+            remap[k].resize(local[k].size());
+            for(int i=0;i<local[k].size();++i) remap[k][i] = dict.find(local[k].name(i));
+        }
+    }
+
+    FeatureScaling ownScaling;
+    FeatureScaling &sc = scaling ? *scaling : ownScaling;
+    for(int a=0;a<2;++a){
+        sc.stats[a] = ColumnStats();
+        for(size_t k=0;k<numParts;++k) sc.stats[a].merge(colStats[k*2+a]);
+        if(!source.featureNames[a].empty()) sc.names[a] = source.featureNames[a];
+    }
+    sc.fit();
+
+    // pass 2: every part writes its normalized points at its own offset
+    std::vector<uint64_t> start(numParts + 1, 0), written(numParts, 0);
+    for(size_t k=0;k<numParts;++k) start[k+1] = start[k] + kept[k];
+    data.resize((size_t)start[numParts]);
+    pool.parallel_for(numParts, 1, [&](size_t b, size_t e){
+        float fx[BLOCK_ROWS], fy[BLOCK_ROWS];
+        int64_t codes[BLOCK_ROWS];
+        char buf[24];
+        const int* ids = codeId.data();
+        for(size_t k=b;k<e;++k){
+            if(progress && progress->cancelled()) break;
+            const ColumnChunk &c = source.chunks[parts[k].chunk];
+            const bool checkValid = c.x.validity || c.y.validity;
+            const uint64_t limit = kept[k];
+            point2D* out = data.data() + start[k];
+            uint64_t w = 0;
+            for(uint64_t r=parts[k].begin;r<parts[k].end && w<limit;r+=BLOCK_ROWS){
+                size_t n = (size_t)std::min<uint64_t>(BLOCK_ROWS, parts[k].end - r);
+                readFloats(c.x, r, n, fx);
+                readFloats(c.y, r, n, fy);
+                if(mode == LABELS_CODES) readCodes(c.label, r, n, codes);
+                for(size_t j=0;j<n && w<limit;++j){
+                    uint64_t i = r + j;
+                    if(checkValid && !(c.x.valid(i) && c.y.valid(i))) continue;
+                    int id;
+                    const char* name = nullptr;
+                    size_t len = 0;
+                    bool passOneKept = !fixed;      // fixed ids were checked in pass 1
+                    if(mode == LABELS_CODES){
+                        if(codes[j] < 0) continue;
+                        id = ids[codes[j]];
+                    } else {
+                        name = nameAt(c.label, i, buf, len);
+                        if(fixed) id = dict.find(name, len);
+                        else {
+                            // a name the part's dictionary refused was already counted in pass 1
+                            int l = local[k].find(name, len);
+                            passOneKept = l >= 0;
+                            id = l < 0 ? -1 : remap[k][l];
+                        }
+                    }
+                    if(id < 0){
+                        // a row pass 1 kept is only rejected here past MAX_LABELS distinct names overall
+                        if(passOneKept && ++rejected[k] <= 3) rejectedNames[k].push_back(name ? std::string(name, len) : codeName((size_t)codes[j]));
+                        continue;
+                    }
+                    out[w++] = { sc.normalize(0, fx[j]), sc.normalize(1, fy[j]), (uint16_t)id };
+                }
+            }
+            written[k] = w;
+            if(progress) progress->done += parts[k].end - parts[k].begin;
+        }
+    });
+    if(progress && progress->cancelled()) return std::vector<point2D>();
+
+    // names only the merged dictionary turned away leave gaps; close them in order
+    uint64_t end = written.empty() ? 0 : written[0];
+    for(size_t k=1;k<numParts;++k){
+        if(end != start[k]) memmove(data.data() + end, data.data() + start[k], written[k] * sizeof(point2D));
+        end += written[k];
+    }
+    data.resize((size_t)end);
+
+    uint64_t nMissing = 0, nBad = 0, unknown = 0;
+    std::vector<std::string> examples;
+    for(size_t k=0;k<numParts;++k){
+        nMissing += missing[k];
+        nBad += badCode[k];
+        unknown += rejected[k];
+        for(const auto &n : rejectedNames[k]) if(examples.size() < 3) examples.push_back(n);
+    }
+    if(nMissing) std::cerr << "Skipped " << nMissing << " rows with a missing x or y\n";
+    if(nBad) std::cerr << "Skipped " << nBad << " rows with label codes outside the dictionary\n";
+    resolver.reportUnknown(unknown, examples);
+    return data;
+}
@@ -0,0 +1,72 @@
+//column_source.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "dataset.h"
+
+// Columnar datasets (Arrow record batches, .npy arrays) are converted into the
+// point store from views of their columns in place, usually straight out of a
+// memory-mapped file. A view is a base pointer and a byte stride, so a row-major
+// [n, 2] matrix, a Fortran-order one and a structured array with interleaved
+// fields are all read without rearranging them first. Values are read with
+// memcpy, so they need no particular alignment; they are little-endian.
+
+enum ColumnType{
+    COLUMN_NONE = 0,
+    COLUMN_F32, COLUMN_F64,
+    COLUMN_I8, COLUMN_I16, COLUMN_I32, COLUMN_I64,
+    COLUMN_U8, COLUMN_U16, COLUMN_U32, COLUMN_U64,
+    COLUMN_UTF8,            // Arrow strings: int32 offsets into values
+    COLUMN_LARGE_UTF8,      // int64 offsets
+};
+
+struct ColumnView{
+    int type = COLUMN_NONE;             // ColumnType
+    const uint8_t* values = nullptr;    // row 0 (string bytes for the UTF8 types)
+    size_t stride = 0;                  // bytes from one row to the next (fixed width types)
+    const uint8_t* offsets = nullptr;   // UTF8 types: rows+1 offsets into values
+    uint64_t bytes = 0;                 // UTF8 types: size of values (offsets are clamped to it)
+    const uint8_t* validity = nullptr;  // Arrow bitmap, bit i set = row i present; null = all present
+
+    bool valid(uint64_t i) const { return !validity || ((validity[i >> 3] >> (i & 7)) & 1); }
+    bool isInteger() const { return type >= COLUMN_I8 && type <= COLUMN_U64; }
+    bool isFloat() const { return type == COLUMN_F32 || type == COLUMN_F64; }
+    bool isString() const { return type == COLUMN_UTF8 || type == COLUMN_LARGE_UTF8; }
+};
+
+// bytes per value of the fixed width types (0 for the others)
+size_t columnTypeSize(int type);
+// value of row i: float types, integer types, string types (len receives the length)
+float columnFloat(const ColumnView& c, uint64_t i);
+int64_t columnInteger(const ColumnView& c, uint64_t i);
+const char* columnString(const ColumnView& c, uint64_t i, size_t& len);
+
+// One run of rows, e.g. an Arrow record batch; label is COLUMN_NONE when the
+// dataset has no label column (one class).
+struct ColumnChunk{
+    uint64_t rows = 0;
+    ColumnView x, y, label;
+};
+
+struct ColumnSource{
+    std::vector<ColumnChunk> chunks;
+    // when set, integer labels are codes into these class names (Arrow dictionary
+    // columns); otherwise integer labels are class names in decimal ("0", "1", ...)
+    // and strings are the names themselves, as if the same data came from a CSV
+    const std::vector<std::string>* labelNames = nullptr;
+    // the label column as the sidecar records it (see LabelResolver), e.g.
+    // "field species"; empty when there is none
+    std::string labelColumn;
+    std::string featureNames[2];    // the x and y columns, for display (FeatureScaling::names)
+};
+
+// The columnar counterpart of LoadIrisDataset, with the same label dictionary,
+// sidecar and normalization rules. Two parallel passes over the rows: the first
+// gathers the feature statistics and the class names, the second writes the
+// normalized points. Rows with a missing x or y are skipped; a missing label is
+// the empty name. filename names the sidecar; progress counts rows.
+std::vector<point2D> loadColumns(const ColumnSource& source, const char* filename, LabelDictionary* labels = nullptr,
+                                 FeatureScaling* scaling = nullptr, LoadProgress* progress = nullptr);
@@ -0,0 +1,265 @@
+//contour.cpp
+
+#include "contour.h"
+#include "thread_pool.h"
+#include "frame_arena.h"
+#include <algorithm>
+#include <cmath>
+
+void ContourEngine::setGrid(int c, int r, int k, float x0, float y0, float x1, float y1){
+    c = std::max(2, c); r = std::max(2, r); k = std::max(1, k);
+    float nsx = (x1 - x0) / (c - 1), nsy = (y1 - y0) / (r - 1);
+    if(valid && c == cols && r == rows && k == numClasses && x0 == ox && y0 == oy && nsx == sx && nsy == sy) return;
+    cols = c; rows = r; numClasses = k;
+    ox = x0; oy = y0; sx = nsx; sy = nsy;
+    tilesX = (cols - 1 + tileSize - 1) / tileSize;
+    tilesY = (rows - 1 + tileSize - 1) / tileSize;
+    tiles.assign((size_t)tilesX * tilesY, Tile());
+    current.clear();
+    valid = false;
+}
+
+float ContourEngine::scalar(const float* p, const ContourLevel& L) const{
+    if(L.kind == CONTOUR_PROB) return p[std::min(L.cls, numClasses - 1)];
+    if(L.kind == CONTOUR_MAX) return *std::max_element(p, p + numClasses);
+    float other = 0.0f;
+    for(int c=0;c<numClasses;++c) if(c != L.cls) other = std::max(other, p[c]);
+    return p[std::min(L.cls, numClasses - 1)] - other;
+}
+
+// lattice points [i0, i1] x [j0, j1] of a tile, borders included
+void ContourEngine::tileRange(int tx, int ty, int& i0, int& i1, int& j0, int& j1) const{
+    i0 = tx * tileSize; i1 = std::min(i0 + tileSize, cols - 1);
+    j0 = ty * tileSize; j1 = std::min(j0 + tileSize, rows - 1);
+}
+
+bool ContourEngine::tileChanged(int tx, int ty, const std::vector<float>& field) const{
+    int i0, i1, j0, j1;
+    tileRange(tx, ty, i0, i1, j0, j1);
+    for(int j=j0;j<=j1;++j){
+        size_t b = ((size_t)j * cols + i0) * numClasses, e = ((size_t)j * cols + i1 + 1) * numClasses;
+        for(size_t k=b;k<e;++k) if(std::fabs(field[k] - current[k]) > changeTolerance) return true;
+    }
+    return false;
+}
+
+void ContourEngine::contourTile(int tx, int ty){
+    Tile &tile = tiles[(size_t)ty * tilesX + tx];
+    // keep the segment buffers of a re-contoured tile so steady frames don't reallocate
+    // them; room for a few lines crossing the tile up front, as boundaries move while training
+    tile.segs.resize(levels.size());
+    for(auto &s : tile.segs){
+        s.clear();
+        if(s.capacity() == 0) s.reserve((size_t)4 * tileSize);
+    }
+    int i0, i1, j0, j1;
+    tileRange(tx, ty, i0, i1, j0, j1);
+    auto hEdge = [&](int i, int j){ return (uint32_t)(2 * ((size_t)j * cols + i)); };
+    auto vEdge = [&](int i, int j){ return (uint32_t)(2 * ((size_t)j * cols + i) + 1); };
+
+    for(size_t l=0;l<levels.size();++l){
+        const ContourLevel &L = levels[l];
+        auto &out = tile.segs[l];
+        for(int j=j0;j<j1;++j){
+            for(int i=i0;i<i1;++i){
+                // corners counter-clockwise from bottom-left
+                float v[4] = {
+                    scalar(&current[((size_t)j * cols + i) * numClasses], L),
+                    scalar(&current[((size_t)j * cols + i + 1) * numClasses], L),
+                    scalar(&current[((size_t)(j + 1) * cols + i + 1) * numClasses], L),
+                    scalar(&current[((size_t)(j + 1) * cols + i) * numClasses], L)
+                };
+                int code = (v[0] >= L.value) | (v[1] >= L.value) << 1 | (v[2] >= L.value) << 2 | (v[3] >= L.value) << 3;
+                if(code == 0 || code == 15) continue;
+
+                // edges: 0 bottom, 1 right, 2 top, 3 left
+                auto emitPoint = [&](int edge, uint32_t &id, float &x, float &y){
+                    static const int ea[4] = {0, 1, 3, 0}, eb[4] = {1, 2, 2, 3};
+                    float va = v[ea[edge]], vb = v[eb[edge]];
+                    float t = (vb != va) ? (L.value - va) / (vb - va) : 0.5f;
+                    t = std::min(1.0f, std::max(0.0f, t));
+                    const float cx[4] = {0, 1, 1, 0}, cy[4] = {0, 0, 1, 1};
+                    x = ox + (i + cx[ea[edge]] + t * (cx[eb[edge]] - cx[ea[edge]])) * sx;
+                    y = oy + (j + cy[ea[edge]] + t * (cy[eb[edge]] - cy[ea[edge]])) * sy;
+                    id = edge == 0 ? hEdge(i, j) : edge == 1 ? vEdge(i + 1, j) : edge == 2 ? hEdge(i, j + 1) : vEdge(i, j);
+                };
+                auto emit = [&](int ea, int eb){
+                    Segment s;
+                    emitPoint(ea, s.e0, s.x0, s.y0);
+                    emitPoint(eb, s.e1, s.x1, s.y1);
+                    out.push_back(s);
+                };
+                bool centerAbove = (v[0] + v[1] + v[2] + v[3]) * 0.25f >= L.value;
+                switch(code){
+                    case 1: case 14: emit(3, 0); break;
+                    case 2: case 13: emit(0, 1); break;
+                    case 3: case 12: emit(3, 1); break;
+                    case 4: case 11: emit(1, 2); break;
+                    case 6: case 9:  emit(0, 2); break;
+                    case 7: case 8:  emit(3, 2); break;
+                    case 5:  if(centerAbove){ emit(0, 1); emit(2, 3); } else { emit(3, 0); emit(1, 2); } break;
+                    case 10: if(centerAbove){ emit(3, 0); emit(1, 2); } else { emit(0, 1); emit(2, 3); } break;
+                }
+            }
+        }
+    }
+}
+
+void ContourEngine::sample(const AdaptiveField::ProbFn& probs, const float* params, size_t paramCount, const ChangeBound& bound){
+    ThreadPool &pool = ThreadPool::instance();
+    const bool levelsChanged = !tiles.empty() && tiles[0].segs.size() != levels.size();
+    if(!params || !bound || !valid || levelsChanged){
+        // the whole lattice, compared with the last one tile by tile
+        scratch.resize((size_t)cols * rows * numClasses);
+        pool.parallel_for((size_t)rows, 1, [&](size_t b, size_t e){
+            for(size_t j=b;j<e;++j)
+                for(int i=0;i<cols;++i) probs(ox + i * sx, oy + j * sy, &scratch[((size_t)j * cols + i) * numClasses]);
+        });
+        update(scratch);
+        for(auto &t : tiles) t.params.assign(params, params + (params ? paramCount : 0));
+        return;
+    }
+
+    // tiles the field may have moved over by more than the tolerance since they were evaluated
+    FrameVector<int> dirty;
+    for(int ty=0;ty<tilesY;++ty){
+        for(int tx=0;tx<tilesX;++tx){
+            const Tile &t = tiles[(size_t)ty * tilesX + tx];
+            int i0, i1, j0, j1;
+            tileRange(tx, ty, i0, i1, j0, j1);
+            if(t.params.size() != paramCount || bound(t.params.data(), params, ox + i0 * sx, oy + j0 * sy, ox + i1 * sx, oy + j1 * sy) > changeTolerance)
+                dirty.push_back(ty * tilesX + tx);
+        }
+    }
+    dirtyTiles = dirty.size();
+    if(dirty.empty()) return;
+
+    // neighbouring tiles share border samples, so each is evaluated into its own
+    // buffer in parallel and copied into the field afterwards
+    const size_t side = (size_t)tileSize + 1, tileFloats = side * side * numClasses;
+    FrameVector<float> fresh(dirty.size() * tileFloats);
+    pool.parallel_for(dirty.size(), 1, [&](size_t b, size_t e){
+        for(size_t k=b;k<e;++k){
+            int i0, i1, j0, j1;
+            tileRange(dirty[k] % tilesX, dirty[k] / tilesX, i0, i1, j0, j1);
+            float* out = &fresh[k * tileFloats];
+            for(int j=j0;j<=j1;++j)
+                for(int i=i0;i<=i1;++i) probs(ox + i * sx, oy + j * sy, out + ((size_t)(j - j0) * side + (i - i0)) * numClasses);
+            tiles[dirty[k]].params.assign(params, params + paramCount);
+        }
+    });
+    // the dirty tiles and their neighbours, whose border samples just changed, are re-contoured
+    FrameVector<char> touched(tiles.size(), 0);
+    for(size_t k=0;k<dirty.size();++k){
+        const int tx = dirty[k] % tilesX, ty = dirty[k] / tilesX;
+        int i0, i1, j0, j1;
+        tileRange(tx, ty, i0, i1, j0, j1);
+        const float* in = &fresh[k * tileFloats];
+        for(int j=j0;j<=j1;++j)
+            std::copy(in + (size_t)(j - j0) * side * numClasses, in + ((size_t)(j - j0) * side + (i1 - i0 + 1)) * numClasses,
+                      &current[((size_t)j * cols + i0) * numClasses]);
+        for(int ny=std::max(0, ty-1);ny<=std::min(tilesY-1, ty+1);++ny)
+            for(int nx=std::max(0, tx-1);nx<=std::min(tilesX-1, tx+1);++nx) touched[(size_t)ny * tilesX + nx] = 1;
+    }
+    FrameVector<int> recontour;
+    for(size_t t=0;t<tiles.size();++t) if(touched[t]) recontour.push_back((int)t);
+    pool.parallel_for(recontour.size(), 1, [&](size_t b, size_t e){
+        for(size_t k=b;k<e;++k) contourTile(recontour[k] % tilesX, recontour[k] / tilesX);
+    });
+    stitch();
+}
+
+void ContourEngine::update(const std::vector<float>& field){
+    if(field.size() != (size_t)cols * rows * numClasses) return;
+    if(!tiles.empty() && tiles[0].segs.size() != levels.size()) valid = false;
+
+    FrameVector<int> dirty;
+    for(int ty=0;ty<tilesY;++ty)
+        for(int tx=0;tx<tilesX;++tx)
+            if(!valid || tileChanged(tx, ty, field)) dirty.push_back(ty * tilesX + tx);
+    dirtyTiles = dirty.size();
+    if(dirty.empty() && valid) return;
+
+    current = field;
+    ThreadPool::instance().parallel_for(dirty.size(), 1, [&](size_t b, size_t e){
+        for(size_t k=b;k<e;++k) contourTile(dirty[k] % tilesX, dirty[k] / tilesX);
+    });
+    valid = true;
+    stitch();
+}
+
+void ContourEngine::stitch(){
+    // scratch comes from the frame arena; lines and points keep their capacity, and
+    // the edge slots are reset entry by entry below, so this is linear in the segments
+    lines.clear();
+    points.clear();
+    const size_t edges = (size_t)2 * cols * rows;
+    if(slotA.size() != edges){ slotA.assign(edges, -1); slotB.assign(edges, -1); }
+    FrameVector<const Segment*> segs;
+    FrameVector<char> visited;
+    FrameVector<float> fwd, back;
+
+    for(size_t l=0;l<levels.size();++l){
+        segs.clear();
+        for(const auto &t : tiles) for(const auto &s : t.segs[l]) segs.push_back(&s);
+        for(size_t k=0;k<segs.size();++k){
+            for(uint32_t e : {segs[k]->e0, segs[k]->e1}){
+                if(slotA[e] < 0) slotA[e] = (int)k; else slotB[e] = (int)k;
+            }
+        }
+        auto other = [&](uint32_t e, int from){ return slotA[e] == from ? slotB[e] : slotA[e]; };
+        visited.assign(segs.size(), 0);
+
+        for(size_t k=0;k<segs.size();++k){
+            if(visited[k]) continue;
+            visited[k] = 1;
+            ContourLine line;
+            line.level = (int)l;
+            line.closed = false;
+            // walk forward from e1, then backward from e0
+            fwd.assign({ segs[k]->x0, segs[k]->y0, segs[k]->x1, segs[k]->y1 });
+            back.clear();
+            int cur = (int)k; uint32_t e = segs[k]->e1;
+            for(;;){
+                int n = other(e, cur);
+                if(n == (int)k){ line.closed = true; break; }
+                if(n < 0 || visited[n]) break;
+                visited[n] = 1;
+                const Segment *s = segs[n];
+                bool forward = s->e0 == e;
+                fwd.push_back(forward ? s->x1 : s->x0); fwd.push_back(forward ? s->y1 : s->y0);
+                e = forward ? s->e1 : s->e0; cur = n;
+            }
+            if(!line.closed){
+                cur = (int)k; e = segs[k]->e0;
+                for(;;){
+                    int n = other(e, cur);
+                    if(n < 0 || visited[n]) break;
+                    visited[n] = 1;
+                    const Segment *s = segs[n];
+                    bool forward = s->e1 == e;
+                    back.push_back(forward ? s->y0 : s->y1); back.push_back(forward ? s->x0 : s->x1);
+                    e = forward ? s->e0 : s->e1; cur = n;
+                }
+            }
+            line.first = points.size();
+            points.insert(points.end(), back.rbegin(), back.rend());
+            points.insert(points.end(), fwd.begin(), fwd.end());
+            line.count = points.size() - line.first;
+            lines.push_back(line);
+        }
+        for(const Segment *s : segs){ slotA[s->e0] = slotB[s->e0] = -1; slotA[s->e1] = slotB[s->e1] = -1; }
+    }
+}
+
+void ContourEngine::toLineVertices(std::vector<Vertex>& out) const{
+    out.clear();
+    for(const auto &line : lines){
+        const ContourLevel &L = levels[line.level];
+        const float* pts = &points[line.first];
+        for(size_t k=2;k+1<line.count;k+=2){
+            out.push_back({pts[k-2], pts[k-1], L.r, L.g, L.b});
+            out.push_back({pts[k], pts[k+1], L.r, L.g, L.b});
+        }
+    }
+}
@@ -0,0 +1,86 @@
+//contour.h
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "adaptive_field.h"
+
+// Iso-probability contours extracted with marching squares from a sampled
+// probability field. The lattice is split into tiles that are contoured in
+// parallel; tiles whose samples did not change since the last update keep
+// their segments. Given a bound on how far the field can have moved over a
+// tile (sample() with a ChangeBound), only the tiles it can't rule out are
+// evaluated again, and they and their neighbours (which share their border
+// samples) are re-contoured. Segments are stitched into polylines through
+// shared edge ids; that walk is linear in the segments (the edge tables
+// persist and only the entries of this update's segments are touched), and a
+// polyline crossing a dirty tile is walked end to end anyway, so the stitch
+// is redone as a whole.
+
+enum ContourKind{
+    CONTOUR_PROB = 0,    // p[cls] == value
+    CONTOUR_MAX = 1,     // max_c p[c] == value (confidence level)
+    CONTOUR_MARGIN = 2   // p[cls] - max_{c != cls} p[c] == value (0 = exact argmax region boundary)
+};
+
+struct ContourLevel{
+    ContourKind kind;
+    int cls;
+    float value;
+    float r, g, b;
+};
+
+struct ContourLine{
+    int level;                      // index into ContourEngine::levels
+    bool closed;
+    size_t first, count;            // floats (x0,y0,x1,y1,...) in ContourEngine::points
+};
+
+struct ContourEngine{
+    std::vector<ContourLevel> levels;
+    int tileSize = 16;              // cells per tile side
+    float changeTolerance = 1e-4f;  // samples closer than this count as unchanged
+
+    size_t dirtyTiles = 0;          // tiles re-contoured by the last update
+    std::vector<ContourLine> lines; // stitched result of the last update
+    std::vector<float> points;      // vertices of all lines, shared so re-stitching reuses one buffer
+
+    // define the sampling lattice (cols x rows points) over a rectangle; resets all tiles on change
+    void setGrid(int cols, int rows, int numClasses, float x0, float y0, float x1, float y1);
+    // Largest change of any class probability over [x0,x1]x[y0,y1] between the
+    // field of parameters `from` and that of `to` (e.g. two weight sets of a model)
+    using ChangeBound = std::function<float(const float* from, const float* to, float x0, float y0, float x1, float y1)>;
+
+    // evaluate the lattice in parallel tiles and update the contours. With params
+    // (paramCount floats the field is a function of) and bound, a tile is evaluated
+    // again only when the bound since its last evaluation exceeds changeTolerance.
+    void sample(const AdaptiveField::ProbFn& probs, const float* params = nullptr, size_t paramCount = 0,
+                const ChangeBound& bound = nullptr);
+    // update from an externally computed field (cols*rows*numClasses, row-major)
+    void update(const std::vector<float>& field);
+    // line-list vertices (two per segment) colored per level
+    void toLineVertices(std::vector<Vertex>& out) const;
+
+private:
+    struct Segment{ uint32_t e0, e1; float x0, y0, x1, y1; };
+    struct Tile{
+        std::vector<std::vector<Segment>> segs;     // per level
+        std::vector<float> params;                  // the field's parameters when its samples were taken
+    };
+
+    int cols = 0, rows = 0, numClasses = 0, tilesX = 0, tilesY = 0;
+    float ox = 0.0f, oy = 0.0f, sx = 0.0f, sy = 0.0f;
+    std::vector<float> current;     // field the tile segments were built from
+    std::vector<float> scratch;     // newly sampled field
+    std::vector<Tile> tiles;
+    std::vector<int> slotA, slotB;  // stitch: the two segments at each edge id, -1 between updates
+    bool valid = false;
+
+    float scalar(const float* p, const ContourLevel& L) const;
+    bool tileChanged(int tx, int ty, const std::vector<float>& field) const;
+    void contourTile(int tx, int ty);
+    void tileRange(int tx, int ty, int& i0, int& i1, int& j0, int& j1) const;
+    void stitch();
+};
@@ -0,0 +1,103 @@
+//csv_tail.cpp
+
+#include "csv_tail.h"
+#include <filesystem>
+#include <iostream>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+CsvTail::~CsvTail(){
+    close();
+}
+
+bool CsvTail::open(const std::string& filePath, uint64_t startOffset, const CsvSchema& schema){
+    close();
+    file.open(filePath, std::ios::binary);
+    if(!file) return false;
+    std::string header;
+    if(!std::getline(file, header)) return false;
+    if(!parser.init(header.data(), header.data() + header.size(), schema)) return false;
+    path = filePath;
+    offset = std::max<uint64_t>(startOffset, header.size() + 1);
+    pending.clear();
+    rowsAppended = 0;
+    rowsSkipped = 0;
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd >= 0 && inotify_add_watch(inotifyFd, path.c_str(), IN_MODIFY | IN_DELETE_SELF | IN_MOVE_SELF) < 0){
+        ::close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+    following = true;
+    behind = true;      // whatever was appended between the load and now
+    return true;
+}
+
+void CsvTail::close(){
+#ifdef __linux__
+    if(inotifyFd >= 0) ::close(inotifyFd);
+#endif
+    inotifyFd = -1;
+    if(file.is_open()) file.close();
+    following = false;
+    behind = false;
+}
+
+size_t CsvTail::poll(const LabelDictionary& labels, FeatureScaling& scaling, std::vector<point2D>& out){
+    if(!following) return 0;
+    bool changed = behind || inotifyFd < 0;
+    bool gone = false;
+#ifdef __linux__
+    if(inotifyFd >= 0){
+        alignas(inotify_event) char events[4096];
+        ssize_t n;
+        while((n = read(inotifyFd, events, sizeof(events))) > 0){
+            for(char* p = events; p < events + n;){
+                const inotify_event* ev = (const inotify_event*)p;
+                if(ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) gone = true;
+                changed = true;
+                p += sizeof(inotify_event) + ev->len;
+            }
+        }
+    }
+#endif
+    if(!changed) return 0;
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(path, ec);
+    if(gone || ec || size < offset){
+        std::cerr << "follow: " << path << (size < offset && !ec && !gone ? " was truncated" : " was moved or deleted") << ", stopped following\n";
+        close();
+        return 0;
+    }
+    behind = false;
+    if(size == offset) return 0;
+
+    // straight into the unparsed tail; a burst larger than one poll continues next time
+    size_t want = (size_t)std::min<uint64_t>(size - offset, MAX_POLL_BYTES);
+    size_t old = pending.size();
+    pending.resize(old + want);
+    file.clear();
+    file.seekg((std::streamoff)offset);
+    file.read(&pending[old], (std::streamsize)want);
+    size_t got = file.gcount() > 0 ? (size_t)file.gcount() : 0;
+    pending.resize(old + got);
+    offset += got;
+    behind = offset < size;
+
+    size_t lineEnd = pending.rfind('\n');
+    if(lineEnd == std::string::npos) return 0;
+    size_t unknown = 0;
+    std::string example;
+    size_t added = parser.parse(pending.data(), pending.data() + lineEnd + 1, labels, scaling, out, unknown, &example);
+    pending.erase(0, lineEnd + 1);
+    rowsAppended += added;
+    if(unknown){
+        rowsSkipped += unknown;
+        std::cerr << "follow: skipped " << unknown << " appended rows with labels outside the " << labels.size()
+                  << "-class dictionary, e.g. '" << example << "'\n";
+    }
+    return added;
+}
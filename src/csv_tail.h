@@ -0,0 +1,42 @@
+//csv_tail.h
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "dataset.h"
+
+// Follow mode for a CSV that another process keeps appending to ("tail -f").
+// open() starts at the byte offset where the initial load stopped (see
+// LoadProgress::completeLines); each poll() reads only the bytes appended
+// since, parses the complete lines and keeps a partial last line for the next
+// poll. On Linux an inotify watch tells whether the file changed, so an idle
+// poll is one non-blocking read(); elsewhere the file size is checked.
+// Parsing runs at a few million rows/s, and one poll takes at most
+// MAX_POLL_BYTES, so a burst is spread over several frames.
+class CsvTail{
+public:
+    static const size_t MAX_POLL_BYTES = 4 << 20;
+
+    ~CsvTail();
+    bool open(const std::string& path, uint64_t offset, const CsvSchema& schema);
+    void close();
+    bool active() const { return following; }
+
+    // appends the new rows to out (labels through the frozen dictionary, x/y
+    // through scaling's existing parameters); returns how many were added
+    size_t poll(const LabelDictionary& labels, FeatureScaling& scaling, std::vector<point2D>& out);
+
+    uint64_t rowsAppended = 0;
+    size_t rowsSkipped = 0;         // labels the dictionary doesn't know
+
+private:
+    std::string path;
+    std::ifstream file;
+    CsvRowParser parser;
+    uint64_t offset = 0;            // next byte to read
+    std::string pending;            // read but not yet parsed (partial last line)
+    bool following = false;
+    bool behind = false;            // more bytes waiting than the last poll took
+    int inotifyFd = -1;
+};
@@ -1,73 +1,420 @@
 //datset.cpp
 
 #include "dataset.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <string>
 
-std::vector<point2D> LoadIrisDataset(const char* filename){
+void ColumnStats::add(float v){
+    if(count == 0.0) min = max = v;
+    else { min = std::min(min, v); max = std::max(max, v); }
+    count += 1.0;
+    double d = v - mean;
+    mean += d / count;
+    m2 += d * (v - mean);
+}
+
+void ColumnStats::add(const float* v, size_t n){
+    if(n == 0) return;
+    // the block's own mean and M2 in two passes over data in cache, then Chan's
+    // merge; four lanes keep the min/max/sum chains from waiting on each other
+    ColumnStats b;
+    float lo[4], hi[4];
+    double sum[4] = { 0.0, 0.0, 0.0, 0.0 }, m2[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for(int l=0;l<4;++l) lo[l] = hi[l] = v[0];
+    size_t i = 0;
+    for(;i+4<=n;i+=4){
+        for(int l=0;l<4;++l){ lo[l] = std::min(lo[l], v[i+l]); hi[l] = std::max(hi[l], v[i+l]); sum[l] += v[i+l]; }
+    }
+    for(;i<n;++i){ lo[0] = std::min(lo[0], v[i]); hi[0] = std::max(hi[0], v[i]); sum[0] += v[i]; }
+    b.count = (double)n;
+    b.mean = (sum[0] + sum[1] + sum[2] + sum[3]) / b.count;
+    for(i=0;i+4<=n;i+=4){
+        for(int l=0;l<4;++l){ double d = v[i+l] - b.mean; m2[l] += d * d; }
+    }
+    for(;i<n;++i){ double d = v[i] - b.mean; m2[0] += d * d; }
+    b.m2 = m2[0] + m2[1] + m2[2] + m2[3];
+    b.min = std::min(std::min(lo[0], lo[1]), std::min(lo[2], lo[3]));
+    b.max = std::max(std::max(hi[0], hi[1]), std::max(hi[2], hi[3]));
+    merge(b);
+}
+
+void ColumnStats::merge(const ColumnStats& o){
+    if(o.count == 0.0) return;
+    if(count == 0.0){ *this = o; return; }
+    // Chan et al.: combine the two means and M2 sums
+    double n = count + o.count, d = o.mean - mean;
+    mean += d * o.count / n;
+    m2 += o.m2 + d * d * count * o.count / n;
+    count = n;
+    min = std::min(min, o.min);
+    max = std::max(max, o.max);
+}
+
+void FeatureScaling::fit(){
+    for(int a=0;a<2;++a){
+        const ColumnStats &c = stats[a];
+        if(mode == NORM_ZSCORE){
+            double sd = std::sqrt(c.variance());
+            offset[a] = (float)c.mean;
+            scale[a] = sd > 0.0 ? (float)(1.0 / sd) : 1.0f;
+        } else {
+            offset[a] = 0.5f * (c.min + c.max);
+            scale[a] = c.max > c.min ? 2.0f / (c.max - c.min) : 1.0f;
+        }
+    }
+}
+
+static const char* kScalingHeader = "#scaling ";
+static const char* kModeNames[2] = { "minmax", "zscore" };
+
+bool FeatureScaling::save(const std::string& path) const{
+    std::ofstream out(path, std::ios::binary);
+    if(!out) return false;
+    out << kScalingHeader << kModeNames[mode == NORM_ZSCORE] << '\n';
+    out.precision(9);
+    for(int a=0;a<2;++a) out << "xy"[a] << ' ' << offset[a] << ' ' << scale[a] << '\n';
+    return (bool)out;
+}
+
+bool FeatureScaling::load(const std::string& path){
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    std::string line;
+    if(!std::getline(in, line)) return false;
+    if(!line.empty() && line.back() == '\r') line.pop_back();
+    int m = -1;
+    for(int i=0;i<2;++i) if(line == kScalingHeader + std::string(kModeNames[i])) m = i;
+    if(m < 0) return false;
+    float o[2], s[2];
+    for(int a=0;a<2;++a){
+        char axis = 0;
+        if(!(in >> axis >> o[a] >> s[a]) || axis != "xy"[a] || !(s[a] != 0.0f)) return false;
+    }
+    mode = m;
+    for(int a=0;a<2;++a){ offset[a] = o[a]; scale[a] = s[a]; }
+    return true;
+}
+
+std::string scalingSidecarPath(const std::string& modelPath){
+    return modelPath + ".scaling";
+}
+
+LabelResolver::LabelResolver(LabelDictionary& d, const char* filename, const std::string& labelColumn)
+    : dict(d), sidecar(labelSidecarPath(filename, labelColumn)), column(labelColumn), given(d.frozen()), fixed(given){
+    LabelDictionary saved;
+    if(!given && !column.empty() && saved.load(sidecar, column))
+        for(int i=0;i<saved.size();++i) previous.push_back(saved.name(i));
+}
+
+void LabelResolver::build(std::vector<std::string> names){
+    // sorted class names give the same labels whatever the row order or chunking
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    dict.clear();
+    for(const auto &n : previous) dict.intern(n);
+    const int kept = dict.size();
+    for(const auto &n : names) dict.intern(n);
+    dict.freeze();
+    if(column.empty() || dict.size() == 0 || (dict.size() == kept && !previous.empty())) return;
+    if(!previous.empty()) std::cerr << "Label dictionary " << sidecar << ": " << dict.size() - kept << " new classes added\n";
+    if(!dict.save(sidecar, column)) std::cerr << "Could not write label dictionary " << sidecar << "\n";
+}
+
+void LabelResolver::reportUnknown(size_t unknown, const std::vector<std::string>& examples) const{
+    if(!unknown) return;
+    std::cerr << "Skipped " << unknown << " rows with labels outside the " << dict.size() << "-class dictionary ("
+              << (given ? std::string("given") : std::string("at most ") + std::to_string(LabelDictionary::MAX_LABELS) + " labels") << "), e.g.";
+    for(const auto &n : examples) std::cerr << " '" << n << "'";
+    std::cerr << "\n";
+}
+
+CsvColumn parseCsvColumn(const char* spec){
+    char* end;
+    long index = strtol(spec, &end, 10);
+    if(*spec && !*end) return { "", (int)index };
+    return { spec, -1 };
+}
+
+// End of the field starting at p (the ',' or end). Quoted fields may hold
+// commas ("" is an escaped quote); nothing is copied or converted.
+static const char* fieldEnd(const char* p, const char* end){
+    if(p < end && *p == '"'){
+        for(++p; p < end; p += 2){
+            p = (const char*)memchr(p, '"', end - p);
+            if(!p) return end;
+            if(p + 1 == end || p[1] != '"'){ ++p; break; }
+        }
+        if(p > end) p = end;
+    }
+    const char* c = (const char*)memchr(p, ',', end - p);
+    return c ? c : end;
+}
+
+// strip blanks and one pair of surrounding quotes
+static void trimField(const char*& b, const char*& e){
+    while(b < e && (*b == ' ' || *b == '\t')) ++b;
+    while(e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) --e;
+    if(e - b >= 2 && *b == '"' && e[-1] == '"'){ ++b; --e; }
+}
+
+// the whole (trimmed) field must be the number; whatever follows e stops strtof
+static bool parseFloatField(const char* b, const char* e, float& out){
+    trimField(b, e);
+    if(b == e) return false;
+    char* stop;
+    out = strtof(b, &stop);
+    return stop == e;
+}
+
+enum{ COL_X, COL_Y, COL_LABEL };
+
+// Picks the schema's columns out of one non-empty row [b, e); problems are reported
+// to err and the row is skipped. Fields are only delimited up to the last wanted
+// column and only x/y are converted. x/y get the raw values; the label is left to
+// the caller, which gets the class name [labelB, labelE) instead (empty when the
+// schema has no label column or the row ends before it).
+static bool parseRow(const char* b, const char* e, const int cols[3], int lastCol, point2D &out,
+                     const char*& labelB, const char*& labelE, std::ostream &err){
+    const char* fb[3] = { nullptr, nullptr, nullptr };
+    const char* fe[3] = { nullptr, nullptr, nullptr };
+    const char* p = b;
+    for(int col=0; col<=lastCol && p<=e; ++col){
+        const char* end = fieldEnd(p, e);
+        for(int k=0;k<3;++k) if(cols[k] == col){ fb[k] = p; fe[k] = end; }
+        p = end + 1;
+    }
+    if(!fb[COL_X] || !fb[COL_Y]){
+        err << "Skipping malformed CSV line (missing field): " << std::string(b, e) << "\n";
+        return false;
+    }
+    float x, y;
+    if(!parseFloatField(fb[COL_X], fe[COL_X], x) || !parseFloatField(fb[COL_Y], fe[COL_Y], y)){
+        err << "Failed to parse line: '" << std::string(b, e) << "' -> not a number\n";
+        return false;
+    }
+    labelB = labelE = b;
+    if(fb[COL_LABEL]){ labelB = fb[COL_LABEL]; labelE = fe[COL_LABEL]; trimField(labelB, labelE); }
+    out = {x, y, 0};
+    return true;
+}
+
+// header names -> column indices, and the x and y columns' names; false (with a
+// message) when a name is missing
+static bool resolveSchema(const CsvSchema& schema, const char* b, const char* e, int cols[3], std::string names[2]){
+    const CsvColumn* want[3] = { &schema.x, &schema.y, &schema.label };
+    std::vector<std::string> header;
+    for(const char* p=b; p<=e;){
+        const char* end = fieldEnd(p, e);
+        const char* hb = p; const char* he = end;
+        trimField(hb, he);
+        header.emplace_back(hb, he);
+        p = end + 1;
+    }
+    for(int k=0;k<3;++k){
+        cols[k] = want[k]->index;
+        if(want[k]->name.empty()) continue;
+        auto it = std::find(header.begin(), header.end(), want[k]->name);
+        if(it == header.end()){ std::cerr << "CSV has no column named '" << want[k]->name << "'\n"; return false; }
+        cols[k] = (int)(it - header.begin());
+    }
+    if(cols[COL_X] < 0 || cols[COL_Y] < 0){ std::cerr << "CSV schema needs x and y columns\n"; return false; }
+    for(int k=0;k<2;++k)
+        names[k] = cols[k] < (int)header.size() && !header[cols[k]].empty() ? header[cols[k]] : "column " + std::to_string(cols[k]);
+    return true;
+}
+
+bool CsvRowParser::init(const char* headerBegin, const char* headerEnd, const CsvSchema& schema){
+    if(!resolveSchema(schema, headerBegin, headerEnd, cols, names)) return false;
+    lastCol = std::max(cols[COL_X], std::max(cols[COL_Y], cols[COL_LABEL]));
+    return true;
+}
+
+size_t CsvRowParser::parse(const char* b, const char* e, const LabelDictionary& labels, FeatureScaling& scaling,
+                           std::vector<point2D>& out, size_t& unknown, std::string* unknownExample) const{
+    size_t added = 0;
+    for(const char* line = b; line < e;){
+        const char* eol = (const char*)memchr(line, '\n', e - line);
+        if(!eol) eol = e;
+        const char* rowB = line;
+        const char* rowE = eol;
+        line = eol + 1;
+        if(rowE > rowB && rowE[-1] == '\r') --rowE;
+        if(rowE == rowB) continue;
+        point2D p;
+        const char *vb, *ve;
+        if(!parseRow(rowB, rowE, cols, lastCol, p, vb, ve, std::cerr)) continue;
+        int id = labels.find(vb, ve - vb);
+        if(id < 0){
+            if(unknown++ == 0 && unknownExample) unknownExample->assign(vb, ve);
+            continue;
+        }
+        scaling.stats[0].add(p.x);
+        scaling.stats[1].add(p.y);
+        out.push_back({ scaling.normalize(0, p.x), scaling.normalize(1, p.y), (uint16_t)id });
+        ++added;
+    }
+    return added;
+}
+
+std::vector<point2D> LoadIrisDataset(const char* filename, LabelDictionary* labels, FeatureScaling* scaling, const CsvSchema& schema, LoadProgress* progress){
     std::vector<point2D> data;
-    std::ifstream file(filename);
+    std::ifstream file(filename, std::ios::binary);
     if(!file.is_open()){
         std::cout <<" Failed to open CSV"<<std::endl;
         return data;
     }
+    // the whole file in large reads (an istreambuf_iterator copy would go byte by byte);
+    // progress counts every byte twice, once read and once parsed
+    std::string text;
+    file.seekg(0, std::ios::end);
+    text.resize((size_t)std::max<std::streamoff>(0, file.tellg()));
+    file.seekg(0);
+    if(progress) progress->total = 2 * (uint64_t)text.size();
+    const size_t readBlock = 8 << 20;
+    size_t got = 0;
+    while(got < text.size() && !(progress && progress->cancelled())){
+        file.read(&text[got], (std::streamsize)std::min(readBlock, text.size() - got));
+        if(file.gcount() <= 0) break;
+        got += (size_t)file.gcount();
+        if(progress) progress->done += (uint64_t)file.gcount();
+    }
+    if(progress && progress->cancelled()) return data;
+    text.resize(got);
+    if(progress && progress->completeLines){
+        // the writer may be in the middle of the last line; CsvTail picks it up from here
+        size_t lastNewline = text.rfind('\n');
+        text.resize(lastNewline == std::string::npos ? 0 : lastNewline + 1);
+        progress->tailOffset = text.size();
+    }
+    size_t bodyStart = text.find('\n'); //the header only names the columns
+    if(bodyStart == std::string::npos) return data;
+    CsvRowParser columns;
+    if(!columns.init(text.data(), text.data() + bodyStart, schema)) return data;
+    const int* cols = columns.cols;
+    const int lastCol = columns.lastCol;
+    ++bodyStart;
 
-    std::string line;
-    getline(file, line); //skipping the header
-    auto trim = [](std::string &s){
-        // remove leading/trailing spaces and CR
-        while(!s.empty() && (s.back()=='\r' || s.back()=='\n' || s.back()==' ' || s.back()=='\t')) s.pop_back();
-        size_t i=0; while(i<s.size() && (s[i]==' '||s[i]=='\t')) ++i;
-        if(i>0) s = s.substr(i);
-    };
-
-    while(getline(file, line)){
-        if(line.empty()) continue;
-        std::stringstream ss(line);
-        std::string val;
-
-        float sepalLength=0.0f, sepalWidth=0.0f, petalLength=0.0f, petalWidth=0.0f;
-        std::string variety;
-
-        try{
-            if(!std::getline(ss, val, ',')) { std::cerr<<"Skipping malformed CSV line (missing field): "<<line<<"\n"; continue; }
-            trim(val);
-            sepalLength = std::stof(val);
-
-            if(!std::getline(ss, val, ',')) { std::cerr<<"Skipping malformed CSV line (missing field): "<<line<<"\n"; continue; }
-            trim(val);
-            sepalWidth = std::stof(val);
-
-            if(!std::getline(ss, val, ',')) { std::cerr<<"Skipping malformed CSV line (missing field): "<<line<<"\n"; continue; }
-            trim(val);
-            petalLength = std::stof(val);
-
-            if(!std::getline(ss, val, ',')) { std::cerr<<"Skipping malformed CSV line (missing field): "<<line<<"\n"; continue; }
-            trim(val);
-            petalWidth = std::stof(val);
-
-            if(!std::getline(ss, val, ',')) { // last field may be without trailing comma
-                // try to take remaining
-                if(!std::getline(ss, val)) val = "";
-            }
-            trim(val);
-            variety = val;
-            if(!variety.empty() && variety.front() == '"' && variety.back() == '"') variety = variety.substr(1, variety.size()-2);
+    // split the body into line-aligned chunks parsed on the thread pool; each
+    // chunk keeps its rows and warnings so the result and log stay in file order
+    ThreadPool &pool = ThreadPool::instance();
+    const size_t minChunkBytes = 1 << 20;
+    size_t parts = std::max<size_t>(1, std::min<size_t>(pool.size() * 4, (text.size() - bodyStart) / minChunkBytes));
+    std::vector<size_t> bounds(1, bodyStart);
+    for(size_t k=1;k<parts;++k){
+        size_t pos = std::max(bounds.back(), bodyStart + (text.size() - bodyStart) * k / parts);
+        pos = text.find('\n', pos);
+        if(pos == std::string::npos) break;
+        bounds.push_back(pos + 1);
+    }
+    bounds.push_back(text.size());
+    parts = bounds.size() - 1;
 
-        } catch(const std::exception &e){
-            std::cerr << "Failed to parse line: '"<< line <<"' -> "<< e.what() <<"\n";
-            continue;
+    // A frozen dictionary passed in fixes the label ids and rows with other names are
+    // reported and skipped. Otherwise every chunk interns its names into a local
+    // dictionary and the ids are remapped after the merge (see LabelResolver).
+    LabelDictionary own;
+    LabelResolver resolver(labels ? *labels : own, filename, cols[COL_LABEL] < 0 ? std::string() : "column " + std::to_string(cols[COL_LABEL]));
+    LabelDictionary &dict = resolver.dict;
+    const bool fixed = resolver.fixed;
+
+    std::vector<std::vector<point2D>> rows(parts);
+    std::vector<LabelDictionary> local(fixed ? 0 : parts);
+    std::vector<size_t> rejected(parts, 0);
+    std::vector<std::vector<std::string>> rejectedNames(parts);  // a few examples per chunk
+    std::vector<std::ostringstream> warnings(parts);
+    std::vector<ColumnStats> colStats(parts * 2);   // x and y stats per chunk, merged below
+    pool.parallel_for(parts, 1, [&](size_t b, size_t e){
+        for(size_t k=b;k<e;++k){
+            const char* chunkEnd = text.data() + bounds[k+1];
+            const char* reported = text.data() + bounds[k];
+            for(const char* line = reported; line < chunkEnd;){
+                if(progress && line - reported >= (1 << 20)){
+                    progress->done += (uint64_t)(line - reported);
+                    reported = line;
+                    if(progress->cancelled()) break;
+                }
+                const char* eol = (const char*)memchr(line, '\n', chunkEnd - line);
+                if(!eol) eol = chunkEnd;
+                const char* rowB = line;
+                const char* rowE = eol;
+                line = eol + 1;
+                if(rowE > rowB && rowE[-1] == '\r') --rowE;
+                if(rowE == rowB) continue;
+                point2D p;
+                const char *vb, *ve;
+                if(!parseRow(rowB, rowE, cols, lastCol, p, vb, ve, warnings[k])) continue;
+                int id = fixed ? dict.find(vb, ve - vb) : local[k].intern(vb, ve - vb);
+                if(id < 0){
+                    if(++rejected[k] <= 3) rejectedNames[k].emplace_back(vb, ve);
+                    continue;
+                }
+                p.label = (uint16_t)id;
+                colStats[k*2].add(p.x);
+                colStats[k*2+1].add(p.y);
+                rows[k].push_back(p);
+            }
+            if(progress) progress->done += (uint64_t)(chunkEnd - reported);
         }
+    });
+    // a cancelled load leaves the sidecar and the caller's dictionary alone
+    if(progress && progress->cancelled()) return data;
 
-        int label = (variety == "Setosa") ? 0 : (variety == "Versicolor") ? 1 : 2;
+    std::vector<std::vector<int>> remap(fixed ? 0 : parts);
+    if(!fixed){
+        std::vector<std::string> classes;
+        for(const auto &d : local) for(int i=0;i<d.size();++i) classes.push_back(d.name(i));
+        resolver.build(std::move(classes));
+        for(size_t k=0;k<parts;++k){
+            remap[k].resize(local[k].size());
+            for(int i=0;i<local[k].size();++i) remap[k][i] = dict.find(local[k].name(i));
+        }
+    }
 
-        // Normalize petal features to [-1,1]
-        float x = (petalLength - 1.0f) / (6.9f - 1.0f) * 2.0f - 1.0f;
-        float y = (petalWidth  - 0.1f) / (2.5f - 0.1f) * 2.0f - 1.0f;
+    // the stats came with the parse; rows are normalized as they are gathered below
+    FeatureScaling ownScaling;
+    FeatureScaling &sc = scaling ? *scaling : ownScaling;
+    for(int a=0;a<2;++a){
+        sc.stats[a] = ColumnStats();
+        for(size_t k=0;k<parts;++k) sc.stats[a].merge(colStats[k*2+a]);
+        sc.names[a] = columns.names[a];
+    }
+    sc.fit();
 
-        data.push_back({x, y, label});
+    size_t total = 0, unknown = 0;
+    for(const auto &r : rows) total += r.size();
+    data.reserve(total);
+    std::vector<std::string> examples;
+    for(size_t k=0;k<parts;++k){
+        std::cerr << warnings[k].str();
+        unknown += rejected[k];
+        for(const auto &n : rejectedNames[k]) if(examples.size() < 3) examples.push_back(n);
+        for(point2D p : rows[k]){
+            if(!fixed){
+                int id = remap[k][p.label];
+                if(id < 0){     // only past MAX_LABELS distinct names
+                    if(++unknown <= 3) examples.push_back(local[k].name(p.label));
+                    continue;
+                }
+                p.label = (uint16_t)id;
+            }
+            p.x = sc.normalize(0, p.x);
+            p.y = sc.normalize(1, p.y);
+            data.push_back(p);
+        }
     }
+    resolver.reportUnknown(unknown, examples);
     return data;
-}
\ No newline at end of file
+}
+
+int countClasses(const std::vector<point2D>& data){
+    int k = 0;
+    for(const point2D &p : data) k = std::max(k, (int)p.label + 1);
+    return k;
+}
@@ -2,10 +2,133 @@
 
 #pragma once
 #include<vector>
+#include<string>
+#include<cstdint>
+#include<atomic>
+#include "label_dict.h"
+
+// Running min/max/mean/variance of one column (Welford). Partial stats of
+// separate chunks merge exactly, so every parsing thread keeps its own.
+struct ColumnStats{
+    double count = 0.0, mean = 0.0, m2 = 0.0;
+    float min = 0.0f, max = 0.0f;
+    void add(float v);
+    void add(const float* v, size_t n);     // a block at once: one merge instead of n divisions
+    void merge(const ColumnStats& other);
+    double variance() const { return count > 1.0 ? m2 / (count - 1.0) : 0.0; }
+};
+
+enum NormalizeMode{ NORM_MINMAX = 0, NORM_ZSCORE = 1 };
+
+// Maps raw feature values to model space: x = (raw - offset) * scale.
+// NORM_MINMAX maps [min, max] onto [-1, 1]; NORM_ZSCORE gives mean 0 and unit
+// variance. Constant columns keep scale 1.
+struct FeatureScaling{
+    int mode = NORM_MINMAX;     // NormalizeMode
+    ColumnStats stats[2];       // raw x and y columns
+    float offset[2] = { 0.0f, 0.0f };
+    float scale[2] = { 1.0f, 1.0f };
+    std::string names[2] = { "x", "y" };    // the raw columns, for display
+
+    void fit();                 // offset/scale from stats and mode
+    float normalize(int axis, float raw) const { return (raw - offset[axis]) * scale[axis]; }
+    float denormalize(int axis, float v) const { return v / scale[axis] + offset[axis]; }
+
+    // text file of the mode and offset/scale per axis, kept next to a model
+    // trained on the scaled features (scalingSidecarPath)
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+std::string scalingSidecarPath(const std::string& modelPath);   // modelPath + ".scaling"
 
 struct point2D{
     float x, y;
-    int label;
+    uint16_t label;     // id in the dataset's LabelDictionary
+};
+
+// The label ids of one load, shared by the loaders. A frozen dictionary passed
+// in fixes them: rows with other names are skipped. Otherwise the loader
+// collects the names it finds and build() freezes them: the classes of the
+// sidecar of the dataset's label column (labelSidecarPath, in the user's cache)
+// from an earlier load keep their ids, new names follow sorted (so the ids
+// don't depend on row order or chunking), and the sidecar is rewritten when it
+// gained names. Each label column has its own sidecar; without a label column
+// (column empty) there is one class and no sidecar.
+struct LabelResolver{
+    LabelDictionary &dict;
+    std::string sidecar;
+    std::string column;         // e.g. "column 4"; empty: no label column
+    bool given;                 // dict was frozen on input
+    bool fixed;                 // the ids are fixed before the load (given)
+    std::vector<std::string> previous;      // the sidecar's classes, in id order
+    LabelResolver(LabelDictionary& dict, const char* filename, const std::string& column);
+    void build(std::vector<std::string> names);
+    // one summary line for rows skipped because dict lacks their label
+    void reportUnknown(size_t unknown, const std::vector<std::string>& examples) const;
+};
+
+// Progress and cancellation of a load running on another thread. done/total
+// count bytes for files and points for generators; once cancel is set the
+// loader stops at its next check (about every MB or 64K points) and returns
+// no data.
+struct LoadProgress{
+    std::atomic<uint64_t> done{0}, total{0};
+    std::atomic<bool> cancel{false};
+    // follow mode: set before the load; a last line without '\n' may still be being
+    // written, so it is left out and tailOffset receives where CsvTail continues
+    bool completeLines = false;
+    uint64_t tailOffset = 0;
+    bool cancelled() const { return cancel.load(std::memory_order_relaxed); }
+    float fraction() const { uint64_t t = total.load(); return t ? (float)((double)done.load() / t) : 0.0f; }
+};
+
+// Column pick for LoadIrisDataset: by header name, or by 0-based index when
+// the name is empty. The defaults are the iris layout (petal length, petal
+// width, variety). A label index of -1 means no label column (one class).
+struct CsvColumn{
+    std::string name;
+    int index;
 };
+struct CsvSchema{
+    CsvColumn x{ "", 2 }, y{ "", 3 }, label{ "", 4 };
+};
+// "3" -> index 3, anything else is a header name
+CsvColumn parseCsvColumn(const char* spec);
+
+// Rows are scanned only up to the last selected column, and only the x and y
+// fields are converted, so wide files cost about as much as their selected
+// columns (plus finding the line ends).
+//
+// Column lookup shared by LoadIrisDataset and CsvTail, which parses rows
+// appended to a file that is already loaded: its labels and scaling are fixed,
+// names missing from the frozen dictionary are counted and skipped, and x/y
+// go through the existing offset/scale (their stats keep accumulating).
+struct CsvRowParser{
+    int cols[3] = { 2, 3, 4 };  // x, y, label column (label -1: none)
+    int lastCol = 4;
+    std::string names[2];       // header names of the x and y columns
+    // header line [headerBegin, headerEnd); false (with a message) when the schema doesn't match
+    bool init(const char* headerBegin, const char* headerEnd, const CsvSchema& schema);
+    // rows in [b, e), which should end at a line end; returns how many were appended to out
+    size_t parse(const char* b, const char* e, const LabelDictionary& labels, FeatureScaling& scaling,
+                 std::vector<point2D>& out, size_t& unknown, std::string* unknownExample = nullptr) const;
+};
+
+// Class labels are discovered from the data: the distinct names of the last
+// column, sorted, become labels 0..K-1 (Setosa, Versicolor, Virginica for iris).
+// The dictionary is cached per dataset and label column (labelSidecarPath) and
+// reused by later loads of that column, so ids stay stable; names it lacks are
+// added after them. A frozen dictionary passed in labels is used instead (e.g.
+// another split of the same data) and rows whose name it lacks are reported and
+// skipped; otherwise labels receives the dataset's dictionary.
+//
+// The two feature columns are normalized with their own statistics, gathered
+// while parsing (see FeatureScaling); scaling selects the mode on input and
+// receives the statistics and the parameters used. progress, if given, is
+// advanced while reading and parsing and can cancel the load.
+std::vector<point2D> LoadIrisDataset(const char* filename, LabelDictionary* labels = nullptr, FeatureScaling* scaling = nullptr,
+                                     const CsvSchema& schema = CsvSchema(), LoadProgress* progress = nullptr);
 
-std::vector<point2D> LoadIrisDataset(const char* filename);
\ No newline at end of file
+// number of classes the labels span (max label + 1)
+int countClasses(const std::vector<point2D>& data);
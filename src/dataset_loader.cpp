@@ -0,0 +1,74 @@
+//dataset_loader.cpp
+
+#include "dataset_loader.h"
+#include "arrow_ipc.h"
+#include "npy.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+static bool hasExtension(const std::string& path, const char* ext){
+    size_t n = strlen(ext);
+    if(path.size() < n) return false;
+    return std::equal(path.end() - n, path.end(), ext, [](char a, char b){ return std::tolower((unsigned char)a) == b; });
+}
+
+bool isCsvPath(const std::string& path){
+    return !hasExtension(path, ".arrow") && !hasExtension(path, ".feather") && !hasExtension(path, ".ipc")
+        && !hasExtension(path, ".npy") && !hasExtension(path, ".npz");
+}
+
+std::vector<point2D> loadDataset(const char* filename, LabelDictionary* labels, FeatureScaling* scaling,
+                                 const CsvSchema& schema, LoadProgress* progress){
+    if(isCsvPath(filename)) return LoadIrisDataset(filename, labels, scaling, schema, progress);
+    if(hasExtension(filename, ".npy") || hasExtension(filename, ".npz")) return loadNpyDataset(filename, labels, scaling, schema, progress);
+    return loadArrowDataset(filename, labels, scaling, schema, progress);
+}
+
+DatasetLoader::~DatasetLoader(){
+    cancel();
+    join();
+}
+
+void DatasetLoader::join(){
+    if(worker.joinable()) worker.join();
+}
+
+void DatasetLoader::cancel(){
+    prog.cancel = true;
+}
+
+void DatasetLoader::start(const DatasetRequest& request, std::function<void(LoadedDataset&)> finish){
+    cancel();
+    join();
+    prog.done = 0;
+    prog.total = 0;
+    prog.cancel = false;
+    prog.completeLines = request.follow && !request.synthetic && isCsvPath(request.path);
+    result = LoadedDataset();
+    state = RUNNING;
+    worker = std::thread([this, request, finish]{
+        LoadedDataset &r = result;
+        r.request = request;
+        r.scaling.mode = request.normalize;
+        if(request.synthetic) r.data = generateSynthetic(request.spec, &r.labels, &prog);
+        else r.data = loadDataset(request.path.c_str(), &r.labels, &r.scaling, request.schema, &prog);
+        if(r.data.empty() || prog.cancelled()){ state = FAILED; return; }
+        r.tailOffset = prog.tailOffset;
+        r.index.build(r.data);
+        if(finish) finish(r);
+        // release: the result is complete before take() can see READY
+        state = prog.cancelled() ? FAILED : READY;
+    });
+}
+
+bool DatasetLoader::take(LoadedDataset& out){
+    int s = state.load();
+    if(s == IDLE || s == RUNNING) return false;
+    join();
+    state = IDLE;
+    if(s != READY) return false;
+    out = std::move(result);
+    result = LoadedDataset();
+    return true;
+}
@@ -0,0 +1,67 @@
+//dataset_loader.h
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dataset.h"
+#include "spatial_index.h"
+#include "synth.h"
+
+// A dataset file by its extension: Arrow IPC / Feather v2 (.arrow, .feather,
+// .ipc; see arrow_ipc.h), NumPy (.npy, .npz; see npy.h), otherwise CSV
+// (LoadIrisDataset). Same arguments and label/normalization rules for every format.
+std::vector<point2D> loadDataset(const char* filename, LabelDictionary* labels = nullptr, FeatureScaling* scaling = nullptr,
+                                 const CsvSchema& schema = CsvSchema(), LoadProgress* progress = nullptr);
+bool isCsvPath(const std::string& path);
+
+// What to load: a dataset file or a generated dataset
+struct DatasetRequest{
+    std::string path;
+    CsvSchema schema;
+    int normalize = NORM_MINMAX;    // NormalizeMode
+    bool synthetic = false;         // generate spec instead of reading path
+    bool follow = false;            // CSV: leave a partial last line for CsvTail
+    SynthSpec spec;
+};
+
+// Everything a dataset switch needs, prepared off the render thread
+struct LoadedDataset{
+    std::vector<point2D> data;
+    LabelDictionary labels;
+    FeatureScaling scaling;
+    SpatialIndex index;             // for Scene::setDataset
+    DatasetRequest request;
+    uint64_t tailOffset = 0;        // follow: where CsvTail continues
+};
+
+// Loads one dataset at a time on its own thread (the parsing itself fans out
+// on the shared thread pool), so the render loop keeps drawing and training the
+// current dataset meanwhile. The loop polls take() between frames and swaps the
+// result in at once. Starting a new load cancels the running one.
+class DatasetLoader{
+public:
+    ~DatasetLoader();
+
+    // finish, if given, runs on the loader thread after a successful load (e.g. to
+    // build vertex arrays); whatever it writes is visible once take() returns true
+    void start(const DatasetRequest& request, std::function<void(LoadedDataset&)> finish = nullptr);
+    void cancel();
+    bool running() const { return state.load() == RUNNING; }
+    float progress() const { return prog.fraction(); }
+
+    // true once per successful load, moving the dataset into out; false while
+    // running, when idle, and after a failed or cancelled load
+    bool take(LoadedDataset& out);
+
+private:
+    enum{ IDLE, RUNNING, READY, FAILED };
+    std::thread worker;
+    std::atomic<int> state{IDLE};
+    LoadProgress prog;
+    LoadedDataset result;
+
+    void join();
+};
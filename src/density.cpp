@@ -0,0 +1,111 @@
+//density.cpp
+
+#include "density.h"
+#include "thread_pool.h"
+#include "palette.h"
+#include <algorithm>
+#include <cmath>
+
+void DensityGrid::resize(int w, int h, int classes){
+    width = std::max(1, w); height = std::max(1, h); numClasses = std::max(1, classes);
+    counts.assign((size_t)numClasses * width * height, 0);
+    maxCount.assign(numClasses, 0);
+    rgba.assign((size_t)width * height * 4, 0);
+}
+
+void DensityGrid::bin(const std::vector<point2D>& data, float x0, float y0, float x1, float y1,
+                      const std::vector<uint32_t>* subset){
+    const size_t plane = (size_t)width * height;
+    std::fill(counts.begin(), counts.end(), 0);
+    const size_t n = subset ? subset->size() : data.size();
+    if(n == 0 || plane == 0) { std::fill(maxCount.begin(), maxCount.end(), 0); return; }
+
+    const float sx = width / (x1 - x0), sy = height / (y1 - y0);
+    const int W = width, H = height, K = numClasses;
+    auto binRange = [&](uint32_t* dst, size_t b, size_t e){
+        for(size_t i=b;i<e;++i){
+            const point2D &p = data[subset ? (*subset)[i] : i];
+            int cx = (int)std::floor((p.x - x0) * sx);
+            int cy = (int)std::floor((p.y - y0) * sy);
+            if(cx < 0 || cy < 0 || cx >= W || cy >= H) continue;
+            int c = std::min((int)p.label, K - 1);
+            dst[(size_t)c * plane + (size_t)cy * W + cx] += 1;
+        }
+    };
+
+    // every chunk needs its own count planes, so use at most one chunk per pool
+    // thread and don't split tiny inputs at all
+    ThreadPool &pool = ThreadPool::instance();
+    const size_t grain = std::max<size_t>(65536, (n + pool.size() - 1) / pool.size());
+    const size_t parts = (n + grain - 1) / grain;
+    if(parts <= 1){
+        binRange(counts.data(), 0, n);
+    } else {
+        // chunk 0 bins straight into counts, the others into private planes merged afterwards
+        std::vector<std::vector<uint32_t>> locals(parts - 1, std::vector<uint32_t>(counts.size(), 0));
+        pool.parallel_for(n, grain, [&](size_t b, size_t e){
+            size_t part = b / grain;
+            binRange(part ? locals[part-1].data() : counts.data(), b, e);
+        });
+        pool.parallel_for(counts.size(), 16384, [&](size_t b, size_t e){
+            for(const auto &l : locals) for(size_t i=b;i<e;++i) counts[i] += l[i];
+        });
+    }
+
+    for(int c=0;c<K;++c){
+        const uint32_t* src = counts.data() + (size_t)c * plane;
+        maxCount[c] = *std::max_element(src, src + plane);
+    }
+}
+
+void DensityGrid::colorize(DensityMapping mapping){
+    const size_t plane = (size_t)width * height;
+    const int K = numClasses;
+
+    // histogram equalization: rank of a count among the class' non-empty bins
+    std::vector<std::vector<uint32_t>> sorted;
+    if(mapping == DENSITY_HISTEQ){
+        sorted.resize(K);
+        for(int c=0;c<K;++c){
+            const uint32_t* src = counts.data() + (size_t)c * plane;
+            auto &s = sorted[c];
+            for(size_t i=0;i<plane;++i) if(src[i]) s.push_back(src[i]);
+            std::sort(s.begin(), s.end());
+        }
+    }
+    std::vector<float> logMax(K), colors((size_t)K * 3);
+    for(int c=0;c<K;++c){
+        logMax[c] = std::log1p((float)maxCount[c]);
+        classColor(c, colors[c*3], colors[c*3+1], colors[c*3+2]);
+    }
+
+    ThreadPool::instance().parallel_for(plane, 4096, [&](size_t b, size_t e){
+        for(size_t i=b;i<e;++i){
+            float r=0.0f, g=0.0f, bl=0.0f, wsum=0.0f, a=0.0f;
+            for(int c=0;c<K;++c){
+                uint32_t n = counts[(size_t)c * plane + i];
+                if(!n) continue;
+                float level;
+                if(mapping == DENSITY_HISTEQ){
+                    const auto &s = sorted[c];
+                    level = (float)(std::upper_bound(s.begin(), s.end(), n) - s.begin()) / (float)s.size();
+                } else {
+                    level = logMax[c] > 0.0f ? std::log1p((float)n) / logMax[c] : 1.0f;
+                }
+                const float* col = &colors[c*3];
+                r += col[0] * level; g += col[1] * level; bl += col[2] * level;
+                wsum += level;
+                a = std::max(a, level);
+            }
+            unsigned char* px = &rgba[i * 4];
+            if(wsum <= 0.0f){ px[0]=px[1]=px[2]=px[3]=0; continue; }
+            // hue from the class mix, brightness/opacity from the strongest class level
+            float inv = 1.0f / wsum;
+            float alpha = 0.25f + 0.75f * a;
+            px[0] = (unsigned char)std::lround(255.0f * r * inv);
+            px[1] = (unsigned char)std::lround(255.0f * g * inv);
+            px[2] = (unsigned char)std::lround(255.0f * bl * inv);
+            px[3] = (unsigned char)std::lround(255.0f * alpha);
+        }
+    });
+}
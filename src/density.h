@@ -0,0 +1,35 @@
+//density.h
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "dataset.h"
+
+// Datashader-style aggregation: points are binned into a screen-resolution
+// per-class count grid and color-mapped into a single RGBA image, so drawing
+// cost depends on the pixel count instead of the number of rows.
+
+enum DensityMapping{
+    DENSITY_LOG = 0,     // log(1+count) scaled per class
+    DENSITY_HISTEQ = 1   // histogram equalization of non-empty bins per class
+};
+
+struct DensityGrid{
+    int width = 0, height = 0;
+    int numClasses = 3;
+    std::vector<uint32_t> counts;  // numClasses planes of width*height bins
+    std::vector<uint32_t> maxCount; // per class
+    std::vector<unsigned char> rgba; // width*height*4, row 0 = bottom
+
+    void resize(int w, int h, int classes = 3);
+    // bin points inside [x0,x1]x[y0,y1] on the shared thread pool;
+    // subset optionally restricts binning to the given point indices (e.g. a spatial index query)
+    void bin(const std::vector<point2D>& data, float x0 = -1.0f, float y0 = -1.0f,
+             float x1 = 1.0f, float y1 = 1.0f, const std::vector<uint32_t>* subset = nullptr);
+    // map counts to colors; empty bins stay fully transparent
+    void colorize(DensityMapping mapping);
+};
+
+// point count above which the density mode is switched on automatically
+const size_t DENSITY_POINT_THRESHOLD = 100000;
@@ -0,0 +1,73 @@
+//frame_arena.cpp
+
+#include "frame_arena.h"
+#include <algorithm>
+#include <cstdlib>
+
+FrameArena::FrameArena(size_t initialBytes){
+    current.store(addBlock(std::max<size_t>(initialBytes, 4096)), std::memory_order_relaxed);
+}
+
+FrameArena::~FrameArena(){
+    for(auto &b : blocks) free(b->data);
+}
+
+FrameArena::Block* FrameArena::addBlock(size_t minBytes){
+    std::unique_ptr<Block> b(new Block());
+    b->size = minBytes;
+    b->data = static_cast<char*>(malloc(minBytes));
+    blocks.push_back(std::move(b));
+    return blocks.back().get();
+}
+
+void* FrameArena::allocate(size_t bytes, size_t align){
+    if(bytes == 0) bytes = 1;
+    for(;;){
+        Block* b = current.load(std::memory_order_acquire);
+        size_t off = b->offset.load(std::memory_order_relaxed);
+        for(;;){
+            size_t start = (off + align - 1) & ~(align - 1);
+            if(start + bytes > b->size) break;
+            if(b->offset.compare_exchange_weak(off, start + bytes, std::memory_order_relaxed)) return b->data + start;
+        }
+        // block full: the first thread to get here chains a larger one, the others retry on it
+        std::lock_guard<std::mutex> lock(growMutex);
+        if(current.load(std::memory_order_relaxed) == b)
+            current.store(addBlock(std::max(b->size * 2, bytes + align)), std::memory_order_release);
+    }
+}
+
+void FrameArena::reset(){
+    peak = std::max(peak, used());
+    if(blockCount() > 1){
+        size_t total = capacity();
+        for(auto &b : blocks) free(b->data);
+        blocks.clear();
+        current.store(addBlock(total), std::memory_order_relaxed);
+    }
+    blocks.back()->offset.store(0, std::memory_order_relaxed);
+}
+
+size_t FrameArena::used() const{
+    std::lock_guard<std::mutex> lock(growMutex);
+    size_t n = 0;
+    for(const auto &b : blocks) n += std::min(b->size, b->offset.load(std::memory_order_relaxed));
+    return n;
+}
+
+size_t FrameArena::capacity() const{
+    std::lock_guard<std::mutex> lock(growMutex);
+    size_t n = 0;
+    for(const auto &b : blocks) n += b->size;
+    return n;
+}
+
+size_t FrameArena::blockCount() const{
+    std::lock_guard<std::mutex> lock(growMutex);
+    return blocks.size();
+}
+
+FrameArena& frameArena(){
+    static FrameArena arena;
+    return arena;
+}
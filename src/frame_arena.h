@@ -0,0 +1,73 @@
+//frame_arena.h
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <cstddef>
+
+// Bump allocator for data that lives for one frame. The frame loop calls
+// frameArena().reset() at the top of every frame; everything allocated since
+// the previous reset is released at once. Allocation is a lock-free bump of
+// the current block, so scene passes running on pool threads can share it.
+// When a frame overflows the block, another block is chained in and the next
+// reset() replaces them with a single block of the combined size. After a few
+// frames the arena stops calling malloc.
+//
+// Containers holding arena memory (FrameVector) must be destroyed before the
+// reset. Their deallocations are no-ops.
+
+class FrameArena{
+public:
+    explicit FrameArena(size_t initialBytes = 256 * 1024);
+    ~FrameArena();
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t bytes, size_t align);
+    // not concurrent with allocate()
+    void reset();
+
+    // the stats lock against a block being chained in, so they may be read
+    // while pool threads allocate
+    size_t used() const;            // bytes handed out since the last reset
+    size_t capacity() const;        // bytes reserved across all blocks
+    size_t highWater() const { return peak; }
+    size_t blockCount() const;
+
+private:
+    struct Block{
+        char* data;
+        size_t size;
+        std::atomic<size_t> offset{0};
+    };
+    Block* addBlock(size_t minBytes);
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    std::atomic<Block*> current{nullptr};
+    mutable std::mutex growMutex;
+    size_t peak = 0;
+};
+
+// the arena reset by the frame loop (app, headless renderer, ml_bench render cases)
+FrameArena& frameArena();
+
+template<typename T>
+struct ArenaAllocator{
+    using value_type = T;
+    FrameArena* arena;
+
+    ArenaAllocator() : arena(&frameArena()) {}
+    explicit ArenaAllocator(FrameArena& a) : arena(&a) {}
+    template<typename U> ArenaAllocator(const ArenaAllocator<U>& o) : arena(o.arena) {}
+
+    T* allocate(size_t n){ return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t){}
+
+    template<typename U> bool operator==(const ArenaAllocator<U>& o) const { return arena == o.arena; }
+    template<typename U> bool operator!=(const ArenaAllocator<U>& o) const { return arena != o.arena; }
+};
+
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
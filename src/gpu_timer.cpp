@@ -0,0 +1,158 @@
+//gpu_timer.cpp
+
+#include "gpu_timer.h"
+#include <GLEW/glew.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct Record{
+    int pass;
+    GLuint begin, end;
+};
+
+struct Slot{
+    std::vector<GLuint> pool;       // query objects, reused every GPU_TIMER_FRAMES frames
+    size_t used = 0;
+    std::vector<Record> records;
+    GLuint lastQuery = 0;           // results become available in issue order
+};
+
+struct Pass{
+    const char* name;
+    double frameMs = 0.0;
+    double history[GPU_TIMER_WINDOW] = {};
+    int filled = 0, next = 0;
+};
+
+bool g_enabled = false;
+Slot g_slots[GPU_TIMER_FRAMES];
+int g_slot = 0;
+std::vector<Pass> g_passes;
+std::vector<GpuPassStats> g_stats;
+size_t g_dropped = 0;
+
+GLuint takeQuery(Slot& s){
+    if(s.used == s.pool.size()){
+        GLuint q = 0;
+        glGenQueries(1, &q);
+        s.pool.push_back(q);
+    }
+    s.lastQuery = s.pool[s.used++];
+    return s.lastQuery;
+}
+
+int passIndex(const char* name){
+    for(size_t i=0;i<g_passes.size();++i) if(g_passes[i].name == name || strcmp(g_passes[i].name, name) == 0) return (int)i;
+    Pass p;
+    p.name = name;
+    g_passes.push_back(p);
+    return (int)g_passes.size() - 1;
+}
+
+double percentile(std::vector<double>& v, double q){
+    if(v.empty()) return 0.0;
+    size_t k = std::min(v.size() - 1, (size_t)(q * (v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+void resetSlot(Slot& s){
+    s.records.clear();
+    s.used = 0;
+    s.lastQuery = 0;
+}
+
+void resolve(Slot& s){
+    if(s.records.empty()) return;
+    GLint available = 0;
+    glGetQueryObjectiv(s.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available){
+        // GPU is more than GPU_TIMER_FRAMES behind: skip rather than stall
+        ++g_dropped;
+        resetSlot(s);
+        return;
+    }
+    for(auto &p : g_passes) p.frameMs = 0.0;
+    for(const Record &r : s.records){
+        if(!r.end) continue;
+        GLuint64 t0 = 0, t1 = 0;
+        glGetQueryObjectui64v(r.begin, GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(r.end, GL_QUERY_RESULT, &t1);
+        if(t1 > t0) g_passes[r.pass].frameMs += (t1 - t0) * 1e-6;
+    }
+    resetSlot(s);
+
+    g_stats.clear();
+    static std::vector<double> window;    // kept across frames so the stats update doesn't allocate
+    window.reserve(GPU_TIMER_WINDOW);
+    for(auto &p : g_passes){
+        p.history[p.next] = p.frameMs;
+        p.next = (p.next + 1) % GPU_TIMER_WINDOW;
+        p.filled = std::min(p.filled + 1, GPU_TIMER_WINDOW);
+        window.assign(p.history, p.history + p.filled);
+        GpuPassStats st;
+        st.name = p.name;
+        st.lastMs = p.frameMs;
+        st.p50Ms = percentile(window, 0.50);
+        st.p99Ms = percentile(window, 0.99);
+        g_stats.push_back(st);
+    }
+    std::sort(g_stats.begin(), g_stats.end(), [](const GpuPassStats& a, const GpuPassStats& b){ return a.p50Ms > b.p50Ms; });
+}
+
+} // namespace
+
+void setGpuTimersEnabled(bool enabled){
+    if(enabled == g_enabled) return;
+    // results from before a pause would be stale
+    for(auto &s : g_slots) resetSlot(s);
+    g_enabled = enabled;
+}
+
+bool gpuTimersEnabled(){
+    return g_enabled;
+}
+
+void gpuTimerBeginFrame(){
+    if(!g_enabled) return;
+    g_slot = (g_slot + 1) % GPU_TIMER_FRAMES;
+    resolve(g_slots[g_slot]);
+}
+
+const std::vector<GpuPassStats>& gpuPassStats(){
+    return g_stats;
+}
+
+size_t gpuTimerDroppedFrames(){
+    return g_dropped;
+}
+
+int gpuPassBegin(const char* name){
+    Slot &s = g_slots[g_slot];
+    Record r;
+    r.pass = passIndex(name);
+    r.begin = takeQuery(s);
+    r.end = 0;
+    glQueryCounter(r.begin, GL_TIMESTAMP);
+    s.records.push_back(r);
+    return (int)s.records.size() - 1;
+}
+
+void gpuPassEnd(int record){
+    Slot &s = g_slots[g_slot];
+    if(record >= (int)s.records.size()) return;
+    GLuint q = takeQuery(s);
+    glQueryCounter(q, GL_TIMESTAMP);
+    s.records[record].end = q;
+}
+
+void shutdownGpuTimers(){
+    for(auto &s : g_slots){
+        if(!s.pool.empty()) glDeleteQueries((GLsizei)s.pool.size(), s.pool.data());
+        s.pool.clear();
+        resetSlot(s);
+    }
+    g_enabled = false;
+}
@@ -0,0 +1,46 @@
+//gpu_timer.h
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// GPU time per render pass from GL_TIMESTAMP query pairs. Queries are issued into
+// one of GPU_TIMER_FRAMES per-frame slots and only read back when that slot comes
+// round again, after checking GL_QUERY_RESULT_AVAILABLE, so the CPU never waits on
+// the GPU. Timestamps (rather than GL_TIME_ELAPSED) allow passes to nest, e.g. the
+// individual draws inside drawScene. Requires a current GL 3.3 context.
+
+struct GpuPassStats{
+    const char* name;
+    double lastMs;          // summed over the pass's calls in the last resolved frame
+    double p50Ms, p99Ms;    // over the last GPU_TIMER_WINDOW resolved frames
+};
+
+const int GPU_TIMER_FRAMES = 4;
+const int GPU_TIMER_WINDOW = 240;
+
+void setGpuTimersEnabled(bool enabled);
+bool gpuTimersEnabled();
+
+// once per frame, before the first pass: resolves the slot issued GPU_TIMER_FRAMES frames ago
+void gpuTimerBeginFrame();
+const std::vector<GpuPassStats>& gpuPassStats();
+size_t gpuTimerDroppedFrames();     // slots whose results were still pending when reused
+void shutdownGpuTimers();
+
+int gpuPassBegin(const char* name);
+void gpuPassEnd(int record);
+
+class GpuPassScope{
+public:
+    explicit GpuPassScope(const char* name) : record(gpuTimersEnabled() ? gpuPassBegin(name) : -1) {}
+    ~GpuPassScope(){ if(record >= 0) gpuPassEnd(record); }
+    GpuPassScope(const GpuPassScope&) = delete;
+    GpuPassScope& operator=(const GpuPassScope&) = delete;
+private:
+    int record;
+};
+
+#define GPU_PASS_CONCAT_(a, b) a##b
+#define GPU_PASS_CONCAT(a, b) GPU_PASS_CONCAT_(a, b)
+#define GPU_PASS_SCOPE(name) GpuPassScope GPU_PASS_CONCAT(gpuPassScope_, __LINE__)(name)
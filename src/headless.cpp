@@ -0,0 +1,181 @@
+//headless.cpp
+
+#include "headless.h"
+#include <GLEW/glew.h>
+#ifdef ML_VIS_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#include "renderer.h"
+#include "scene.h"
+#include "recorder.h"
+#include "frame_arena.h"
+#include "synth.h"
+#include "dataset_loader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+bool parseHeadlessArgs(int argc, char** argv, HeadlessOptions& opts){
+    bool headless = false;
+    for(int i=1;i<argc;++i){
+        auto next = [&](){ return i + 1 < argc ? argv[++i] : ""; };
+        if(!strcmp(argv[i], "--headless")) headless = true;
+        else if(!strcmp(argv[i], "--dataset")) opts.dataset = next();
+        else if(!strcmp(argv[i], "--out")) opts.outDir = next();
+        else if(!strcmp(argv[i], "--synthetic")) opts.synthetic = next();
+        else if(!strcmp(argv[i], "--x")) opts.schema.x = parseCsvColumn(next());
+        else if(!strcmp(argv[i], "--y")) opts.schema.y = parseCsvColumn(next());
+        else if(!strcmp(argv[i], "--label")) opts.schema.label = parseCsvColumn(next());
+        else if(!strcmp(argv[i], "--epochs")) opts.epochs = atoi(next());
+        else if(!strcmp(argv[i], "--frame-every")) opts.frameEvery = atoi(next());
+        else if(!strcmp(argv[i], "--lr")) opts.learningRate = (float)atof(next());
+        else if(!strcmp(argv[i], "--format")) opts.y4m = !strcmp(next(), "y4m");
+        else if(!strcmp(argv[i], "--size")){
+            if(sscanf(next(), "%dx%d", &opts.width, &opts.height) != 2) std::cerr << "--size expects WIDTHxHEIGHT\n";
+        }
+        else std::cerr << "Ignoring unknown argument: " << argv[i] << "\n";
+    }
+    return headless;
+}
+
+#ifdef ML_VIS_HAVE_EGL
+
+// Surfaceless EGL context with desktop GL 3.3 core, made current without any surface
+static bool createOffscreenContext(EGLDisplay& dpy, EGLContext& ctx){
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    dpy = EGL_NO_DISPLAY;
+    if(getPlatformDisplay) dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if(dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major = 0, minor = 0;
+    if(dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)){ std::cerr << "eglInitialize failed\n"; return false; }
+    if(!eglBindAPI(EGL_OPENGL_API)){ std::cerr << "eglBindAPI(EGL_OPENGL_API) failed\n"; return false; }
+
+    const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLint numConfigs = 0;
+    if(!eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs) || numConfigs < 1) config = EGL_NO_CONFIG_KHR;
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttribs);
+    if(ctx == EGL_NO_CONTEXT){ std::cerr << "eglCreateContext failed: 0x" << std::hex << eglGetError() << std::dec << "\n"; return false; }
+    if(!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)){ std::cerr << "eglMakeCurrent (surfaceless) failed\n"; return false; }
+    printf("headless: EGL %d.%d, GL %s\n", major, minor, (const char*)glGetString(GL_RENDERER));
+    return true;
+}
+
+bool createOffscreenGL(int w, int h, OffscreenGL& gl){
+    EGLDisplay dpy; EGLContext ctx;
+    if(!createOffscreenContext(dpy, ctx)) return false;
+    gl.display = dpy; gl.context = ctx;
+
+    // GLEW built for GLX reports a missing X display after loading the core entry points
+    glewExperimental = GL_TRUE;
+    GLenum glewErr = glewInit();
+    if(glewErr != GLEW_OK && glewErr != GLEW_ERROR_NO_GLX_DISPLAY){ std::cerr << "glew init failed\n"; destroyOffscreenGL(gl); return false; }
+
+    GLuint fbo = 0, color = 0;
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    gl.fbo = fbo; gl.color = color; gl.width = w; gl.height = h;
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){ std::cerr << "offscreen framebuffer incomplete\n"; destroyOffscreenGL(gl); return false; }
+    return true;
+}
+
+void destroyOffscreenGL(OffscreenGL& gl){
+    if(!gl.display) return;
+    EGLDisplay dpy = (EGLDisplay)gl.display;
+    if(gl.context){
+        if(gl.fbo){ GLuint fbo = gl.fbo; glDeleteFramebuffers(1, &fbo); }
+        if(gl.color){ GLuint color = gl.color; glDeleteRenderbuffers(1, &color); }
+        eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(dpy, (EGLContext)gl.context);
+    }
+    eglTerminate(dpy);
+    gl = OffscreenGL();
+}
+
+int runHeadless(const HeadlessOptions& opts){
+    std::vector<point2D> data;
+    if(!opts.synthetic.empty()){
+        SynthSpec spec;
+        if(!parseSynthSpec(opts.synthetic.c_str(), spec)){ std::cerr << "headless: bad --synthetic spec: " << opts.synthetic << "\n"; return 1; }
+        data = generateSynthetic(spec);
+    } else {
+        data = loadDataset(opts.dataset.c_str(), nullptr, nullptr, opts.schema);
+    }
+    if(data.empty()){ std::cerr << "headless: no data loaded from " << opts.dataset << "\n"; return 1; }
+
+    const int w = opts.width, h = opts.height;
+    OffscreenGL gl;
+    if(!createOffscreenGL(w, h, gl)) return 1;
+    const GLuint fbo = gl.fbo;
+
+    windowWidth = w; windowHeight = h;
+    initSceneRenderer(std::vector<Vertex>(), axesVertex());
+    Scene scene;
+    scene.setDataset(data);
+    LogisticModel model(opts.learningRate, std::max(1, countClasses(data)));
+    model.randomize();
+
+    // readbacks go through a PBO ring and are encoded on a separate thread
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    FrameRecorder recorder;
+    std::string outPath = opts.y4m ? opts.outDir + "/training.y4m" : opts.outDir;
+    if(!recorder.start(outPath, opts.y4m ? RECORD_Y4M : RECORD_PNG, w, h)){ destroyOffscreenGL(gl); return 1; }
+    int frames = 0;
+    auto renderFrame = [&](){
+        frameArena().reset();
+        scene.update(model, data, w, h);
+        uploadScene(scene);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, w, h);
+        glClearColor(0.06f, 0.07f, 0.09f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        drawScene(scene);
+        recorder.capture(model.epochs_trained);
+        ++frames;
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    renderFrame();
+    for(int e=1;e<=opts.epochs;++e){
+        model.train_epoch(data);
+        if((opts.frameEvery > 0 && e % opts.frameEvery == 0) || e == opts.epochs) renderFrame();
+    }
+    recorder.stop();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("headless: %d epochs, %d frames in %.2fs (%.1f frames/s), final loss %.4f -> %s\n",
+           model.epochs_trained, frames, secs, frames / std::max(secs, 1e-9), model.last_loss, outPath.c_str());
+
+    destroyOffscreenGL(gl);
+    return 0;
+}
+
+#else
+
+bool createOffscreenGL(int, int, OffscreenGL&){
+    std::cerr << "offscreen rendering needs EGL; this build was configured without it\n";
+    return false;
+}
+
+void destroyOffscreenGL(OffscreenGL&){}
+
+int runHeadless(const HeadlessOptions&){
+    std::cerr << "headless mode needs EGL; this build was configured without it\n";
+    return 1;
+}
+
+#endif
@@ -0,0 +1,39 @@
+//headless.h
+#pragma once
+
+#include <string>
+#include "dataset.h"
+
+// Batch rendering without a window or display: an offscreen EGL context
+// (surfaceless Mesa platform, which falls back to llvmpipe on GPU-less nodes)
+// drives the regular renderer passes into an FBO, trains for a fixed number
+// of epochs and records frames through the asynchronous FrameRecorder as a PNG
+// sequence or a Y4M stream. No vsync or buffer swaps are involved.
+
+struct HeadlessOptions{
+    std::string dataset = "../dataset/synthetic.csv";
+    CsvSchema schema;           // --x/--y/--label column picks
+    std::string synthetic;      // --synthetic SPEC: generated points instead of the dataset (see synth.h)
+    std::string outDir = "frames";
+    int epochs = 500;
+    int frameEvery = 10;        // write a frame every N epochs (0 = first and last only)
+    int width = 800, height = 600;
+    float learningRate = 0.8f;
+    bool y4m = false;           // --format y4m: <outDir>/training.y4m instead of PNG frames
+};
+
+// true when argv asks for headless mode (--headless); fills opts from the other flags
+bool parseHeadlessArgs(int argc, char** argv, HeadlessOptions& opts);
+// returns the process exit code
+int runHeadless(const HeadlessOptions& opts);
+
+// The offscreen GL 3.3 context on its own, current on the calling thread with an
+// RGBA8 framebuffer of the given size bound (also used by ml_bench render cases).
+struct OffscreenGL{
+    void* display = nullptr;    // EGLDisplay
+    void* context = nullptr;    // EGLContext
+    unsigned fbo = 0, color = 0;
+    int width = 0, height = 0;
+};
+bool createOffscreenGL(int width, int height, OffscreenGL& gl);
+void destroyOffscreenGL(OffscreenGL& gl);
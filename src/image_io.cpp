@@ -0,0 +1,93 @@
+//image_io.cpp
+
+#include "image_io.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <array>
+
+static uint32_t crc32(const unsigned char* data, size_t len, uint32_t crc = 0){
+    // built once on first use, thread-safely (PNGs are written on the recorder's encoder thread)
+    static const std::array<uint32_t, 256> table = []{
+        std::array<uint32_t, 256> t{};
+        for(uint32_t n=0;n<256;++n){
+            uint32_t c = n;
+            for(int k=0;k<8;++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for(size_t i=0;i<len;++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putBE32(std::vector<unsigned char>& out, uint32_t v){
+    out.push_back((unsigned char)(v >> 24)); out.push_back((unsigned char)(v >> 16));
+    out.push_back((unsigned char)(v >> 8));  out.push_back((unsigned char)v);
+}
+
+static void writeChunk(FILE* f, const char type[4], const std::vector<unsigned char>& data){
+    std::vector<unsigned char> buf;
+    buf.reserve(data.size() + 12);
+    putBE32(buf, (uint32_t)data.size());
+    buf.insert(buf.end(), type, type + 4);
+    buf.insert(buf.end(), data.begin(), data.end());
+    putBE32(buf, crc32(buf.data() + 4, data.size() + 4));
+    fwrite(buf.data(), 1, buf.size(), f);
+}
+
+// PNG with an uncompressed (stored) zlib stream: no compression cost, larger files
+bool writePNG(const char* filename, int width, int height, const unsigned char* rgba, bool flipY){
+    FILE* f = fopen(filename, "wb");
+    if(!f) return false;
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    fwrite(signature, 1, sizeof(signature), f);
+
+    std::vector<unsigned char> ihdr;
+    putBE32(ihdr, (uint32_t)width);
+    putBE32(ihdr, (uint32_t)height);
+    ihdr.push_back(8);  // bit depth
+    ihdr.push_back(6);  // RGBA
+    ihdr.push_back(0); ihdr.push_back(0); ihdr.push_back(0);
+    writeChunk(f, "IHDR", ihdr);
+
+    // raw scanlines, each prefixed with filter type 0
+    const size_t stride = (size_t)width * 4;
+    std::vector<unsigned char> raw;
+    raw.reserve((stride + 1) * height);
+    for(int y=0;y<height;++y){
+        const unsigned char* row = rgba + stride * (flipY ? height - 1 - y : y);
+        raw.push_back(0);
+        raw.insert(raw.end(), row, row + stride);
+    }
+
+    std::vector<unsigned char> idat;
+    idat.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    idat.push_back(0x78); idat.push_back(0x01);
+    uint32_t a = 1, b = 0;
+    for(size_t pos=0;pos<raw.size() || pos==0;){
+        size_t len = std::min<size_t>(65535, raw.size() - pos);
+        bool last = pos + len >= raw.size();
+        idat.push_back(last ? 1 : 0);
+        idat.push_back((unsigned char)(len & 0xff)); idat.push_back((unsigned char)(len >> 8));
+        idat.push_back((unsigned char)(~len & 0xff)); idat.push_back((unsigned char)((~len >> 8) & 0xff));
+        // Adler-32, reducing modulo 65521 only every 5552 bytes (zlib's NMAX)
+        for(size_t i=pos;i<pos+len;){
+            size_t n = std::min<size_t>(5552, pos + len - i);
+            for(size_t k=0;k<n;++k){ a += raw[i+k]; b += a; }
+            a %= 65521; b %= 65521;
+            i += n;
+        }
+        idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+        if(last) break;
+    }
+    putBE32(idat, (b << 16) | a);
+    writeChunk(f, "IDAT", idat);
+    writeChunk(f, "IEND", std::vector<unsigned char>());
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,8 @@
+//image_io.h
+#pragma once
+
+// Dependency-free image writers for captured frames.
+// Pixels are tightly packed RGBA8; with flipY the rows are bottom-up as
+// returned by glReadPixels and are written top-down.
+
+bool writePNG(const char* filename, int width, int height, const unsigned char* rgba, bool flipY = true);
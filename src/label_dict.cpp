@@ -0,0 +1,189 @@
+//label_dict.cpp
+
+#include "label_dict.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static uint64_t mix64(uint64_t h){
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t hashName(const char* p, size_t n){
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+    for(; n >= 8; p += 8, n -= 8){
+        uint64_t v;
+        memcpy(&v, p, 8);
+        h = (h ^ v) * 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 31;
+    }
+    uint64_t v = 0;
+    memcpy(&v, p, n);
+    return mix64(h ^ v);
+}
+
+static const size_t kNamesPerBucket = 4;
+
+void LabelDictionary::clear(){
+    names.clear();
+    hashes.clear();
+    table.clear();
+    displace.clear();
+    slotId.clear();
+    seed = 0;
+    isFrozen = false;
+}
+
+void LabelDictionary::growTable(){
+    std::vector<uint32_t> grown(std::max<size_t>(64, table.size() * 2), 0);
+    const size_t mask = grown.size() - 1;
+    for(size_t id=0;id<names.size();++id){
+        size_t s = hashes[id] & mask;
+        while(grown[s]) s = (s + 1) & mask;
+        grown[s] = (uint32_t)id + 1;
+    }
+    table.swap(grown);
+}
+
+size_t LabelDictionary::perfectBucket(uint64_t h) const{
+    return (size_t)(mix64(h ^ seed) >> 40) % displace.size();
+}
+
+size_t LabelDictionary::perfectSlot(uint64_t h, uint16_t d) const{
+    return (size_t)(mix64(h + seed + d * 0x9E3779B97F4A7C15ull) % names.size());
+}
+
+int LabelDictionary::find(const char* name, size_t len) const{
+    if(names.empty()) return -1;
+    uint64_t h = hashName(name, len);
+    if(isFrozen){
+        int id = slotId[perfectSlot(h, displace[perfectBucket(h)])];
+        return hashes[id] == h && names[id].size() == len && memcmp(names[id].data(), name, len) == 0 ? id : -1;
+    }
+    const size_t mask = table.size() - 1;
+    for(size_t s = h & mask; table[s]; s = (s + 1) & mask){
+        uint32_t id = table[s] - 1;
+        if(hashes[id] == h && names[id].size() == len && memcmp(names[id].data(), name, len) == 0) return (int)id;
+    }
+    return -1;
+}
+
+int LabelDictionary::intern(const char* name, size_t len){
+    if(isFrozen) return find(name, len);
+    if(table.empty()) growTable();
+    uint64_t h = hashName(name, len);
+    const size_t mask = table.size() - 1;
+    size_t s = h & mask;
+    for(; table[s]; s = (s + 1) & mask){
+        uint32_t id = table[s] - 1;
+        if(hashes[id] == h && names[id].size() == len && memcmp(names[id].data(), name, len) == 0) return (int)id;
+    }
+    if((int)names.size() >= MAX_LABELS) return -1;
+    int id = (int)names.size();
+    names.emplace_back(name, len);
+    hashes.push_back(h);
+    table[s] = (uint32_t)id + 1;
+    if(names.size() * 2 > table.size()) growTable();
+    return id;
+}
+
+void LabelDictionary::freeze(){
+    if(isFrozen) return;
+    table.clear();
+    table.shrink_to_fit();
+    isFrozen = true;
+    if(names.empty()) return;
+    // a bucket that fits nowhere within 16-bit displacements is practically
+    // impossible at this load; a new seed reshuffles all buckets if it happens
+    for(seed=0; !placeBuckets(); ++seed) {}
+}
+
+bool LabelDictionary::placeBuckets(){
+    const size_t n = names.size();
+    const size_t buckets = (n + kNamesPerBucket - 1) / kNamesPerBucket;
+    displace.assign(buckets, 0);
+    slotId.assign(n, 0);
+    std::vector<std::vector<uint32_t>> members(buckets);
+    for(size_t id=0;id<n;++id) members[perfectBucket(hashes[id])].push_back((uint32_t)id);
+    // place the biggest buckets first while most slots are still free
+    std::vector<uint32_t> bySize(buckets);
+    for(size_t b=0;b<buckets;++b) bySize[b] = (uint32_t)b;
+    std::stable_sort(bySize.begin(), bySize.end(), [&](uint32_t a, uint32_t b){ return members[a].size() > members[b].size(); });
+
+    std::vector<char> used(n, 0);
+    std::vector<size_t> slots;
+    for(uint32_t b : bySize){
+        const auto &m = members[b];
+        if(m.empty()) break;
+        // try displacements until every name of the bucket lands on its own free slot
+        for(uint32_t d=0;;++d){
+            if(d > 0xffff) return false;
+            slots.clear();
+            for(uint32_t id : m){
+                size_t s = perfectSlot(hashes[id], (uint16_t)d);
+                if(used[s] || std::find(slots.begin(), slots.end(), s) != slots.end()) break;
+                slots.push_back(s);
+            }
+            if(slots.size() == m.size()){ displace[b] = (uint16_t)d; break; }
+        }
+        for(size_t k=0;k<m.size();++k){ used[slots[k]] = 1; slotId[slots[k]] = (uint16_t)m[k]; }
+    }
+    return true;
+}
+
+static const char* kSidecarHeader = "#labels of ";
+
+bool LabelDictionary::save(const std::string& path, const std::string& column) const{
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    std::ofstream out(path, std::ios::binary);
+    if(!out) return false;
+    out << kSidecarHeader << column << '\n';
+    for(const auto &n : names) out << n << '\n';
+    return (bool)out;
+}
+
+bool LabelDictionary::load(const std::string& path, const std::string& column){
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    clear();
+    std::string line;
+    // sidecars without the header predate it and don't say which column they are for
+    if(!std::getline(in, line)) return false;
+    if(!line.empty() && line.back() == '\r') line.pop_back();
+    if(line != kSidecarHeader + column) return false;
+    while(std::getline(in, line)){
+        if(!line.empty() && line.back() == '\r') line.pop_back();
+        if(intern(line) < 0) break;
+    }
+    if(names.empty()) return false;
+    freeze();
+    return true;
+}
+
+static std::filesystem::path cacheDir(){
+    const char* dir = getenv("ML_VIS_CACHE_DIR");
+    if(dir && *dir) return dir;
+    if((dir = getenv("XDG_CACHE_HOME")) && *dir) return std::filesystem::path(dir) / "ml_visualizer";
+    if((dir = getenv("LOCALAPPDATA")) && *dir) return std::filesystem::path(dir) / "ml_visualizer";
+    if((dir = getenv("HOME")) && *dir) return std::filesystem::path(dir) / ".cache" / "ml_visualizer";
+    std::error_code ec;
+    return std::filesystem::temp_directory_path(ec) / "ml_visualizer";
+}
+
+std::string labelSidecarPath(const std::string& datasetPath, const std::string& column){
+    // the same file reached by another relative path shares the dictionary
+    std::error_code ec;
+    std::filesystem::path file = std::filesystem::absolute(datasetPath, ec);
+    if(ec) file = datasetPath;
+    std::string key = file.lexically_normal().string() + '\n' + column;
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hashName(key.data(), key.size()));
+    return (cacheDir() / "labels" / (file.filename().string() + "-" + hex + ".labels")).string();
+}
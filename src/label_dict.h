@@ -0,0 +1,67 @@
+//label_dict.h
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Class names <-> dense label ids (stored as uint16_t in point2D).
+// While building, intern() adds names through an open-addressing hash table.
+// freeze() then replaces the table with a minimal perfect hash (hash and
+// displace: one 16-bit displacement per bucket of ~4 names), so later files
+// and appended rows resolve a name with two hashes and one string compare,
+// and names the dictionary does not know are reported instead of being
+// mislabeled. A frozen dictionary is read-only and safe to share between
+// parsing threads. The names are persisted one per line in a per-user cache
+// (see labelSidecarPath), after a line naming the column they came from, which
+// keeps label ids stable across loads of that column.
+class LabelDictionary{
+public:
+    static const int MAX_LABELS = 65535;
+
+    // id of name, added if new; -1 when frozen and unknown, or when full
+    int intern(const char* name, size_t len);
+    int intern(const std::string& name) { return intern(name.data(), name.size()); }
+    // id of name or -1
+    int find(const char* name, size_t len) const;
+    int find(const std::string& name) const { return find(name.data(), name.size()); }
+
+    void freeze();
+    bool frozen() const { return isFrozen; }
+    void clear();
+
+    int size() const { return (int)names.size(); }
+    const std::string& name(int id) const { return names[id]; }
+
+    // column describes the label column, e.g. "column 4"
+    bool save(const std::string& path, const std::string& column) const;
+    // replaces the contents; the loaded dictionary is frozen (false, and left
+    // empty and unfrozen, when the file is missing, has no names or was saved
+    // for another column)
+    bool load(const std::string& path, const std::string& column);
+
+private:
+    std::vector<std::string> names;
+    std::vector<uint64_t> hashes;       // per name
+
+    // building: open addressing on id+1 (0 = empty slot), at most half full
+    std::vector<uint32_t> table;
+    // frozen: bucket displacements and the name id of every perfect-hash slot
+    std::vector<uint16_t> displace;
+    std::vector<uint16_t> slotId;
+    uint64_t seed = 0;
+    bool isFrozen = false;
+
+    void growTable();
+    bool placeBuckets();
+    size_t perfectBucket(uint64_t h) const;
+    size_t perfectSlot(uint64_t h, uint16_t d) const;
+};
+
+// The dictionary file of one label column of a dataset. It lives in a per-user
+// cache, not next to the data (which may be read-only or shared):
+// $ML_VIS_CACHE_DIR, else $XDG_CACHE_HOME/ml_visualizer, ~/.cache/ml_visualizer
+// or %LOCALAPPDATA%\ml_visualizer, then labels/<file name>-<hash of the
+// absolute path and column>.labels.
+std::string labelSidecarPath(const std::string& datasetPath, const std::string& column);
@@ -0,0 +1,144 @@
+//loss_history.cpp
+
+#include "loss_history.h"
+#include "frame_arena.h"
+#include <algorithm>
+
+LossHistory::LossHistory(size_t recentCap, size_t levelCap, int maxLvls)
+    : recentCapacity(std::max<size_t>(recentCap, 1)),
+      levelCapacity(std::max<size_t>(levelCap & ~(size_t)1, 2)), // even, so a full level halves exactly
+      maxLevels(std::max(maxLvls, 1)){
+    recent.reserve(recentCapacity);
+}
+
+void LossHistory::clear(){
+    recent.clear();
+    recentHead = 0;
+    total = 0;
+    lastValue = 0.0f;
+    levels.clear();
+}
+
+void LossHistory::merge(Bucket& into, const Bucket& b){
+    if(into.n == 0){ into = b; return; }
+    into.min = std::min(into.min, b.min);
+    into.max = std::max(into.max, b.max);
+    into.sum += b.sum;
+    into.n += b.n;
+}
+
+void LossHistory::push(float loss){
+    if(recent.size() < recentCapacity) recent.push_back(loss);
+    else { recent[recentHead] = loss; recentHead = (recentHead + 1) % recentCapacity; }
+    ++total;
+    lastValue = loss;
+
+    if(levels.empty()){
+        levels.emplace_back();
+        levels[0].width = 2;
+        levels[0].ring.resize(levelCapacity);
+    }
+    feed(0, Bucket{loss, loss, (double)loss, 1});
+}
+
+void LossHistory::feed(size_t level, const Bucket& b){
+    Bucket &p = levels[level].pending;
+    merge(p, b);
+    if(p.n < levels[level].width) return;
+    Bucket done = p;
+    p = Bucket{0.0f, 0.0f, 0.0, 0};
+    emit(level, done);
+}
+
+void LossHistory::emit(size_t level, const Bucket& b){
+    if(levels[level].count == levelCapacity && level + 1 == levels.size()){
+        // the coarsest level is full: it must keep covering the whole run
+        if((int)levels.size() < maxLevels){
+            // start a coarser level from pairs of this one; this level becomes a ring
+            Level next;
+            next.width = levels[level].width * 2;
+            next.start = levels[level].start;
+            next.ring.resize(levelCapacity);
+            for(size_t i=0;i<levelCapacity;i+=2){
+                Bucket m = bucketAt(levels[level], i);
+                merge(m, bucketAt(levels[level], i + 1));
+                next.ring[next.count++] = m;
+            }
+            levels.push_back(std::move(next));
+        } else {
+            // out of levels: merge neighbours in place and double the bucket width
+            Level &L = levels[level];
+            std::vector<Bucket> merged(levelCapacity);
+            for(size_t i=0;i<levelCapacity;i+=2){
+                Bucket m = bucketAt(L, i);
+                merge(m, bucketAt(L, i + 1));
+                merged[i / 2] = m;
+            }
+            L.ring.swap(merged);
+            L.head = 0;
+            L.count = levelCapacity / 2;
+            L.width *= 2;
+            // b is only half a bucket at the new width
+            merge(L.pending, b);
+            return;
+        }
+    }
+
+    Level &L = levels[level];
+    if(L.count < levelCapacity){
+        L.ring[(L.head + L.count) % levelCapacity] = b;
+        ++L.count;
+    } else {
+        L.ring[L.head] = b;
+        L.head = (L.head + 1) % levelCapacity;
+        L.start += L.width;
+    }
+    if(level + 1 < levels.size()) feed(level + 1, b);
+}
+
+void LossHistory::plot(int columns, uint64_t span, std::vector<Column>& out) const{
+    out.assign(std::max(columns, 0), Column{0.0f, 0.0f, 0.0f, false});
+    if(columns <= 0 || total == 0) return;
+    const uint64_t lo = (span == 0 || span >= total) ? 0 : total - span;
+    const uint64_t range = total - lo;
+    const uint64_t maxItems = (uint64_t)columns * 4;
+
+    FrameVector<double> sums(columns, 0.0);
+    FrameVector<uint64_t> counts(columns, 0);
+    auto add = [&](uint64_t s, const Bucket& b){
+        if(b.n == 0 || s + b.n <= lo) return;
+        size_t c = std::min((size_t)((std::max(s, lo) - lo) * (uint64_t)columns / range), (size_t)columns - 1);
+        Column &col = out[c];
+        if(!col.valid){ col.min = b.min; col.max = b.max; col.valid = true; }
+        else { col.min = std::min(col.min, b.min); col.max = std::max(col.max, b.max); }
+        sums[c] += b.sum;
+        counts[c] += b.n;
+    };
+
+    const uint64_t recentStart = total - recent.size();
+    if(recentStart <= lo && range <= maxItems){
+        // raw samples are available and sparse enough
+        for(size_t i=0;i<recent.size();++i){
+            float v = recent[(recentHead + i) % recent.size()];
+            add(recentStart + i, Bucket{v, v, (double)v, 1});
+        }
+    } else {
+        // finest level that reaches back to lo with at most maxItems buckets in range
+        size_t chosen = levels.size() - 1;
+        for(size_t i=0;i<levels.size();++i){
+            if(levels[i].start <= lo && range / levels[i].width <= maxItems){ chosen = i; break; }
+        }
+        const Level &L = levels[chosen];
+        uint64_t s = L.start;
+        for(size_t i=0;i<L.count;++i, s += L.width) add(s, bucketAt(L, i));
+        // the newest samples are still in the partial buckets of this and finer levels
+        for(size_t i=chosen + 1;i-- > 0;){
+            add(s, levels[i].pending);
+            s += levels[i].pending.n;
+        }
+    }
+
+    for(int c=0;c<columns;++c){
+        if(counts[c]) out[c].mean = (float)(sums[c] / (double)counts[c]);
+    }
+}
@@ -0,0 +1,55 @@
+//loss_history.h
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Loss per epoch for the whole run at bounded memory: a ring of raw recent
+// samples plus min/max/mean levels whose buckets double in width per level.
+// Each level is a ring; the coarsest one never drops data and instead merges
+// neighbouring buckets when full, so it always spans the entire run.
+// plot() picks the finest source that covers the requested range with at most
+// a few buckets per pixel column, so its cost depends on the plot width only.
+class LossHistory{
+public:
+    explicit LossHistory(size_t recentCapacity = 4096, size_t levelCapacity = 1024, int maxLevels = 24);
+
+    void push(float loss);
+    void clear();
+    uint64_t size() const { return total; }
+    float last() const { return lastValue; }
+
+    struct Column{ float min, max, mean; bool valid; };
+    // min/max/mean per column over the last `span` samples (0 = whole run);
+    // scratch comes from frameArena()
+    void plot(int columns, uint64_t span, std::vector<Column>& out) const;
+
+private:
+    struct Bucket{
+        float min, max;
+        double sum;
+        uint64_t n;            // samples merged into this bucket
+    };
+    struct Level{
+        uint64_t width = 0;    // samples per bucket
+        uint64_t start = 0;    // first sample covered by the oldest bucket
+        size_t head = 0;       // index of the oldest bucket in ring
+        size_t count = 0;
+        std::vector<Bucket> ring;
+        Bucket pending{0.0f, 0.0f, 0.0, 0};
+    };
+
+    size_t recentCapacity, levelCapacity;
+    int maxLevels;
+    std::vector<float> recent;  // ring of raw samples
+    size_t recentHead = 0;
+    uint64_t total = 0;
+    float lastValue = 0.0f;
+    std::vector<Level> levels;  // levels[0].width = 2
+
+    static void merge(Bucket& into, const Bucket& b);
+    void feed(size_t level, const Bucket& b);
+    void emit(size_t level, const Bucket& b);
+    const Bucket& bucketAt(const Level& L, size_t i) const { return L.ring[(L.head + i) % L.ring.size()]; }
+};
@@ -10,25 +10,130 @@
 #include "renderer.h"
 #include "dataset.h"
 #include "model.h"
+#include "scene.h"
+#include "headless.h"
+#include "recorder.h"
+#include "loss_history.h"
+#include "weight_history.h"
+#include "profiler.h"
+#include "gpu_timer.h"
+#include "frame_arena.h"
+#include "thread_pool.h"
+#include "palette.h"
+#include "synth.h"
+#include "dataset_loader.h"
+#include "csv_tail.h"
 #include <fstream>
 #include <cmath>
+#include <cstring>
+#include <cstdlib>
 
 std::vector<point2D> irisData;
-std::vector<Vertex> irisVertices;
+LabelDictionary labels;     // class names of irisData
+FeatureScaling scaling;     // raw feature <-> model space mapping of irisData
 std::vector<Vertex> axisVertices;
 std::vector<Vertex> testVertices;
 
+// Per-phase CPU timings (p50/p99 over the last PROFILER_WINDOW frames) and trace capture
+static void drawProfilerWindow(){
+    ImGui::Begin("Profiler");
+    bool enabled = profilerEnabled();
+    if(ImGui::Checkbox("Enabled", &enabled)) setProfilerEnabled(enabled);
+    ImGui::SameLine();
+    if(!profilerTracing()){
+        if(ImGui::Button("Capture Trace")){ setProfilerEnabled(true); startProfilerTrace(); }
+    } else if(ImGui::Button("Save Trace")){
+        if(writeProfilerTrace("profile_trace.json")) std::cout << "Wrote profile_trace.json" << std::endl;
+        else std::cout << "Failed to write profile_trace.json" << std::endl;
+    }
+    if(profilerDroppedEvents()){ ImGui::SameLine(); ImGui::Text("(%zu events dropped)", profilerDroppedEvents()); }
+    if(enabled && ImGui::BeginTable("phases", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)){
+        ImGui::TableSetupColumn("Phase");
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("p50 ms");
+        ImGui::TableSetupColumn("p99 ms");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableHeadersRow();
+        for(const PhaseStats &s : profilerStats()){
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(s.name);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.lastMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.p50Ms);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.p99Ms);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", s.callsPerFrame);
+        }
+        ImGui::EndTable();
+    }
+
+    // heap allocations per frame; a steady frame (nothing loaded or resized) should show 0
+    const AllocStats &allocs = profilerAllocStats();
+    if(enabled){
+        ImGui::Text("Allocations: %llu (%llu bytes) last frame, %.1f avg, %llu max",
+                    (unsigned long long)allocs.lastAllocs, (unsigned long long)allocs.lastBytes,
+                    allocs.meanAllocs, (unsigned long long)allocs.maxAllocs);
+        const FrameArena &arena = frameArena();
+        ImGui::Text("Frame arena: %zu KB peak of %zu KB in %zu block(s)",
+                    arena.highWater() / 1024, arena.capacity() / 1024, arena.blockCount());
+    }
+
+    // GPU time per pass next to the CPU time of the same call: tells GPU-bound from CPU-bound passes
+    bool gpu = gpuTimersEnabled();
+    if(ImGui::Checkbox("GPU Timers", &gpu)) setGpuTimersEnabled(gpu);
+    if(gpu && gpuTimerDroppedFrames()){ ImGui::SameLine(); ImGui::Text("(%zu frames dropped)", gpuTimerDroppedFrames()); }
+    if(gpu && ImGui::BeginTable("gpu_passes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)){
+        ImGui::TableSetupColumn("Pass");
+        ImGui::TableSetupColumn("GPU last ms");
+        ImGui::TableSetupColumn("GPU p50 ms");
+        ImGui::TableSetupColumn("GPU p99 ms");
+        ImGui::TableSetupColumn("CPU p50 ms");
+        ImGui::TableHeadersRow();
+        for(const GpuPassStats &s : gpuPassStats()){
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(s.name);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.lastMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.p50Ms);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.p99Ms);
+            ImGui::TableNextColumn();
+            const PhaseStats* cpu = nullptr;
+            for(const PhaseStats &c : profilerStats()) if(strcmp(c.name, s.name) == 0){ cpu = &c; break; }
+            if(cpu) ImGui::Text("%.3f", cpu->p50Ms); else ImGui::TextUnformatted("-");
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+
+// name of a class label for the UI (models loaded from disk may have more classes than the data)
+static const char* className(int c){
+    static char fallback[32];
+    if(c >= 0 && c < labels.size()) return labels.name(c).c_str();
+    snprintf(fallback, sizeof(fallback), "class %d", c);
+    return fallback;
+}
+
+// one line per class in its palette color
+static void showClassProbs(const std::vector<float>& probs){
+    for(int c=0;c<(int)probs.size();++c){
+        float r, g, b;
+        classColor(c, r, g, b);
+        ImGui::TextColored(ImVec4(r, g, b, 1.0f), "%s: %.3f", className(c), probs[c]);
+    }
+}
+
+int main(int argc, char** argv) {
 
-int main() {
+    // Batch mode: offscreen rendering without a window (see headless.h)
+    HeadlessOptions headless;
+    if(parseHeadlessArgs(argc, argv, headless)) return runHeadless(headless);
 
     std::cout << "Loading dataset..." << std::endl;
-    irisData = LoadIrisDataset("../dataset/synthetic.csv");
-    std::cout << "Loaded " << irisData.size() << " data points" << std::endl;
+    irisData = LoadIrisDataset("../dataset/synthetic.csv", &labels, &scaling);
+    std::cout << "Loaded " << irisData.size() << " data points, " << labels.size() << " classes" << std::endl;
     
-    irisVertices = irisToVertex(irisData);
     axisVertices = axesVertex();
-    // Initialize logistic model (Setosa vs others)
-    LogisticModel model(0.8f);
+    // Initialize the softmax model with one weight row per class in the data
+    LogisticModel model(0.8f, std::max(1, countClasses(irisData)));
     model.randomize();
     
     // Initialize GLFW
@@ -49,8 +154,11 @@ int main() {
         return -1;
     }
 
-    // Setup ImGui (after GL context + GLEW)
+    // Setup ImGui (after GL context + GLEW); its allocations show up in the profiler's counters
     IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(
+        [](size_t size, void*) -> void* { profilerCountAlloc(size); return malloc(size); },
+        [](void* ptr, void*){ free(ptr); });
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     ImGui::StyleColorsDark();
@@ -58,118 +166,284 @@ int main() {
     ImGui_ImplOpenGL3_Init("#version 330");
 
     // Now initialize our GL resources (VAO/VBO etc.)
-    initRenderer(irisVertices, axisVertices);
+    initSceneRenderer(std::vector<Vertex>(), axisVertices);
     // initialize test point buffer (small fixed capacity)
     initTestPoints(64);
-    // initialize intersection marker buffer
-    initIntersections(8);
 
     // Dataset selector state
-    const char* datasetFiles[] = { "iris.csv", "synthetic.csv", "synthetic_nonlinear.csv" };
+    // files from dataset/, then the in-process generators (see synth.h)
+    const char* datasetFiles[] = { "iris.csv", "synthetic.csv", "synthetic_nonlinear.csv",
+                                   "Generated: blobs", "Generated: rings", "Generated: spirals", "Generated: xor", "Generated: moons" };
+    const int numDatasetFiles = 3;
     static int datasetIndex = 1; // default to synthetic
+    static SynthSpec synthSpec;
     static bool randomizeOnLoad = true;
-
-    // Initialize background grid and loss plot
-    const int GRID_COLS = 80;
-    const int GRID_ROWS = 80;
-    initBackgroundGrid(GRID_COLS, GRID_ROWS);
-    initLossPlot(512);
-
-    std::vector<float> lossHistory;
-    lossHistory.reserve(512);
-
-    // Initial boundary update (3 pairwise lines -> 6 vertices)
-    std::vector<Vertex> initialLines;
-    initialLines.reserve(6);
-    for(int i=0;i<3;++i){
-        initialLines.push_back({-1.0f, 0.0f, 1,1,0});
-        initialLines.push_back({ 1.0f, 0.0f, 1,1,0});
-    }
-    updateBoundaryLines(initialLines);
+    static int normalizeMode = NORM_MINMAX;
+    static bool followFile = false;
+
+    // Per-frame visualization state: view, visible points, background, boundaries
+    Scene scene;
+    scene.setDataset(irisData);
+    // The scene passes run while the UI is built, so the UI edits its own copies of the
+    // view and options; they reach the scene before the next frame's passes start
+    ViewTransform view = scene.view;
+    SceneOptions opts = scene.opts;
+    bool visibleDirty = false, densityDirty = false;
+    int refineDepth = scene.field.maxDepth;
+    bool reloadDataset = false;
+    bool rescaleDataset = false;            // Load Model: the points move to the model's scaling
+    FeatureScaling rescaleTo;               // once the passes reading them are done
+    DatasetLoader loader;
+    CsvTail tail;                           // follow mode: rows appended to the loaded CSV
+
+    // Loss of every epoch at bounded memory; the plot is decimated to its pixel width
+    LossHistory lossHistory;
+    std::vector<LossHistory::Column> lossColumns;
+    std::vector<Vertex> lossVerts;
+    static int lossSpan = 0;
+
+    // Per-epoch weights for the timeline; a scrubbed snapshot is rendered from a model copy
+    WeightHistory weightHistory;
+    LogisticModel snapshotModel;
+    int snapshotEpoch = -1;     // scrubEpoch the snapshot was looked up for; -1 after the history is cleared
+    const LogisticModel* shownModel = &model;
+    static bool scrubbing = false;
+    static int scrubEpoch = 0;
+
+    // Training video capture (asynchronous PBO readback + encoder thread)
+    FrameRecorder recorder;
+    int recordFormat = RECORD_PNG;
+    int fbWidth = 0, fbHeight = 0;
 
     while (!glfwWindowShouldClose(window)){
+        // Per-frame temporaries from the previous frame are dead by now
+        frameArena().reset();
+
         // Poll events first
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE("glfwPollEvents");
+            glfwPollEvents();
+        }
+
+        // Resolve GPU pass timings issued GPU_TIMER_FRAMES frames ago (never waits)
+        gpuTimerBeginFrame();
+
+        // Training step(s)
+        static bool paused = false;
+        static int epochsPerFrame = 1;
+        if(!paused && epochsPerFrame > 0){
+            for(int e=0;e<epochsPerFrame;++e){
+                PROFILE_SCOPE("train_epoch");
+                model.train_epoch(irisData);
+                // Append loss to history per epoch
+                lossHistory.push(model.last_loss);
+                weightHistory.push(model.epochs_trained, model.last_loss, &model.W[0][0], model.weightCount());
+            }
+        }
 
-        // Start the ImGui frame
+        // Start this frame's CPU passes (background, visible points, boundaries, contours,
+        // density) on the pool; they run on a copy of the shown model's weights while the UI is built
+        int display_w, display_h;
+        glfwGetFramebufferSize(window, &display_w, &display_h);
+        // a recording is tied to the framebuffer size it started with
+        if(recorder.recording() && (display_w != fbWidth || display_h != fbHeight)) recorder.stop();
+        fbWidth = display_w; fbHeight = display_h;
+        scene.view = view;
+        scene.opts = opts;
+        scene.visibleDirty |= visibleDirty;
+        scene.densityDirty |= densityDirty;
+        scene.field.maxDepth = refineDepth;
+        visibleDirty = densityDirty = false;
+        // what the UI shows from the previous passes, read before the scene is handed over
+        const size_t fieldEvals = scene.field.evaluations, fieldCells = scene.field.cells, fieldUniform = scene.field.uniformEquivalent();
+        const size_t contourLines = scene.contours.lines.size(), dirtyTiles = scene.contours.dirtyTiles;
+        const size_t visibleCount = scene.visibleIdx.size();
+        const int visibleLevel = scene.visibleLevel;
+        scene.beginUpdate(*shownModel, irisData, display_w, display_h);
+
+        // Start the ImGui frame (timed until ImGui::Render as "ImGui build")
+        uint64_t uiStart = profilerEnabled() ? profilerNowNs() : 0;
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // Mouse wheel zooms about the cursor, left-drag pans (unless ImGui owns the mouse)
+        if(!io.WantCaptureMouse && io.DisplaySize.x > 0.0f && io.DisplaySize.y > 0.0f){
+            float ndcX = io.MousePos.x / io.DisplaySize.x * 2.0f - 1.0f;
+            float ndcY = 1.0f - io.MousePos.y / io.DisplaySize.y * 2.0f;
+            if(io.MouseWheel != 0.0f){
+                float px = view.cx + ndcX / view.zoom, py = view.cy + ndcY / view.zoom;
+                view.zoom = std::min(10000.0f, std::max(0.05f, view.zoom * std::pow(1.15f, io.MouseWheel)));
+                view.cx = px - ndcX / view.zoom; view.cy = py - ndcY / view.zoom;
+                visibleDirty = true;
+            }
+            if(ImGui::IsMouseDragging(0) && (io.MouseDelta.x != 0.0f || io.MouseDelta.y != 0.0f)){
+                view.cx -= io.MouseDelta.x / io.DisplaySize.x * 2.0f / view.zoom;
+                view.cy += io.MouseDelta.y / io.DisplaySize.y * 2.0f / view.zoom;
+                visibleDirty = true;
+            }
+        }
+
         // Build UI (controls)
-        static bool paused = false;
-        static int epochsPerFrame = 1;
         static float lr_ui = model.lr;
 
         ImGui::Begin("Controls");
         // Dataset selector
         if(ImGui::Combo("Dataset", &datasetIndex, datasetFiles, IM_ARRAYSIZE(datasetFiles))){
-            // user changed selection; reload immediately
-            std::string path = std::string("../dataset/") + datasetFiles[datasetIndex];
-            auto newData = LoadIrisDataset(path.c_str());
-            if(!newData.empty()){
-                irisData = newData;
-                irisVertices = irisToVertex(irisData);
-                setPointVertices(irisVertices); // reallocate VBO for new size
-                if(randomizeOnLoad) model.randomize();
-                lossHistory.clear();
-            }
+            // user changed selection; loaded in the background, swapped in when ready
+            reloadDataset = true;
         }
         ImGui::SameLine();
         ImGui::Checkbox("Randomize on Load", &randomizeOnLoad);
+        if(datasetIndex >= numDatasetFiles){
+            int points = (int)synthSpec.count, seed = (int)synthSpec.seed;
+            ImGui::SliderInt("Classes", &synthSpec.classes, 1, 64);
+            ImGui::SliderInt("Points", &points, 100, 1000000000, "%d", ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderFloat("Noise", &synthSpec.noise, 0.0f, 0.5f);
+            ImGui::InputInt("Seed", &seed);
+            synthSpec.count = (uint64_t)std::max(1, points);
+            synthSpec.seed = (uint64_t)std::max(0, seed);
+            if(ImGui::Button("Generate")) reloadDataset = true;
+        } else {
+            // reloads so the initial load stops at a line boundary the tail continues from
+            if(ImGui::Checkbox("Follow File", &followFile)) reloadDataset = true;
+            if(tail.active()){
+                ImGui::SameLine();
+                ImGui::Text("+%llu rows", (unsigned long long)tail.rowsAppended);
+                if(tail.rowsSkipped){
+                    ImGui::SameLine();
+                    ImGui::Text("(%zu unknown labels skipped)", tail.rowsSkipped);
+                }
+            }
+        }
+        if(loader.running()){
+            ImGui::ProgressBar(loader.progress(), ImVec2(-80.0f, 0.0f), "Loading...");
+            ImGui::SameLine();
+            if(ImGui::Button("Cancel")) loader.cancel();
+        }
+        const char* normalizeModes[] = { "Min-Max", "Z-Score" };
+        if(ImGui::Combo("Normalization", &normalizeMode, normalizeModes, IM_ARRAYSIZE(normalizeModes))) reloadDataset = true;
+        // Point rendering: Auto switches to density above DENSITY_POINT_THRESHOLD points
+        const char* pointModes[] = { "Auto", "Points", "Density" };
+        const char* densityMappings[] = { "Log", "Histogram Eq." };
+        ImGui::Combo("Point Rendering", &opts.pointMode, pointModes, IM_ARRAYSIZE(pointModes));
+        if(ImGui::Combo("Density Mapping", &opts.densityMapping, densityMappings, IM_ARRAYSIZE(densityMappings))) densityDirty = true;
+        ImGui::Checkbox("Adaptive Background", &opts.adaptiveBackground);
+        if(opts.adaptiveBackground){
+            ImGui::SameLine();
+            ImGui::Text("%zu evals / %zu cells (uniform: %zu)", fieldEvals, fieldCells, fieldUniform);
+            ImGui::SliderInt("Refine Depth", &refineDepth, 0, 7);
+        }
+        ImGui::Checkbox("Contours", &opts.showContours);
+        if(opts.showContours){
+            ImGui::SameLine();
+            ImGui::Text("%zu lines, %zu dirty tiles", contourLines, dirtyTiles);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Region Boundaries", &opts.showRegionBoundaries);
+        if(ImGui::Button("Reset View")){ view = ViewTransform(); visibleDirty = true; }
+        ImGui::SameLine();
+        ImGui::Text("Zoom: %.2fx  Visible: %zu (level %d)", view.zoom, visibleCount, visibleLevel);
         ImGui::Text("Epoch: %d", model.epochs_trained);
         ImGui::Text("Loss: %.4f", model.last_loss);
+        ImGui::SliderInt("Loss Plot Epochs (0 = all)", &lossSpan, 0, 100000, "%d", ImGuiSliderFlags_Logarithmic);
+        // Timeline: show any stored epoch while training continues on the live model
+        // (the chosen model is shown from the next frame's passes on)
+        ImGui::Checkbox("Timeline", &scrubbing);
+        shownModel = &model;
+        if(scrubbing && !weightHistory.empty() && weightHistory.weightCount() == model.weightCount()){
+            ImGui::SameLine();
+            ImGui::SliderInt("##timeline", &scrubEpoch, weightHistory.oldest(), weightHistory.newest());
+            // only the weights, loss and epoch differ between snapshots: fetch them when the epoch does
+            if(scrubEpoch != snapshotEpoch || snapshotModel.numClasses != model.numClasses){
+                if(snapshotModel.numClasses != model.numClasses) snapshotModel.setClasses(model.numClasses);
+                snapshotModel.epochs_trained = weightHistory.lookup(scrubEpoch, &snapshotModel.W[0][0], &snapshotModel.last_loss);
+                snapshotEpoch = scrubEpoch;
+            }
+            shownModel = &snapshotModel;
+            ImGui::Text("Showing epoch %d (loss %.4f)", snapshotModel.epochs_trained, snapshotModel.last_loss);
+        }
         if(ImGui::SliderFloat("Learning Rate", &lr_ui, 0.0001f, 2.0f, "%.4f")){
             model.lr = lr_ui;
         }
         ImGui::SliderInt("Epochs / Frame", &epochsPerFrame, 0, 10);
         if(ImGui::Button(paused ? "Resume" : "Pause")) paused = !paused;
         ImGui::SameLine();
-        if(ImGui::Button("Randomize Model")) model.randomize();
-        if(ImGui::Button("Save Model")) model.save("model.bin");
+        if(ImGui::Button("Randomize Model")){
+            // a new run: the timeline and loss plot would otherwise mix in the discarded one
+            model.randomize();
+            lossHistory.clear();
+            weightHistory.clear();
+            snapshotEpoch = -1;
+        }
+        const char* recordFormats[] = { "PNG sequence", "Y4M video" };
+        if(!recorder.recording()) ImGui::Combo("Record Format", &recordFormat, recordFormats, IM_ARRAYSIZE(recordFormats));
+        if(ImGui::Button(recorder.recording() ? "Stop Recording" : "Record")){
+            if(recorder.recording()) recorder.stop();
+            else recorder.start(recordFormat == RECORD_Y4M ? "capture/training.y4m" : "capture", (RecordFormat)recordFormat, fbWidth, fbHeight, 60);
+        }
+        if(recorder.recording()){
+            ImGui::SameLine();
+            ImGui::Text("%zu captured, %zu written, %.3f ms/frame", recorder.framesCaptured, recorder.framesWritten.load(), recorder.lastCaptureMs);
+        }
+        if(ImGui::Button("Save Model")){
+            if(model.save("model.bin")) scaling.save(scalingSidecarPath("model.bin"));
+        }
         ImGui::SameLine();
         if(ImGui::Button("Load Model")){
-            if(model.load("model.bin")) lr_ui = model.lr;
+            if(model.load("model.bin")){
+                lr_ui = model.lr;
+                // the weights expect features scaled as when they were saved: rescale the points to match
+                FeatureScaling saved;
+                if(saved.load(scalingSidecarPath("model.bin")) && (saved.mode != scaling.mode ||
+                   saved.offset[0] != scaling.offset[0] || saved.scale[0] != scaling.scale[0] ||
+                   saved.offset[1] != scaling.offset[1] || saved.scale[1] != scaling.scale[1])){
+                    rescaleTo = saved;
+                    rescaleDataset = true;
+                }
+            }
         }
         ImGui::End();
 
         // Test point UI
         ImGui::Begin("Test Point");
         static float test_x = 0.0f, test_y = 0.0f;
-        ImGui::SliderFloat("Petal Length (-1..1)", &test_x, -1.0f, 1.0f);
-        ImGui::SliderFloat("Petal Width (-1..1)", &test_y, -1.0f, 1.0f);
-        static char last_pred_name[32] = "-";
-        static float last_probs[3] = {0.0f, 0.0f, 0.0f};
+        // model-space sliders over the data's range (min-max scaling gives -1..1, z-score doesn't)
+        float testRange[2][2];
+        for(int a=0;a<2;++a){
+            const ColumnStats &c = scaling.stats[a];
+            bool known = c.count > 0.0 && c.max > c.min;
+            testRange[a][0] = known ? scaling.normalize(a, c.min) : -1.0f;
+            testRange[a][1] = known ? scaling.normalize(a, c.max) : 1.0f;
+        }
+        ImGui::SliderFloat((scaling.names[0] + "##test_x").c_str(), &test_x, testRange[0][0], testRange[0][1]);
+        ImGui::SliderFloat((scaling.names[1] + "##test_y").c_str(), &test_y, testRange[1][0], testRange[1][1]);
+        static char last_pred_name[64] = "-";
+        static std::vector<float> last_probs;
         if(ImGui::Button("Predict")){
-            auto p = model.predict_probs(test_x, test_y);
+            std::vector<float> p = model.predict_probs(test_x, test_y);
             int pred = model.predict_label(test_x, test_y);
-            const char* name = (pred==0) ? "Setosa" : (pred==1) ? "Versicolor" : "Virginica";
-            // Map normalized slider values back to original petal scale used when loading the dataset
-            float petalLength_cm = ((test_x + 1.0f) * 0.5f) * (6.9f - 1.0f) + 1.0f;
-            float petalWidth_cm = ((test_y + 1.0f) * 0.5f) * (2.5f - 0.1f) + 0.1f;
+            const char* name = className(pred);
+            // Map normalized slider values back through the dataset's own scaling
+            float rawX = scaling.denormalize(0, test_x);
+            float rawY = scaling.denormalize(1, test_y);
 
             // store last prediction for persistent display
             strncpy(last_pred_name, name, sizeof(last_pred_name)-1);
             last_pred_name[sizeof(last_pred_name)-1] = '\0';
-            last_probs[0] = p[0]; last_probs[1] = p[1]; last_probs[2] = p[2];
+            last_probs = p;
 
             ImGui::Text("Predicted: %s", name);
             ImGui::Text("Normalized (x,y): (%.3f, %.3f)", test_x, test_y);
-            ImGui::Text("Original scale: Petal Length = %.2f cm, Petal Width = %.2f cm", petalLength_cm, petalWidth_cm);
-            ImGui::Text("%s (blue): %.3f", "Setosa", p[0]);
-            ImGui::Text("%s (green): %.3f", "Versicolor", p[1]);
-            ImGui::Text("%s (red): %.3f", "Virginica", p[2]);
+            ImGui::Text("Original scale: %s = %.4g, %s = %.4g", scaling.names[0].c_str(), rawX, scaling.names[1].c_str(), rawY);
+            showClassProbs(p);
         }
         ImGui::SameLine();
         if(ImGui::Button("Add To Plot")){
             // add a test vertex colored by predicted label
-            auto p = model.predict_probs(test_x, test_y);
-            int pred = model.predict_label(test_x, test_y);
             Vertex v;
             v.x = test_x; v.y = test_y;
-            if(pred == 0){ v.r = 0.0f; v.g = 0.0f; v.b = 1.0f; }
-            else if(pred == 1){ v.r = 0.0f; v.g = 1.0f; v.b = 0.0f; }
-            else { v.r = 1.0f; v.g = 0.0f; v.b = 0.0f; }
+            classColor(model.predict_label(test_x, test_y), v.r, v.g, v.b);
             testVertices.push_back(v);
             // limit
             if(testVertices.size() > 64) testVertices.erase(testVertices.begin());
@@ -211,180 +485,127 @@ int main() {
         // Persistent display of last prediction below the controls
         ImGui::Begin("Last Prediction");
         ImGui::Text("Predicted class: %s", last_pred_name);
-        ImGui::Text("%s (blue): %.3f", "Setosa", last_probs[0]);
-        ImGui::Text("%s (green): %.3f", "Versicolor", last_probs[1]);
-        ImGui::Text("%s (red): %.3f", "Virginica", last_probs[2]);
+        showClassProbs(last_probs);
         ImGui::End();
 
-        // Training step(s)
-        if(!paused && epochsPerFrame > 0){
-            for(int e=0;e<epochsPerFrame;++e){
-                model.train_epoch(irisData);
-                // Append loss to history per epoch
-                lossHistory.push_back(model.last_loss);
-                if(lossHistory.size() > 512) lossHistory.erase(lossHistory.begin());
-            }
-        }
-
-        // Update background confidence grid: compute probs for a regular grid
-        std::vector<Vertex> bg; bg.reserve(GRID_COLS * GRID_ROWS);
-        for(int r=0;r<GRID_ROWS;++r){
-            for(int c=0;c<GRID_COLS;++c){
-                float nx = (float)c / (GRID_COLS-1) * 2.0f - 1.0f; // -1..1
-                float ny = (float)r / (GRID_ROWS-1) * 2.0f - 1.0f; // -1..1
-                auto probs = model.predict_probs(nx, ny);
-                // color blend by probability weighted sum of class colors
-                float cr = probs[0]*0.0f + probs[1]*0.0f + probs[2]*1.0f; // class2 red
-                float cg = probs[0]*0.0f + probs[1]*1.0f + probs[2]*0.0f; // class1 green
-                float cb = probs[0]*1.0f + probs[1]*0.0f + probs[2]*0.0f; // class0 blue
-                Vertex v = { nx, ny, cr, cg, cb };
-                bg.push_back(v);
-            }
-        }
-        updateBackgroundGrid(bg);
+        drawProfilerWindow();
+        if(uiStart) profilerRecord("ImGui build", uiStart, profilerNowNs());
 
-        // Rebuild vertex array colored by multiclass predicted label
-        for(size_t i=0;i<irisData.size();++i){
-            Vertex v;
-            v.x = irisData[i].x; v.y = irisData[i].y;
-            int pred = model.predict_label(irisData[i].x, irisData[i].y);
-            if(pred == 0){ v.r = 0.0f; v.g = 0.0f; v.b = 1.0f; }     // class 0 -> Blue
-            else if(pred == 1){ v.r = 0.0f; v.g = 1.0f; v.b = 0.0f; } // class 1 -> Green
-            else { v.r = 1.0f; v.g = 0.0f; v.b = 0.0f; }             // class 2 -> Red
-            irisVertices[i] = v;
-        }
-        updateVertices(irisVertices);
-
-        // Update decision boundary lines for each pair of classes (i,j)
-        struct LineEq{ float A,B,C; float r,g,b; };
-        std::vector<LineEq> lineEqs;
-        lineEqs.reserve(3);
-        for(int i=0;i<3;++i){
-            for(int j=i+1;j<3;++j){
-                float db = model.W[i][0] - model.W[j][0];
-                float dwx = model.W[i][1] - model.W[j][1];
-                float dwy = model.W[i][2] - model.W[j][2];
-                // Line: A*x + B*y + C = 0  (A = dwx, B = dwy, C = db)
-                LineEq L; L.A = dwx; L.B = dwy; L.C = db;
-                // choose color per pair for clarity
-                if(i==0 && j==1){ L.r=0.0f; L.g=1.0f; L.b=1.0f; } // cyan (0 vs 1)
-                else if(i==0 && j==2){ L.r=1.0f; L.g=0.0f; L.b=1.0f; } // magenta (0 vs 2)
-                else { L.r=1.0f; L.g=1.0f; L.b=0.0f; } // yellow (1 vs 2)
-                lineEqs.push_back(L);
-            }
+        // Render UI to get draw data
+        {
+            PROFILE_SCOPE("ImGui::Render");
+            ImGui::Render();
         }
 
-        // Clip each infinite line to the view rectangle [-1,1] x [-1,1]
-        std::vector<Vertex> lines; lines.reserve(6);
-        auto within = [](float v, float a, float b){ return v >= a - 1e-6f && v <= b + 1e-6f; };
-        for(const auto &L : lineEqs){
-            std::vector<std::pair<float,float>> pts;
-            // intersect with x = -1 and x = +1 (if B != 0 compute y)
-            if(fabs(L.B) > 1e-8f){
-                for(float xEdge : {-1.0f, 1.0f}){
-                    float y = -(L.C + L.A * xEdge) / L.B;
-                    if(within(y, -1.0f, 1.0f)) pts.emplace_back(xEdge, y);
+        // The GL upload is the only step that has to wait for the scene passes
+        scene.endUpdate();
+        if(rescaleDataset){
+            rescaleDataset = false;
+            ThreadPool::instance().parallel_for(irisData.size(), 65536, [&](size_t b, size_t e){
+                for(size_t i=b;i<e;++i){
+                    irisData[i].x = rescaleTo.normalize(0, scaling.denormalize(0, irisData[i].x));
+                    irisData[i].y = rescaleTo.normalize(1, scaling.denormalize(1, irisData[i].y));
                 }
-            }
-            // intersect with y = -1 and y = +1 (if A != 0 compute x)
-            if(fabs(L.A) > 1e-8f){
-                for(float yEdge : {-1.0f, 1.0f}){
-                    float x = -(L.C + L.B * yEdge) / L.A;
-                    if(within(x, -1.0f, 1.0f)) pts.emplace_back(x, yEdge);
-                }
-            }
-            // Remove duplicates (within eps)
-            auto dedup = [&](std::vector<std::pair<float,float>>& v){
-                std::vector<std::pair<float,float>> out;
-                for(auto &p : v){
-                    bool found=false;
-                    for(auto &q : out) if(fabs(p.first-q.first)<1e-4f && fabs(p.second-q.second)<1e-4f) { found=true; break; }
-                    if(!found) out.push_back(p);
-                }
-                v.swap(out);
-            };
-            dedup(pts);
-            if(pts.size() >= 2){
-                // pick first two
-                auto a = pts[0]; auto b = pts[1];
-                lines.push_back({a.first, a.second, L.r, L.g, L.b});
-                lines.push_back({b.first, b.second, L.r, L.g, L.b});
+            });
+            for(int a=0;a<2;++a){ scaling.offset[a] = rescaleTo.offset[a]; scaling.scale[a] = rescaleTo.scale[a]; }
+            scaling.mode = normalizeMode = rescaleTo.mode;
+            scene.setDataset(irisData);
+            scene.update(*shownModel, irisData, display_w, display_h);
+            std::cout << "Rescaled the dataset to the feature scaling of model.bin" << std::endl;
+        }
+        if(reloadDataset){
+            reloadDataset = false;
+            DatasetRequest request;
+            request.normalize = normalizeMode;
+            if(datasetIndex >= numDatasetFiles){
+                // generated points are already in model space; the scaling stays the identity
+                request.synthetic = true;
+                request.spec = synthSpec;
+                request.spec.shape = datasetIndex - numDatasetFiles;
             } else {
-                // line not visible in viewport; push offscreen to avoid drawing
-                lines.push_back({10.0f,10.0f,L.r,L.g,L.b});
-                lines.push_back({10.0f,10.0f,L.r,L.g,L.b});
+                request.path = std::string("../dataset/") + datasetFiles[datasetIndex];
+                request.follow = followFile;
             }
+            loader.start(request);
         }
-
-        // Compute analytic intersections between the three pairwise lines and display markers inside view
-        std::vector<Vertex> inters; inters.reserve(3);
-        for(size_t a=0;a<lineEqs.size();++a){
-            for(size_t b=a+1;b<lineEqs.size();++b){
-                const auto &L1 = lineEqs[a];
-                const auto &L2 = lineEqs[b];
-                float det = L1.A * L2.B - L2.A * L1.B;
-                if(fabs(det) < 1e-8f) continue; // parallel
-                float ix = (L1.B * L2.C - L2.B * L1.C) / det;
-                float iy = (L2.A * L1.C - L1.A * L2.C) / det;
-                if(within(ix, -1.0f, 1.0f) && within(iy, -1.0f, 1.0f)){
-                    // white marker
-                    inters.push_back({ix, iy, 1.0f, 1.0f, 1.0f});
-                }
+        // the current dataset keeps rendering and training until the new one is complete
+        LoadedDataset loaded;
+        if(loader.take(loaded)){
+            irisData.swap(loaded.data);
+            labels = std::move(loaded.labels);
+            scaling = loaded.scaling;
+            scene.setDataset(irisData, std::move(loaded.index));
+            // a different class count needs a fresh weight row per class
+            int classes = std::max(1, countClasses(irisData));
+            if(classes != model.numClasses){ model.setClasses(classes); model.randomize(); }
+            else if(randomizeOnLoad) model.randomize();
+            lossHistory.clear();
+            weightHistory.clear();
+            snapshotEpoch = -1;
+            if(loaded.request.follow && isCsvPath(loaded.request.path)) tail.open(loaded.request.path, loaded.tailOffset, loaded.request.schema);
+            else tail.close();
+            // rare: redo this frame's passes for the new points
+            scene.update(*shownModel, irisData, display_w, display_h);
+        } else if(tail.active()){
+            // follow mode: new rows join the dataset and the training set in place
+            if(tail.poll(labels, scaling, irisData)){
+                PROFILE_SCOPE("append rows");
+                scene.appendData(irisData);
+                if(scene.numClasses > model.numClasses){ model.setClasses(scene.numClasses); model.randomize(); }
             }
         }
-
-        updateBoundaryLines(lines);
-        updateIntersections(inters);
-
-        // Render UI to get draw data
-        ImGui::Render();
+        uploadScene(scene);
 
         // Rendering
-        int display_w, display_h;
-        glfwGetFramebufferSize(window, &display_w, &display_h);
         glViewport(0, 0, display_w, display_h);
         // Smoky bluish-gray base background
         glClearColor(0.06f, 0.07f, 0.09f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
         // GPU drawing
-        // Draw background confidence first (subtle)
-        drawBackgroundGrid();
-        drawPoints(irisVertices.size());
-        // draw any user test points on top of dataset points
-        drawTestPoints();
-        drawLines(axisVertices.size());
-        // Draw decision boundaries
-        drawBoundary();
-        // Draw analytic intersection markers (if any)
-        drawIntersections();
-        // Draw loss plot (top-right small panel)
-        // Build loss plot vertices in NDC space (right side)
-        // int maxPts = 512;
-        // int n = (int)lossHistory.size();
-        // float x0 = 0.6f, x1 = 0.98f;
-        // float y0 = -0.95f, y1 = -0.6f;
-        // float maxLoss = 0.0f; for(float v: lossHistory) if(v>maxLoss) maxLoss = v;
-        // maxLoss = std::max(maxLoss, 1e-3f);
-        // std::vector<Vertex> lossVerts; lossVerts.reserve(n);
-        // for(int i=0;i<n;++i){
-        //     float t = n==1?0.0f: (float)i / (float)(n-1);
-        //     float x = x0 + t * (x1 - x0);
-        //     float y = y0 + (lossHistory[i] / maxLoss) * (y1 - y0);
-        //     // color white
-        //     lossVerts.push_back({x, y, 1.0f, 1.0f, 1.0f});
-        // }
-        // updateLossPlot(lossVerts);
-        // drawLossPlot();
+        drawScene(scene);
+        // capture the scene without the ImGui overlay
+        if(recorder.recording()){
+            PROFILE_SCOPE("recorder.capture");
+            recorder.capture();
+        }
+        // Draw loss plot (bottom-right small panel): one min/max pair per pixel column
+        float x0 = 0.6f, x1 = 0.98f;
+        float y0 = -0.95f, y1 = -0.6f;
+        int columns = std::min(2048, std::max(1, (int)((x1 - x0) * 0.5f * display_w)));
+        lossHistory.plot(columns, (uint64_t)lossSpan, lossColumns);
+        float maxLoss = 1e-3f;
+        for(const auto &c : lossColumns) if(c.valid) maxLoss = std::max(maxLoss, c.max);
+        lossVerts.clear();
+        for(int i=0;i<columns;++i){
+            const auto &c = lossColumns[i];
+            if(!c.valid) continue;
+            float x = x0 + (columns == 1 ? 0.0f : (float)i / (float)(columns-1)) * (x1 - x0);
+            // color white
+            lossVerts.push_back({x, y0 + (c.min / maxLoss) * (y1 - y0), 1.0f, 1.0f, 1.0f});
+            if(c.max != c.min) lossVerts.push_back({x, y0 + (c.max / maxLoss) * (y1 - y0), 1.0f, 1.0f, 1.0f});
+        }
+        updateLossPlot(lossVerts);
+        drawLossPlot();
 
         // Render ImGui on top
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            PROFILE_SCOPE("ImGui draw");
+            GPU_PASS_SCOPE("ImGui draw");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
 
         // Swap buffers once
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        profilerEndFrame();
     }
 
     // Cleanup
+    recorder.stop();
+    shutdownGpuTimers();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
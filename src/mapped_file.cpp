@@ -0,0 +1,75 @@
+//mapped_file.cpp
+
+#include "mapped_file.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile(){
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path){
+    close();
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(f, &size)){ CloseHandle(f); return false; }
+    file = f;
+    opened = true;
+    if(size.QuadPart == 0) return true;     // nothing to map
+    mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping) ptr = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!ptr){ close(); return false; }
+    len = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::close(){
+    if(ptr) UnmapViewOfFile(ptr);
+    if(mapping) CloseHandle(mapping);
+    if(file) CloseHandle(file);
+    ptr = nullptr;
+    mapping = file = nullptr;
+    len = 0;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::open(const char* path){
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0){ ::close(fd); return false; }
+    opened = true;
+    if(st.st_size > 0){
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED) opened = false;
+        else {
+            ptr = (const uint8_t*)p;
+            len = (size_t)st.st_size;
+        }
+    }
+    ::close(fd);    // the mapping keeps the file referenced
+    return opened;
+}
+
+void MappedFile::close(){
+    if(ptr) munmap(const_cast<uint8_t*>(ptr), len);
+    ptr = nullptr;
+    len = 0;
+    opened = false;
+}
+
+#endif
@@ -0,0 +1,34 @@
+//mapped_file.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory map of a whole file. Pages are read on first touch, so
+// opening a multi-GB file costs about as much as opening a small one, and
+// columnar formats (Arrow, .npy) can hand out pointers into it without copying.
+// Everything pointing into the mapping is invalid after close().
+class MappedFile{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false when the file can't be opened or mapped; an empty file maps to size() 0
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return opened; }
+
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const uint8_t* ptr = nullptr;
+    size_t len = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
@@ -0,0 +1,163 @@
+//ml_train.cpp
+// ml_train: command-line trainer on top of ml_core; no window, GL or display
+// stack. Loads a CSV, trains the softmax model with the chosen optimizer until
+// the loss converges (relative change below --tol for --patience epochs), a
+// target loss is reached or --max-epochs runs out, then saves the model in the
+// same format as the app's Save Model button, with the feature scaling next to
+// it (scalingSidecarPath).
+//
+//   ml_train --dataset data.csv [--optimizer gd|momentum|adam] [--lr 0.5]
+//            [--threads N] [--pin] [--max-epochs N] [--tol 1e-6] [--patience 20]
+//            [--target-loss L] [--out model.bin] [--log-every N]
+//            [--normalize minmax|zscore] [--x COL] [--y COL] [--label COL]
+// A COL is a header name or a 0-based column index (label -1: no labels).
+// .arrow/.feather/.ipc datasets are read as Arrow IPC files, with COLs naming
+// schema fields; .npy/.npz as NumPy arrays, with COLs naming .npz members or
+// structured fields (an X of two features: columns 0 and 1, labels from y).
+//
+//   ml_train --synthetic SPEC [--write-data out.csv|out.npy] [training options]
+// trains on generated points instead of a file (SPEC as in synth.h, e.g.
+// spirals:n=1e8,k=5,noise=0.05); --write-data streams them to a file and exits.
+
+#include "dataset.h"
+#include "model.h"
+#include "synth.h"
+#include "dataset_loader.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+struct TrainOptions{
+    std::string dataset;
+    std::string out = "model.bin";
+    int optimizer = OPT_GD;
+    float lr = -1.0f;           // < 0: per-optimizer default
+    int threads = 0;            // thread pool size (0 = all cores)
+    bool pin = false;           // pin pool workers to cores
+    int maxEpochs = 100000;
+    double tol = 1e-6;          // relative loss change counted as "no progress"
+    int patience = 20;          // consecutive epochs without progress before stopping
+    double targetLoss = 0.0;    // stop once the loss is at or below this (0 = off)
+    int logEvery = 0;           // progress line every N epochs (0 = off)
+    int normalize = NORM_MINMAX;
+    CsvSchema schema;
+    std::string synthetic;      // generator spec instead of --dataset
+    std::string writeData;      // stream the generated points here and exit
+};
+
+static void usage(){
+    printf("usage: ml_train --dataset data.csv|.arrow|.npz [--optimizer gd|momentum|adam] [--lr LR] [--threads N] [--pin]\n"
+           "                [--max-epochs N] [--tol T] [--patience N] [--target-loss L] [--out model.bin] [--log-every N]\n"
+           "                [--normalize minmax|zscore] [--x COL] [--y COL] [--label COL]\n"
+           "       ml_train --synthetic blobs|rings|spirals|xor|moons[:n=N,k=K,noise=S,seed=X] [--write-data PATH] ...\n");
+}
+
+static bool parseTrainArgs(int argc, char** argv, TrainOptions& opts){
+    for(int i=1;i<argc;++i){
+        auto next = [&](){ return i + 1 < argc ? argv[++i] : ""; };
+        if(!strcmp(argv[i], "--dataset")) opts.dataset = next();
+        else if(!strcmp(argv[i], "--out")) opts.out = next();
+        else if(!strcmp(argv[i], "--optimizer")){
+            const char* o = next();
+            if(!strcmp(o, "gd")) opts.optimizer = OPT_GD;
+            else if(!strcmp(o, "momentum")) opts.optimizer = OPT_MOMENTUM;
+            else if(!strcmp(o, "adam")) opts.optimizer = OPT_ADAM;
+            else { std::cerr << "unknown optimizer: " << o << "\n"; return false; }
+        }
+        else if(!strcmp(argv[i], "--lr")) opts.lr = (float)atof(next());
+        else if(!strcmp(argv[i], "--threads")) opts.threads = std::max(0, atoi(next()));
+        else if(!strcmp(argv[i], "--pin")) opts.pin = true;
+        else if(!strcmp(argv[i], "--max-epochs")) opts.maxEpochs = std::max(1, atoi(next()));
+        else if(!strcmp(argv[i], "--tol")) opts.tol = atof(next());
+        else if(!strcmp(argv[i], "--patience")) opts.patience = std::max(1, atoi(next()));
+        else if(!strcmp(argv[i], "--target-loss")) opts.targetLoss = atof(next());
+        else if(!strcmp(argv[i], "--log-every")) opts.logEvery = std::max(0, atoi(next()));
+        else if(!strcmp(argv[i], "--normalize")){
+            const char* n = next();
+            if(!strcmp(n, "minmax")) opts.normalize = NORM_MINMAX;
+            else if(!strcmp(n, "zscore")) opts.normalize = NORM_ZSCORE;
+            else { std::cerr << "unknown normalization: " << n << "\n"; return false; }
+        }
+        else if(!strcmp(argv[i], "--synthetic")) opts.synthetic = next();
+        else if(!strcmp(argv[i], "--write-data")) opts.writeData = next();
+        else if(!strcmp(argv[i], "--x")) opts.schema.x = parseCsvColumn(next());
+        else if(!strcmp(argv[i], "--y")) opts.schema.y = parseCsvColumn(next());
+        else if(!strcmp(argv[i], "--label")) opts.schema.label = parseCsvColumn(next());
+        else if(!strcmp(argv[i], "--help")){ usage(); return false; }
+        else std::cerr << "Ignoring unknown argument: " << argv[i] << "\n";
+    }
+    if(opts.dataset.empty() == opts.synthetic.empty()){ usage(); return false; }
+    return true;
+}
+
+int main(int argc, char** argv){
+    TrainOptions opts;
+    if(!parseTrainArgs(argc, argv, opts)) return 1;
+    if(opts.threads || opts.pin) ThreadPool::configure(opts.threads, opts.pin);
+
+    auto t0 = std::chrono::steady_clock::now();
+    FeatureScaling scaling;
+    scaling.mode = opts.normalize;
+    std::vector<point2D> data;
+    if(!opts.synthetic.empty()){
+        SynthSpec spec;
+        if(!parseSynthSpec(opts.synthetic.c_str(), spec)){ std::cerr << "bad --synthetic spec: " << opts.synthetic << "\n"; return 1; }
+        opts.dataset = synthSpecString(spec);
+        if(!opts.writeData.empty()){
+            if(!writeSynthetic(spec, opts.writeData.c_str())){ std::cerr << "could not write " << opts.writeData << "\n"; return 1; }
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            printf("wrote %llu points (%s) to %s in %.3fs\n", (unsigned long long)spec.count, opts.dataset.c_str(), opts.writeData.c_str(), secs);
+            return 0;
+        }
+        data = generateSynthetic(spec);
+    } else {
+        data = loadDataset(opts.dataset.c_str(), nullptr, &scaling, opts.schema);
+    }
+    double loadSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if(data.empty()){ std::cerr << "no data loaded from " << opts.dataset << "\n"; return 1; }
+    printf("loaded %zu points (%d classes) from %s in %.3fs\n", data.size(), countClasses(data), opts.dataset.c_str(), loadSecs);
+    if(opts.synthetic.empty()) for(int a=0;a<2;++a){
+        const ColumnStats &c = scaling.stats[a];
+        printf("  %c: min %g max %g mean %g sd %g\n", "xy"[a], c.min, c.max, c.mean, std::sqrt(c.variance()));
+    }
+
+    static const float defaultLr[3] = { 0.8f, 0.3f, 0.05f };
+    static const char* optimizerNames[3] = { "gd", "momentum", "adam" };
+    LogisticModel model(opts.lr > 0.0f ? opts.lr : defaultLr[opts.optimizer], std::max(1, countClasses(data)));
+    model.optimizer = opts.optimizer;
+    model.randomize();
+
+    const char* reason = "max epochs";
+    double prev = model.compute_loss(data);
+    int stalled = 0;
+    t0 = std::chrono::steady_clock::now();
+    for(int e=0;e<opts.maxEpochs;++e){
+        model.train_epoch(data);
+        double loss = model.last_loss;
+        if(opts.logEvery && model.epochs_trained % opts.logEvery == 0) printf("epoch %d  loss %.6f\n", model.epochs_trained, loss);
+        if(!std::isfinite(loss)){ reason = "diverged"; break; }
+        if(opts.targetLoss > 0.0 && loss <= opts.targetLoss){ reason = "target loss"; break; }
+        stalled = std::fabs(prev - loss) <= opts.tol * std::max(std::fabs(prev), 1e-12) ? stalled + 1 : 0;
+        prev = loss;
+        if(stalled >= opts.patience){ reason = "converged"; break; }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("%s after %d epochs (%s, lr %.4g): loss %.6f\n", reason, model.epochs_trained, optimizerNames[opts.optimizer], model.lr, model.last_loss);
+    printf("%.3fs, %.1f epochs/s, %.3g points/s\n", secs, model.epochs_trained / std::max(secs, 1e-9),
+           (double)model.epochs_trained * data.size() / std::max(secs, 1e-9));
+    if(!opts.out.empty()){
+        // the weights only apply to features scaled the same way, so the scaling goes along
+        const std::string scalingPath = scalingSidecarPath(opts.out);
+        if(!model.save(opts.out.c_str())){ std::cerr << "failed to save " << opts.out << "\n"; return 1; }
+        if(!scaling.save(scalingPath)){ std::cerr << "failed to save " << scalingPath << "\n"; return 1; }
+        printf("saved %s and %s\n", opts.out.c_str(), scalingPath.c_str());
+    }
+    return strcmp(reason, "diverged") == 0 ? 1 : 0;
+}
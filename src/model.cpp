@@ -1,92 +1,162 @@
 #include "model.h"
+#include "thread_pool.h"
 #include <random>
 #include <cmath>
 #include <fstream>
+#include <algorithm>
+#include <cstdint>
 
-static void softmax_inplace(float logits[3], float probs[3]){
+static void softmax_inplace(const float* logits, float* probs, int k){
     // subtract max for numerical stability
     float m = logits[0];
-    if(logits[1] > m) m = logits[1];
-    if(logits[2] > m) m = logits[2];
+    for(int i=1;i<k;++i) if(logits[i] > m) m = logits[i];
     float sum = 0.0f;
-    for(int i=0;i<3;++i){
+    for(int i=0;i<k;++i){
         probs[i] = std::exp(logits[i] - m);
         sum += probs[i];
     }
-    for(int i=0;i<3;++i) probs[i] /= sum;
+    for(int i=0;i<k;++i) probs[i] /= sum;
 }
 
-LogisticModel::LogisticModel(float learning_rate)
-    : lr(learning_rate), epochs_trained(0), last_loss(0.0f)
+// below a few thousand points a chunk isn't worth handing to another thread
+static const size_t kPointsPerChunk = 4096;
+
+// logits/probabilities for one chunk: on the stack for the usual handful of classes
+struct ClassScratch{
+    static const int INLINE_CLASSES = 64;
+    float inlineBuf[2 * INLINE_CLASSES];
+    std::vector<float> heap;
+    float *logits, *probs;
+    explicit ClassScratch(int k){
+        float* base = inlineBuf;
+        if(k > INLINE_CLASSES){ heap.resize(2 * (size_t)k); base = heap.data(); }
+        logits = base; probs = base + k;
+    }
+};
+
+LogisticModel::LogisticModel(float learning_rate, int classes)
+    : numClasses(0), lr(learning_rate), epochs_trained(0), last_loss(0.0f),
+      optimizer(OPT_GD), momentum(0.9f), beta1(0.9f), beta2(0.999f), adamStep(0)
 {
-    for(int i=0;i<3;++i) for(int j=0;j<3;++j) W[i][j] = 0.0f;
+    setClasses(classes);
+}
+
+void LogisticModel::setClasses(int classes){
+    numClasses = std::max(1, classes);
+    W.assign(numClasses, {0.0f, 0.0f, 0.0f});
+    resetOptimizer();
+}
+
+void LogisticModel::resetOptimizer(){
+    M.assign(numClasses, {0.0f, 0.0f, 0.0f});
+    V.assign(numClasses, {0.0f, 0.0f, 0.0f});
+    adamStep = 0;
 }
 
 void LogisticModel::randomize(){
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
-    for(int i=0;i<3;++i){
+    for(int i=0;i<numClasses;++i){
         W[i][0] = dist(gen) * 0.5f; // bias smaller
         W[i][1] = dist(gen);
         W[i][2] = dist(gen);
     }
+    resetOptimizer();
 }
 
 std::vector<float> LogisticModel::predict_probs(float x, float y) const{
-    float logits[3];
-    for(int c=0;c<3;++c) logits[c] = W[c][0] + W[c][1]*x + W[c][2]*y;
-    float probs[3];
-    softmax_inplace(logits, probs);
-    return std::vector<float>(probs, probs+3);
+    std::vector<float> probs(numClasses);
+    predict_probs(x, y, probs.data());
+    return probs;
+}
+
+void LogisticModel::predict_probs(float x, float y, float* probs) const{
+    // the logits go through probs itself; softmax reads each before overwriting it
+    for(int c=0;c<numClasses;++c) probs[c] = W[c][0] + W[c][1]*x + W[c][2]*y;
+    softmax_inplace(probs, probs, numClasses);
 }
 
 int LogisticModel::predict_label(float x, float y) const{
-    auto p = predict_probs(x,y);
     int best = 0;
-    for(int i=1;i<3;++i) if(p[i] > p[best]) best = i;
+    float bestLogit = W[0][0] + W[0][1]*x + W[0][2]*y;
+    for(int c=1;c<numClasses;++c){
+        float l = W[c][0] + W[c][1]*x + W[c][2]*y;
+        if(l > bestLogit){ bestLogit = l; best = c; }
+    }
     return best;
 }
 
 float LogisticModel::compute_loss(const std::vector<point2D>& data) const{
     if(data.empty()) return 0.0f;
-    double loss = 0.0;
-    for(const auto& p : data){
-        int t = p.label; // 0,1,2
-        float logits[3];
-        for(int c=0;c<3;++c) logits[c] = W[c][0] + W[c][1]*p.x + W[c][2]*p.y;
-        float probs[3]; softmax_inplace(logits, probs);
-        float eps = 1e-7f;
-        float pr = std::min(1.0f - eps, std::max(eps, probs[t]));
-        loss += -std::log(pr);
-    }
+    const int K = numClasses;
+    double loss = ThreadPool::instance().parallel_reduce(data.size(), kPointsPerChunk, 0.0, [&](size_t b, size_t e){
+        ClassScratch s(K);
+        double sum = 0.0;
+        for(size_t i=b;i<e;++i){
+            const point2D &p = data[i];
+            int target = p.label;
+            if(target >= K) continue;
+            for(int c=0;c<K;++c) s.logits[c] = W[c][0] + W[c][1]*p.x + W[c][2]*p.y;
+            softmax_inplace(s.logits, s.probs, K);
+            float eps = 1e-7f;
+            float pr = std::min(1.0f - eps, std::max(eps, s.probs[target]));
+            sum += -std::log(pr);
+        }
+        return sum;
+    }, [](double a, double b){ return a + b; });
     return (float)(loss / data.size());
 }
 
 void LogisticModel::train_epoch(const std::vector<point2D>& data){
     if(data.empty()) return;
-    // gradients dL/dW[c][k]
-    double grad[3][3];
-    for(int c=0;c<3;++c) for(int k=0;k<3;++k) grad[c][k] = 0.0;
-
-    for(const auto& p : data){
-        float logits[3];
-        for(int c=0;c<3;++c) logits[c] = W[c][0] + W[c][1]*p.x + W[c][2]*p.y;
-        float probs[3]; softmax_inplace(logits, probs);
-        for(int c=0;c<3;++c){
-            int y_true = (p.label == c) ? 1 : 0;
-            float err = probs[c] - y_true; // derivative wrt logits
-            grad[c][0] += err * 1.0f; // bias
-            grad[c][1] += err * p.x;
-            grad[c][2] += err * p.y;
+    // gradients dL/dW[c][k]: one partial of K*3 doubles per chunk, summed in chunk order
+    ThreadPool &pool = ThreadPool::instance();
+    const int K = numClasses;
+    const size_t stride = (size_t)K * 3;
+    const size_t chunks = std::max<size_t>(1, std::min((data.size() + kPointsPerChunk - 1) / kPointsPerChunk, (size_t)pool.size() * 4));
+    const size_t per = (data.size() + chunks - 1) / chunks;
+    gradScratch.assign(chunks * stride, 0.0);
+    pool.parallel_for(chunks, 1, [&](size_t cb, size_t ce){
+        ClassScratch s(K);
+        for(size_t chunk=cb;chunk<ce;++chunk){
+            double* g = &gradScratch[chunk * stride];
+            size_t e = std::min(data.size(), (chunk + 1) * per);
+            for(size_t i=chunk*per;i<e;++i){
+                const point2D &p = data[i];
+                if(p.label >= K) continue;
+                for(int c=0;c<K;++c) s.logits[c] = W[c][0] + W[c][1]*p.x + W[c][2]*p.y;
+                softmax_inplace(s.logits, s.probs, K);
+                for(int c=0;c<K;++c){
+                    int y_true = (p.label == c) ? 1 : 0;
+                    float err = s.probs[c] - y_true; // derivative wrt logits
+                    g[c*3+0] += err * 1.0f; // bias
+                    g[c*3+1] += err * p.x;
+                    g[c*3+2] += err * p.y;
+                }
+            }
         }
-    }
+    });
+    for(size_t chunk=1;chunk<chunks;++chunk)
+        for(size_t k=0;k<stride;++k) gradScratch[k] += gradScratch[chunk * stride + k];
 
     float invN = 1.0f / (float)data.size();
-    for(int c=0;c<3;++c){
+    if(optimizer == OPT_ADAM) ++adamStep;
+    const float bc1 = optimizer == OPT_ADAM ? 1.0f - std::pow(beta1, (float)adamStep) : 1.0f;
+    const float bc2 = optimizer == OPT_ADAM ? 1.0f - std::pow(beta2, (float)adamStep) : 1.0f;
+    for(int c=0;c<K;++c){
         for(int k=0;k<3;++k){
-            float g = (float)(grad[c][k] * invN);
-            W[c][k] -= lr * g;
+            float g = (float)(gradScratch[c*3+k] * invN);
+            if(optimizer == OPT_MOMENTUM){
+                M[c][k] = momentum * M[c][k] + g;
+                W[c][k] -= lr * M[c][k];
+            } else if(optimizer == OPT_ADAM){
+                M[c][k] = beta1 * M[c][k] + (1.0f - beta1) * g;
+                V[c][k] = beta2 * V[c][k] + (1.0f - beta2) * g * g;
+                W[c][k] -= lr * (M[c][k] / bc1) / (std::sqrt(V[c][k] / bc2) + 1e-8f);
+            } else {
+                W[c][k] -= lr * g;
+            }
         }
     }
 
@@ -94,24 +164,47 @@ void LogisticModel::train_epoch(const std::vector<point2D>& data){
     last_loss = compute_loss(data);
 }
 
+// File layout: "MLVK", class count, weights, lr, epochs, loss. Files written
+// before the class count was stored hold a bare 3x3 W and still load.
+static const char kModelMagic[4] = { 'M', 'L', 'V', 'K' };
+
 bool LogisticModel::save(const char* filename) const{
     std::ofstream out(filename, std::ios::binary);
     if(!out) return false;
-    out.write((const char*)W, sizeof(W));
+    int32_t k = numClasses;
+    out.write(kModelMagic, sizeof(kModelMagic));
+    out.write((const char*)&k, sizeof(k));
+    out.write((const char*)&W[0][0], sizeof(float) * weightCount());
     out.write((const char*)&lr, sizeof(lr));
     out.write((const char*)&epochs_trained, sizeof(epochs_trained));
     out.write((const char*)&last_loss, sizeof(last_loss));
     out.close();
-    return true;
+    return !out.fail();
 }
 
 bool LogisticModel::load(const char* filename){
     std::ifstream in(filename, std::ios::binary);
     if(!in) return false;
-    in.read((char*)W, sizeof(W));
-    in.read((char*)&lr, sizeof(lr));
-    in.read((char*)&epochs_trained, sizeof(epochs_trained));
-    in.read((char*)&last_loss, sizeof(last_loss));
-    in.close();
+    char magic[4] = {};
+    in.read(magic, sizeof(magic));
+    int32_t k = 3;
+    if(in && std::equal(magic, magic + 4, kModelMagic)){
+        in.read((char*)&k, sizeof(k));
+        if(!in || k < 1 || k > 65536) return false;
+    } else {
+        in.clear();
+        in.seekg(0);
+    }
+    std::vector<std::array<float, 3>> w(k);
+    in.read((char*)&w[0][0], sizeof(float) * 3 * k);
+    float newLr; int epochs; float loss;
+    in.read((char*)&newLr, sizeof(newLr));
+    in.read((char*)&epochs, sizeof(epochs));
+    in.read((char*)&loss, sizeof(loss));
+    if(!in) return false;
+    numClasses = k;
+    W.swap(w);
+    lr = newLr; epochs_trained = epochs; last_loss = loss;
+    resetOptimizer();
     return true;
 }
@@ -1,21 +1,45 @@
 #pragma once
 #include <vector>
+#include <array>
 #include "dataset.h"
 
+// Update rule applied by train_epoch to the full-batch gradient
+enum Optimizer{ OPT_GD = 0, OPT_MOMENTUM = 1, OPT_ADAM = 2 };
+
 struct LogisticModel {
-    // Multiclass softmax weights: 3 classes x (bias + x + y)
-    float W[3][3]; // W[c][0]=bias, W[c][1]=wx, W[c][2]=wy
+    // Multiclass softmax weights: numClasses x (bias + x + y), contiguous so
+    // &W[0][0] is the flattened weightCount() floats
+    int numClasses;
+    std::vector<std::array<float, 3>> W; // W[c][0]=bias, W[c][1]=wx, W[c][2]=wy
     float lr;
     int epochs_trained;
     float last_loss;
 
-    LogisticModel(float learning_rate = 0.5f);
+    int optimizer;          // Optimizer
+    float momentum;         // OPT_MOMENTUM velocity decay
+    float beta1, beta2;     // OPT_ADAM moment decays
+    // optimizer state: velocity (momentum) or first/second moments (Adam)
+    std::vector<std::array<float, 3>> M, V;
+    int adamStep;
+
+    LogisticModel(float learning_rate = 0.5f, int classes = 3);
+    // resize to a new class count; zeroes the weights and the optimizer state
+    void setClasses(int classes);
+    int weightCount() const { return numClasses * 3; }
     void randomize();
+    void resetOptimizer();
     bool save(const char* filename) const;
     bool load(const char* filename);
-    // return vector of class probabilities (size 3)
+    // return vector of class probabilities (size numClasses)
     std::vector<float> predict_probs(float x, float y) const;
+    // same without the heap allocation; probs receives numClasses values
+    void predict_probs(float x, float y, float* probs) const;
+    // argmax of the logits, no softmax needed
     int predict_label(float x, float y) const;
+    // points with labels >= numClasses are ignored by loss and training
     float compute_loss(const std::vector<point2D>& data) const;
     void train_epoch(const std::vector<point2D>& data);
+
+private:
+    std::vector<double> gradScratch;   // per-chunk gradient partials, kept across epochs
 };
@@ -0,0 +1,451 @@
+//npy.cpp
+
+#include "npy.h"
+#include "thread_pool.h"
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+static uint16_t le16(const uint8_t* p){ return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t le32(const uint8_t* p){ return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint64_t le64(const uint8_t* p){ return (uint64_t)le32(p) | (uint64_t)le32(p + 4) << 32; }
+
+size_t NpyArray::columns() const {
+    if(structured) return fields.size();
+    return shape.size() == 2 ? (size_t)shape[1] : 1;
+}
+
+// The header is the repr of a Python dict, e.g.
+// {'descr': '<f4', 'fortran_order': False, 'shape': (150, 2), }
+// with descr a list of (name, type) tuples for structured arrays. Only the
+// literals numpy writes there are parsed.
+class PyLiteral{
+public:
+    PyLiteral(const char* b, const char* e) : p(b), end(e) {}
+    bool take(char c){
+        skip();
+        if(p >= end || *p != c) return false;
+        ++p;
+        return true;
+    }
+    bool peek(char c){
+        skip();
+        return p < end && *p == c;
+    }
+    bool word(const char* w){
+        skip();
+        size_t n = strlen(w);
+        if((size_t)(end - p) < n || memcmp(p, w, n) != 0) return false;
+        p += n;
+        return true;
+    }
+    bool string(std::string& out){
+        skip();
+        if(p >= end || (*p != '\'' && *p != '"')) return false;
+        char quote = *p++;
+        const char* b = p;
+        while(p < end && *p != quote){
+            if(*p == '\\') return false;    // numpy never escapes anything in these names
+            ++p;
+        }
+        if(p >= end) return false;
+        out.assign(b, p++);
+        return true;
+    }
+    bool integer(uint64_t& v){
+        skip();
+        auto r = std::from_chars(p, end, v);
+        if(r.ec != std::errc()) return false;
+        p = r.ptr;
+        if(p < end && *p == 'L') ++p;       // Python 2 longs
+        return true;
+    }
+    // (a, b, ...) with an optional trailing comma
+    bool tuple(std::vector<uint64_t>& out){
+        if(!take('(')) return false;
+        while(!take(')')){
+            uint64_t v;
+            if(!integer(v)) return false;
+            out.push_back(v);
+            if(!take(',') && !peek(')')) return false;
+        }
+        return true;
+    }
+
+private:
+    const char *p, *end;
+    void skip(){ while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p; }
+};
+
+// a numpy type string ("<f4", "|u1", ">U12", "<M8[ns]") into f; false when it isn't one
+static bool parseDescr(const std::string& descr, NpyField& f){
+    if(descr.size() < 2 || !strchr("<>|=", descr[0])) return false;
+    f.descr = descr;
+    f.kind = descr[1];
+    size_t n = 0;
+    auto r = std::from_chars(descr.data() + 2, descr.data() + descr.size(), n);
+    if(r.ec != std::errc() && f.kind != 'O') return false;
+    if(f.kind == 'O') n = sizeof(void*);
+    f.size = f.kind == 'U' ? n * 4 : n;
+    f.type = COLUMN_NONE;
+    switch(f.kind){
+        case 'f': f.type = n == 4 ? COLUMN_F32 : n == 8 ? COLUMN_F64 : COLUMN_NONE; break;
+        case 'i': f.type = n == 1 ? COLUMN_I8 : n == 2 ? COLUMN_I16 : n == 4 ? COLUMN_I32 : n == 8 ? COLUMN_I64 : COLUMN_NONE; break;
+        case 'u': f.type = n == 1 ? COLUMN_U8 : n == 2 ? COLUMN_U16 : n == 4 ? COLUMN_U32 : n == 8 ? COLUMN_U64 : COLUMN_NONE; break;
+        case 'b': f.type = n == 1 ? COLUMN_U8 : COLUMN_NONE; break;
+    }
+    // the hosts we build on are little-endian, '=' included
+    f.swap = descr[0] == '>' && (f.type != COLUMN_NONE ? f.size > 1 : f.kind == 'U');
+    return true;
+}
+
+bool NpyFile::fail(const std::string& message){
+    err = message;
+    close();
+    return false;
+}
+
+void NpyFile::close(){
+    map.close();
+    list.clear();
+    converted.clear();
+}
+
+const NpyArray* NpyFile::find(const std::string& name) const {
+    for(const NpyArray &a : list) if(a.name == name) return &a;
+    return nullptr;
+}
+
+bool NpyFile::open(const char* path){
+    close();
+    err.clear();
+    if(!map.open(path)) return fail(std::string("cannot open ") + path);
+    const uint8_t* d = map.data();
+    const size_t n = map.size();
+    if(n >= 4 && memcmp(d, "PK", 2) == 0) return readZip();
+    return parseArray(d, n, "");
+}
+
+// One .npy image: magic, version, header length, the header dict padded to a
+// multiple of 64 bytes, then the data.
+bool NpyFile::parseArray(const uint8_t* p, uint64_t size, const std::string& name){
+    const std::string what = name.empty() ? std::string("the file") : "'" + name + "'";
+    if(size < 10 || memcmp(p, "\x93NUMPY", 6) != 0) return fail(what + " is not a .npy array");
+    uint64_t headerLength, at;
+    if(p[6] == 1){ headerLength = le16(p + 8); at = 10; }
+    else if((p[6] == 2 || p[6] == 3) && size >= 12){ headerLength = le32(p + 8); at = 12; }
+    else return fail(what + ": unsupported .npy version " + std::to_string(p[6]));
+    if(headerLength > size - at) return fail(what + ": truncated header");
+
+    NpyArray a;
+    a.name = name;
+    PyLiteral h((const char*)p + at, (const char*)p + at + headerLength);
+    bool haveDescr = false, haveShape = false;
+    if(!h.take('{')) return fail(what + ": bad header");
+    while(!h.take('}')){
+        std::string key;
+        if(!h.string(key) || !h.take(':')) return fail(what + ": bad header");
+        if(key == "descr"){
+            haveDescr = true;
+            if(h.peek('[')){
+                h.take('[');
+                a.structured = true;
+                while(!h.take(']')){
+                    NpyField f;
+                    std::string descr;
+                    if(!h.take('(') || !h.string(f.name) || !h.take(',')) return fail(what + ": bad dtype");
+                    if(!h.string(descr) || !parseDescr(descr, f))
+                        return fail(what + ": nested or titled fields are not supported");
+                    // a subarray field ('name', '<f4', (3,)): unreadable, but its size counts
+                    std::vector<uint64_t> sub;
+                    if(h.take(',') && h.peek('(')){
+                        if(!h.tuple(sub)) return fail(what + ": bad dtype");
+                        for(uint64_t s : sub){
+                            if(s && f.size > SIZE_MAX / s) return fail(what + ": bad dtype");
+                            f.size *= (size_t)s;
+                        }
+                        f.type = COLUMN_NONE;
+                        f.kind = 'V';
+                        h.take(',');
+                    }
+                    if(!h.take(')')) return fail(what + ": bad dtype");
+                    if(f.size > SIZE_MAX - a.itemSize) return fail(what + ": bad dtype");
+                    f.offset = a.itemSize;
+                    a.itemSize += f.size;
+                    if(f.kind == 'O') a.problem = what + " holds Python objects (pickled), which can't be mapped";
+                    if(!f.name.empty()) a.fields.push_back(f);     // unnamed fields are padding
+                    if(!h.take(',') && !h.peek(']')) return fail(what + ": bad dtype");
+                }
+            } else {
+                NpyField f;
+                std::string descr;
+                if(!h.string(descr) || !parseDescr(descr, f)) return fail(what + ": bad dtype");
+                a.itemSize = f.size;
+                if(f.kind == 'O') a.problem = what + " holds Python objects (pickled), which can't be mapped";
+                a.fields.push_back(f);
+            }
+        } else if(key == "fortran_order"){
+            if(h.word("True")) a.fortran = true;
+            else if(!h.word("False")) return fail(what + ": bad header");
+        } else if(key == "shape"){
+            haveShape = true;
+            if(!h.tuple(a.shape)) return fail(what + ": bad shape");
+        } else return fail(what + ": unknown header key '" + key + "'");
+        if(!h.take(',') && !h.peek('}')) return fail(what + ": bad header");
+    }
+    if(!haveDescr || !haveShape) return fail(what + ": header without descr or shape");
+
+    // every element has to be inside the file, whatever is read later
+    uint64_t elements = 1;
+    for(uint64_t s : a.shape){
+        if(s && elements > UINT64_MAX / s) return fail(what + ": shape too large");
+        elements *= s;
+    }
+    a.data = p + at + headerLength;
+    uint64_t available = size - at - headerLength;
+    if(a.itemSize && elements > available / a.itemSize) return fail(what + ": truncated data");
+
+    if(a.problem.empty()){
+        if(a.shape.empty()) a.problem = what + " is a scalar";
+        else if(a.shape.size() > 2 || (a.structured && a.shape.size() != 1))
+            a.problem = what + " has " + std::to_string(a.shape.size()) + " dimensions; only 1-D arrays, 2-D matrices and 1-D structured arrays are read";
+    }
+    list.push_back(std::move(a));
+    return true;
+}
+
+// The zip directory of an .npz: the end record (zip64 when numpy had to), then
+// one central directory entry per member. Sizes and offsets come from the
+// central directory, so members written with data descriptors are fine too.
+bool NpyFile::readZip(){
+    const uint8_t* d = map.data();
+    const size_t n = map.size();
+    if(n < 22) return fail("truncated zip archive");
+    // the end record is the last 22 bytes, unless a comment (at most 64 KB) follows it
+    size_t eocd = SIZE_MAX;
+    const size_t lowest = n - 22 > 65535 ? n - 22 - 65535 : 0;
+    for(size_t i=n-22;;--i){
+        if(le32(d + i) == 0x06054b50){ eocd = i; break; }
+        if(i == lowest) break;
+    }
+    if(eocd == SIZE_MAX) return fail("not a zip archive (no end of central directory)");
+    uint64_t entries = le16(d + eocd + 10), dirSize = le32(d + eocd + 12), dirOffset = le32(d + eocd + 16);
+    if(entries == 0xFFFF || dirSize == 0xFFFFFFFF || dirOffset == 0xFFFFFFFF){
+        if(eocd < 20 || le32(d + eocd - 20) != 0x07064b50) return fail("zip64 archive without its locator");
+        uint64_t z = le64(d + eocd - 12);
+        if(n < 56 || z > n - 56 || le32(d + z) != 0x06064b50) return fail("bad zip64 end of central directory");
+        entries = le64(d + z + 32);
+        dirSize = le64(d + z + 40);
+        dirOffset = le64(d + z + 48);
+    }
+    if(dirOffset > n || dirSize > n - dirOffset) return fail("zip central directory outside the file");
+
+    const uint8_t* p = d + dirOffset;
+    const uint8_t* end = p + dirSize;
+    for(uint64_t k=0;k<entries;++k){
+        if(end - p < 46 || le32(p) != 0x02014b50) return fail("bad zip central directory entry");
+        uint16_t flags = le16(p + 8), method = le16(p + 10);
+        uint64_t compressedSize = le32(p + 20), size = le32(p + 24), local = le32(p + 42);
+        size_t nameLength = le16(p + 28), extraLength = le16(p + 30), commentLength = le16(p + 32);
+        if((size_t)(end - p) < 46 + nameLength + extraLength + commentLength) return fail("bad zip central directory entry");
+        std::string name((const char*)p + 46, nameLength);
+        // zip64 extra field: 64-bit values of the fields saturated above, in this order
+        const uint8_t* x = p + 46 + nameLength;
+        const uint8_t* xe = x + extraLength;
+        while(xe - x >= 4){
+            size_t id = le16(x), length = le16(x + 2);
+            if((size_t)(xe - x - 4) < length) break;
+            const uint8_t* v = x + 4;
+            const uint8_t* ve = v + length;
+            if(id == 1){
+                if(size == 0xFFFFFFFF && ve - v >= 8){ size = le64(v); v += 8; }
+                if(compressedSize == 0xFFFFFFFF && ve - v >= 8){ compressedSize = le64(v); v += 8; }
+                if(local == 0xFFFFFFFF && ve - v >= 8) local = le64(v);
+            }
+            x = ve;
+        }
+        p += 46 + nameLength + extraLength + commentLength;
+
+        if(name.size() < 4 || name.compare(name.size() - 4, 4, ".npy") != 0) continue;     // not an array
+        name.resize(name.size() - 4);
+        if(flags & 1) return fail("'" + name + "' is encrypted");
+        if(method != 0 || compressedSize != size)
+            return fail("'" + name + "' is compressed (np.savez_compressed); save with np.savez to load it in place");
+        if(n < 30 || local > n - 30 || le32(d + local) != 0x04034b50) return fail("bad zip local header of '" + name + "'");
+        uint64_t at = local + 30 + le16(d + local + 26) + le16(d + local + 28);
+        if(at > n || size > n - at) return fail("'" + name + "' extends past the end of the archive");
+        if(!parseArray(d + at, size, name)) return false;
+    }
+    if(list.empty()) return fail("no .npy arrays in the archive");
+    return true;
+}
+
+bool NpyFile::column(const NpyArray& a, size_t col, ColumnView& out){
+    const std::string what = a.name.empty() ? std::string("the array") : "'" + a.name + "'";
+    if(!a.problem.empty()){ err = a.problem; return false; }
+    if(col >= a.columns()){
+        err = what + " has no column " + std::to_string(col) + " (" + std::to_string(a.columns()) + " columns)";
+        return false;
+    }
+    const NpyField &f = a.structured ? a.fields[col] : a.fields[0];
+    const uint64_t rows = a.rows();
+    const uint8_t* values = a.data;
+    size_t stride = a.itemSize;
+    if(a.structured) values += f.offset;
+    else if(a.shape.size() == 2){
+        // C order: rows of shape[1] items; Fortran order: columns of shape[0] items
+        if(a.fortran) values += col * rows * a.itemSize;
+        else {
+            values += col * a.itemSize;
+            stride = a.itemSize * (size_t)a.shape[1];
+        }
+    }
+    out = ColumnView();
+    if(f.type != COLUMN_NONE && !f.swap){
+        out.type = f.type;
+        out.values = values;
+        out.stride = stride;
+        return true;
+    }
+
+    if(f.type != COLUMN_NONE){
+        // big-endian: the values reversed into a packed copy
+        std::vector<uint8_t> buf((size_t)rows * f.size);
+        const size_t w = f.size;
+        ThreadPool::instance().parallel_for((size_t)rows, 1 << 16, [&](size_t b, size_t e){
+            for(size_t i=b;i<e;++i)
+                for(size_t k=0;k<w;++k) buf[i * w + k] = values[i * stride + w - 1 - k];
+        });
+        converted.push_back(std::move(buf));
+        out.type = f.type;
+        out.values = converted.back().data();
+        out.stride = w;
+        return true;
+    }
+
+    if(f.kind == 'S' || f.kind == 'U'){
+        // fixed-width strings, NUL padded: into UTF-8 with offsets, like an Arrow column
+        std::vector<uint8_t> offsets(((size_t)rows + 1) * 8), bytes;
+        bytes.reserve((size_t)rows * 8);
+        uint64_t o = 0;
+        memcpy(offsets.data(), &o, 8);
+        for(uint64_t i=0;i<rows;++i){
+            const uint8_t* s = values + i * stride;
+            if(f.kind == 'S'){
+                size_t len = f.size;
+                while(len && !s[len - 1]) --len;
+                bytes.insert(bytes.end(), s, s + len);
+            } else {
+                size_t len = f.size / 4;
+                auto codePoint = [&](size_t c) -> uint32_t {
+                    const uint8_t* q = s + 4 * c;
+                    return f.swap ? (uint32_t)q[3] | (uint32_t)q[2] << 8 | (uint32_t)q[1] << 16 | (uint32_t)q[0] << 24 : le32(q);
+                };
+                while(len && !codePoint(len - 1)) --len;
+                for(size_t c=0;c<len;++c){
+                    uint32_t u = codePoint(c);
+                    if(u > 0x10FFFF || (u >= 0xD800 && u < 0xE000)) u = 0xFFFD;
+                    if(u < 0x80) bytes.push_back((uint8_t)u);
+                    else if(u < 0x800){ bytes.push_back((uint8_t)(0xC0 | u >> 6)); bytes.push_back((uint8_t)(0x80 | (u & 0x3F))); }
+                    else if(u < 0x10000){
+                        bytes.push_back((uint8_t)(0xE0 | u >> 12));
+                        bytes.push_back((uint8_t)(0x80 | (u >> 6 & 0x3F)));
+                        bytes.push_back((uint8_t)(0x80 | (u & 0x3F)));
+                    } else {
+                        bytes.push_back((uint8_t)(0xF0 | u >> 18));
+                        bytes.push_back((uint8_t)(0x80 | (u >> 12 & 0x3F)));
+                        bytes.push_back((uint8_t)(0x80 | (u >> 6 & 0x3F)));
+                        bytes.push_back((uint8_t)(0x80 | (u & 0x3F)));
+                    }
+                }
+            }
+            o = bytes.size();
+            memcpy(offsets.data() + (i + 1) * 8, &o, 8);
+        }
+        converted.push_back(std::move(offsets));
+        out.offsets = converted.back().data();
+        converted.push_back(std::move(bytes));
+        out.type = COLUMN_LARGE_UTF8;
+        out.values = converted.back().data();
+        out.bytes = converted.back().size();
+        return true;
+    }
+
+    err = what + (a.structured ? " field '" + f.name + "'" : std::string()) + " has type " + f.descr + ", which can't be read";
+    return false;
+}
+
+std::vector<point2D> loadNpyDataset(const char* filename, LabelDictionary* labels, FeatureScaling* scaling,
+                                    const CsvSchema& schema, LoadProgress* progress){
+    NpyFile file;
+    if(!file.open(filename)){
+        std::cerr << "Failed to read " << filename << ": " << file.error() << "\n";
+        return std::vector<point2D>();
+    }
+    const NpyArray* main = file.find("X");
+    if(!main) main = file.find("x");
+    if(!main) main = &file.arrays()[0];
+
+    // indices are columns of the main array as in a CSV; where it is too narrow
+    // for the CSV defaults (x 2, y 3, label 4), they become x 0, y 1 and the
+    // member y (or column 2)
+    const size_t width = main->problem.empty() ? main->columns() : 0;
+    const CsvColumn* want[3] = { &schema.x, &schema.y, &schema.label };
+    ColumnView views[3];
+    uint64_t rows[3] = { 0, 0, 0 };
+    std::string names[2], labelColumn;
+    for(int k=0;k<3;++k){
+        const CsvColumn &c = *want[k];
+        const NpyArray* a = main;
+        int col = c.index;
+        if(c.name.empty() && c.index == 2 + k && (k < 2 ? width < 4 : width <= 4)){
+            col = k;
+            if(k == 2){
+                const NpyArray* y = file.find("y");
+                if(y && y != main){ a = y; col = 0; }
+                else if(width >= 4 || width <= 2) continue;     // one class
+            }
+        } else if(!c.name.empty()){
+            // a member of that name, else a field of that name in any structured array
+            a = file.find(c.name);
+            col = 0;
+            if(a && a->problem.empty() && a->columns() != 1){
+                std::cerr << "'" << c.name << "' has " << a->columns() << " columns; pick one by index of the main array\n";
+                return std::vector<point2D>();
+            }
+            for(size_t m=0;!a && m<file.arrays().size();++m){
+                const NpyArray &s = file.arrays()[m];
+                for(size_t f=0;s.structured && f<s.fields.size();++f)
+                    if(s.fields[f].name == c.name){ a = &s; col = (int)f; break; }
+            }
+            if(!a){
+                std::cerr << filename << " has no array or field named '" << c.name << "'\n";
+                return std::vector<point2D>();
+            }
+        } else if(k == 2 && col < 0) continue;
+        if(col < 0 || !file.column(*a, (size_t)col, views[k])){
+            std::cerr << "Failed to read " << filename << ": " << (col < 0 ? "no column " + std::to_string(col) : file.error()) << "\n";
+            return std::vector<point2D>();
+        }
+        rows[k] = a->rows();
+        if(k < 2) names[k] = a->structured ? a->fields[(size_t)col].name
+                           : a == main && a->columns() > 1 ? "column " + std::to_string(col) : a->name;
+        if(k == 2) labelColumn = a->structured ? "field " + a->fields[(size_t)col].name
+                               : a == main && a->columns() > 1 ? "column " + std::to_string(col) : "array " + a->name;
+    }
+    if(rows[0] != rows[1] || (views[2].type != COLUMN_NONE && rows[2] != rows[0])){
+        std::cerr << filename << ": the x, y and label columns have different lengths (" << rows[0] << ", " << rows[1] << ", " << rows[2] << ")\n";
+        return std::vector<point2D>();
+    }
+
+    ColumnSource source;
+    source.labelColumn = labelColumn;
+    for(int k=0;k<2;++k) source.featureNames[k] = names[k];
+    ColumnChunk chunk;
+    chunk.rows = rows[0];
+    chunk.x = views[0];
+    chunk.y = views[1];
+    chunk.label = views[2];
+    source.chunks.push_back(chunk);
+    return loadColumns(source, filename, labels, scaling, progress);
+}
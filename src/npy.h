@@ -0,0 +1,75 @@
+//npy.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "column_source.h"
+#include "mapped_file.h"
+
+// One array of a .npy file or of an .npz archive member. Plain arrays are 1-D
+// (one column) or 2-D (shape[1] columns, C or Fortran order); 1-D structured
+// arrays have one column per field. Columns are views into the mapping, with
+// the byte stride of their layout, so neither order needs rearranging.
+struct NpyField{
+    std::string name;           // structured arrays: the field name
+    std::string descr;          // numpy type string, e.g. "<f4"
+    char kind = 0;              // 'f', 'i', 'u', 'b', 'S', 'U', ...
+    int type = COLUMN_NONE;     // ColumnType of the numeric kinds
+    size_t size = 0;            // bytes per value
+    size_t offset = 0;          // within a record
+    bool swap = false;          // big-endian multi-byte values
+};
+
+struct NpyArray{
+    std::string name;           // .npz member without ".npy"; empty for a .npy file
+    std::vector<uint64_t> shape;
+    bool fortran = false;
+    bool structured = false;
+    size_t itemSize = 0;        // bytes per element (a whole record when structured)
+    std::vector<NpyField> fields;   // one for plain arrays
+    const uint8_t* data = nullptr;
+    std::string problem;        // why its columns can't be read (shape, object dtype); empty when they can
+
+    uint64_t rows() const { return shape.empty() ? 0 : shape[0]; }
+    size_t columns() const;
+};
+
+// Reader for NumPy .npy files and .npz archives of them (np.save, np.savez).
+// open() maps the file and parses the array headers and the zip directory,
+// checking every size against the file; data is read in place. Members of an
+// .npz must be stored, not deflated (np.savez, not np.savez_compressed).
+// Big-endian columns and fixed-width string columns ('S', 'U') need a
+// conversion pass; column() does it for the columns that are asked for, into
+// buffers that live as long as the file.
+class NpyFile{
+public:
+    bool open(const char* path);
+    void close();
+    const std::string& error() const { return err; }
+
+    const std::vector<NpyArray>& arrays() const { return list; }
+    const NpyArray* find(const std::string& name) const;     // nullptr when missing
+
+    // column col of array a (a field, a column of a 2-D array, or a 1-D array's
+    // values); false (see error()) when its type or shape can't be read
+    bool column(const NpyArray& a, size_t col, ColumnView& out);
+
+private:
+    MappedFile map;
+    std::vector<NpyArray> list;
+    std::vector<std::vector<uint8_t>> converted;     // swapped values, string offsets and bytes
+    std::string err;
+
+    bool fail(const std::string& message);
+    bool parseArray(const uint8_t* p, uint64_t size, const std::string& name);
+    bool readZip();
+};
+
+// The dataset in a .npy or .npz file. Indices are columns of the main array
+// (the .npy array, or the .npz member "X" or "x", else the first one) as in a
+// CSV, names pick .npz members or structured fields. When the main array is too
+// narrow for the CSV defaults, x and y default to its columns 0 and 1 and the
+// labels to the member "y" or column 2.
+std::vector<point2D> loadNpyDataset(const char* filename, LabelDictionary* labels = nullptr, FeatureScaling* scaling = nullptr,
+                                    const CsvSchema& schema = CsvSchema(), LoadProgress* progress = nullptr);
@@ -0,0 +1,59 @@
+//palette.cpp
+
+#include "palette.h"
+#include <cmath>
+
+static const int kTableSize = 256;
+
+struct ColorTable{
+    float rgb[kTableSize][3];
+    ColorTable(){
+        for(int c=0;c<kTableSize;++c) compute(c, rgb[c]);
+    }
+    static void compute(int c, float out[3]){
+        static const float base[3][3] = { {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f} };
+        if(c < 3){ out[0] = base[c][0]; out[1] = base[c][1]; out[2] = base[c][2]; return; }
+        // HSV with full saturation; value alternates so equal hues a few turns apart still differ
+        float h = std::fmod(c * 137.50776f, 360.0f) / 60.0f;
+        float v = (c / 3) % 2 ? 0.8f : 1.0f;
+        float x = v * (1.0f - std::fabs(std::fmod(h, 2.0f) - 1.0f));
+        int sector = (int)h % 6;
+        float r = 0.0f, g = 0.0f, b = 0.0f;
+        switch(sector){
+            case 0: r = v; g = x; break;
+            case 1: r = x; g = v; break;
+            case 2: g = v; b = x; break;
+            case 3: g = x; b = v; break;
+            case 4: r = x; b = v; break;
+            default: r = v; b = x; break;
+        }
+        out[0] = r; out[1] = g; out[2] = b;
+    }
+};
+
+static const ColorTable& colorTable(){
+    static const ColorTable table;
+    return table;
+}
+
+void classColor(int cls, float &r, float &g, float &b){
+    if(cls < 0) cls = 0;
+    if(cls >= kTableSize){
+        float rgb[3];
+        ColorTable::compute(cls, rgb);
+        r = rgb[0]; g = rgb[1]; b = rgb[2];
+        return;
+    }
+    const float* rgb = colorTable().rgb[cls];
+    r = rgb[0]; g = rgb[1]; b = rgb[2];
+}
+
+void blendClassColors(const float* probs, int numClasses, float &r, float &g, float &b){
+    r = g = b = 0.0f;
+    for(int c=0;c<numClasses;++c){
+        if(probs[c] <= 0.0f) continue;
+        float cr, cg, cb;
+        classColor(c, cr, cg, cb);
+        r += probs[c] * cr; g += probs[c] * cg; b += probs[c] * cb;
+    }
+}
@@ -0,0 +1,10 @@
+//palette.h
+#pragma once
+
+// Class colors shared by every pass that colors by label or probability.
+// Classes 0..2 keep the original blue, green, red; further classes step the
+// hue by the golden angle, so neighbouring labels stay distinguishable at any K.
+void classColor(int cls, float &r, float &g, float &b);
+
+// probability-weighted blend of the class colors
+void blendClassColors(const float* probs, int numClasses, float &r, float &g, float &b);
@@ -0,0 +1,225 @@
+//profiler.cpp
+
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+std::atomic<bool> g_profilerEnabled{false};
+
+static std::atomic<uint64_t> g_allocCount{0}, g_allocBytes{0};
+
+void profilerCountAlloc(size_t bytes){
+    if(!profilerEnabled()) return;
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+
+namespace {
+
+struct Event{
+    const char* name;
+    uint64_t start, end;
+};
+
+// Single-producer (owning thread) / single-consumer (profilerEndFrame) ring
+struct ThreadRing{
+    static const size_t CAPACITY = 1 << 14;
+    Event events[CAPACITY];
+    std::atomic<size_t> head{0};    // written by the producer
+    std::atomic<size_t> tail{0};    // written by the consumer
+    std::atomic<size_t> dropped{0};
+    int tid = 0;
+};
+
+std::mutex g_ringMutex;
+std::vector<ThreadRing*> g_rings;       // never freed; rings of exited threads are reused
+std::vector<ThreadRing*> g_freeRings;
+
+// returns the ring to the free list when its thread exits
+struct RingOwner{
+    ThreadRing* ring = nullptr;
+    ~RingOwner(){
+        if(!ring) return;
+        std::lock_guard<std::mutex> lock(g_ringMutex);
+        g_freeRings.push_back(ring);
+    }
+};
+
+ThreadRing* threadRing(){
+    thread_local RingOwner owner;
+    if(!owner.ring){
+        std::lock_guard<std::mutex> lock(g_ringMutex);
+        if(!g_freeRings.empty()){
+            owner.ring = g_freeRings.back();
+            g_freeRings.pop_back();
+        } else {
+            owner.ring = new ThreadRing();
+            owner.ring->tid = (int)g_rings.size();
+            g_rings.push_back(owner.ring);
+        }
+    }
+    return owner.ring;
+}
+
+struct Phase{
+    double frameMs = 0.0;
+    int frameCalls = 0;
+    double history[PROFILER_WINDOW] = {};
+    int calls[PROFILER_WINDOW] = {};
+    int filled = 0, next = 0;
+};
+
+struct TraceEvent{
+    const char* name;
+    uint64_t start, end;
+    int tid;
+};
+
+const size_t MAX_TRACE_EVENTS = 2000000;
+
+std::unordered_map<const char*, Phase> g_phases;  // keyed by literal address
+std::vector<PhaseStats> g_stats;
+std::vector<ThreadRing*> g_drainRings;           // profilerEndFrame scratch, kept so frames don't allocate
+std::vector<double> g_window;
+AllocStats g_allocStats;
+uint64_t g_allocHistory[PROFILER_WINDOW] = {};
+int g_allocFilled = 0, g_allocNext = 0;
+size_t g_dropped = 0;
+bool g_tracing = false;
+std::vector<TraceEvent> g_trace;
+
+const auto g_epoch = std::chrono::steady_clock::now();
+
+double percentile(std::vector<double>& v, double q){
+    if(v.empty()) return 0.0;
+    size_t k = std::min(v.size() - 1, (size_t)(q * (v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+} // namespace
+
+void setProfilerEnabled(bool enabled){
+    g_profilerEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t profilerNowNs(){
+    // +1 so a valid timestamp is never 0 (0 marks a disabled scope)
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch).count() + 1;
+}
+
+void profilerRecord(const char* name, uint64_t startNs, uint64_t endNs){
+    ThreadRing* r = threadRing();
+    size_t h = r->head.load(std::memory_order_relaxed);
+    if(h - r->tail.load(std::memory_order_acquire) >= ThreadRing::CAPACITY){
+        r->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    r->events[h % ThreadRing::CAPACITY] = Event{name, startNs, endNs};
+    r->head.store(h + 1, std::memory_order_release);
+}
+
+void profilerEndFrame(){
+    {
+        std::lock_guard<std::mutex> lock(g_ringMutex);
+        g_drainRings.assign(g_rings.begin(), g_rings.end());
+    }
+    for(ThreadRing* r : g_drainRings){
+        size_t t = r->tail.load(std::memory_order_relaxed);
+        size_t h = r->head.load(std::memory_order_acquire);
+        for(;t != h;++t){
+            const Event &e = r->events[t % ThreadRing::CAPACITY];
+            Phase &p = g_phases[e.name];
+            p.frameMs += (e.end - e.start) * 1e-6;
+            ++p.frameCalls;
+            if(g_tracing && g_trace.size() < MAX_TRACE_EVENTS) g_trace.push_back({e.name, e.start, e.end, r->tid});
+        }
+        r->tail.store(t, std::memory_order_release);
+        g_dropped += r->dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    uint64_t allocs = g_allocCount.exchange(0, std::memory_order_relaxed);
+    uint64_t allocBytes = g_allocBytes.exchange(0, std::memory_order_relaxed);
+    if(!profilerEnabled()){
+        // stragglers recorded just before disabling do not count towards a frame
+        for(auto &kv : g_phases){ kv.second.frameMs = 0.0; kv.second.frameCalls = 0; }
+        return;
+    }
+    g_allocHistory[g_allocNext] = allocs;
+    g_allocNext = (g_allocNext + 1) % PROFILER_WINDOW;
+    g_allocFilled = std::min(g_allocFilled + 1, PROFILER_WINDOW);
+    g_allocStats.lastAllocs = allocs;
+    g_allocStats.lastBytes = allocBytes;
+    uint64_t sum = 0, peak = 0;
+    for(int i=0;i<g_allocFilled;++i){ sum += g_allocHistory[i]; peak = std::max(peak, g_allocHistory[i]); }
+    g_allocStats.meanAllocs = (double)sum / g_allocFilled;
+    g_allocStats.maxAllocs = peak;
+
+    // close the frame: every known phase gets a sample (0 when it did not run)
+    g_stats.clear();
+    std::vector<double> &window = g_window;
+    window.reserve(PROFILER_WINDOW);
+    for(auto &kv : g_phases){
+        Phase &p = kv.second;
+        p.history[p.next] = p.frameMs;
+        p.calls[p.next] = p.frameCalls;
+        p.next = (p.next + 1) % PROFILER_WINDOW;
+        p.filled = std::min(p.filled + 1, PROFILER_WINDOW);
+        window.assign(p.history, p.history + p.filled);
+        int calls = 0;
+        for(int i=0;i<p.filled;++i) calls += p.calls[i];
+        PhaseStats s;
+        s.name = kv.first;
+        s.lastMs = p.frameMs;
+        s.p50Ms = percentile(window, 0.50);
+        s.p99Ms = percentile(window, 0.99);
+        s.callsPerFrame = (double)calls / p.filled;
+        g_stats.push_back(s);
+        p.frameMs = 0.0;
+        p.frameCalls = 0;
+    }
+    std::sort(g_stats.begin(), g_stats.end(), [](const PhaseStats& a, const PhaseStats& b){ return a.p50Ms > b.p50Ms; });
+}
+
+const std::vector<PhaseStats>& profilerStats(){
+    return g_stats;
+}
+
+const AllocStats& profilerAllocStats(){
+    return g_allocStats;
+}
+
+size_t profilerDroppedEvents(){
+    return g_dropped;
+}
+
+void startProfilerTrace(){
+    g_trace.clear();
+    g_tracing = true;
+}
+
+bool profilerTracing(){
+    return g_tracing;
+}
+
+bool writeProfilerTrace(const char* path){
+    g_tracing = false;
+    FILE* f = fopen(path, "w");
+    if(!f) return false;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for(size_t i=0;i<g_trace.size();++i){
+        const TraceEvent &e = g_trace[i];
+        fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}\n",
+                i ? "," : "", e.name, e.tid, e.start * 1e-3, (e.end - e.start) * 1e-3);
+    }
+    fprintf(f, "]}\n");
+    bool ok = !ferror(f);
+    fclose(f);
+    g_trace.clear();
+    return ok;
+}
@@ -0,0 +1,73 @@
+//profiler.h
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Scoped CPU timers for frame phases. PROFILE_SCOPE("name") records one event
+// (start/end in ns) into a per-thread single-producer ring; the main thread drains
+// all rings once per frame in profilerEndFrame(), which updates the per-phase
+// statistics and, while a trace capture runs, keeps the events for a Chrome
+// trace (chrome://tracing, Perfetto). Names must be string literals.
+// When disabled at runtime a scope costs one relaxed load; building with
+// ML_VIS_NO_PROFILER removes the scopes entirely.
+
+struct PhaseStats{
+    const char* name;
+    double lastMs;          // total time in this phase during the last frame
+    double p50Ms, p99Ms;    // over the last PROFILER_WINDOW frames
+    double callsPerFrame;
+};
+
+const int PROFILER_WINDOW = 240;
+
+extern std::atomic<bool> g_profilerEnabled;
+
+inline bool profilerEnabled(){ return g_profilerEnabled.load(std::memory_order_relaxed); }
+void setProfilerEnabled(bool enabled);
+uint64_t profilerNowNs();
+void profilerRecord(const char* name, uint64_t startNs, uint64_t endNs);
+
+// main thread, once per frame
+void profilerEndFrame();
+const std::vector<PhaseStats>& profilerStats();
+size_t profilerDroppedEvents();
+
+// Heap allocations per frame while the profiler is enabled: every global
+// operator new (replaced in alloc_counter.cpp, linked into the app only) plus
+// allocators routed through profilerCountAlloc (ImGui). Aligned operator new is
+// not counted; nothing on the per-frame path uses it. ML_VIS_NO_PROFILER keeps
+// the default operator new.
+struct AllocStats{
+    uint64_t lastAllocs = 0, lastBytes = 0;     // during the last frame
+    double meanAllocs = 0.0;                    // per frame over the last PROFILER_WINDOW frames
+    uint64_t maxAllocs = 0;
+};
+void profilerCountAlloc(size_t bytes);
+const AllocStats& profilerAllocStats();
+
+// Chrome trace capture: events between start and write are kept (bounded)
+void startProfilerTrace();
+bool profilerTracing();
+bool writeProfilerTrace(const char* path);
+
+class ProfileScope{
+public:
+    explicit ProfileScope(const char* n) : name(n), start(profilerEnabled() ? profilerNowNs() : 0) {}
+    ~ProfileScope(){ if(start) profilerRecord(name, start, profilerNowNs()); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#ifdef ML_VIS_NO_PROFILER
+#define PROFILE_SCOPE(name) ((void)0)
+#else
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#endif
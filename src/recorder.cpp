@@ -0,0 +1,194 @@
+//recorder.cpp
+
+#include "recorder.h"
+#include <GLEW/glew.h>
+#include "image_io.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+FrameRecorder::~FrameRecorder(){
+    stop();
+}
+
+bool FrameRecorder::start(const std::string& outPath, RecordFormat fmt, int w, int h, int framesPerSecond){
+    stop();
+    if(w <= 0 || h <= 0) return false;
+    path = outPath; format = fmt; width = w; height = h; fps = framesPerSecond;
+    frameIndex = 0; framesCaptured = 0; framesWritten = 0; nextSlot = 0;
+
+    if(format == RECORD_Y4M){
+        std::error_code ec;
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if(!parent.empty()) std::filesystem::create_directories(parent, ec);
+        stream = fopen(path.c_str(), "wb");
+        if(!stream){ std::cerr << "recorder: cannot open " << path << "\n"; return false; }
+        // C420jpeg: full-range BT.601 chroma, planes rounded up for odd sizes
+        fprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+    } else {
+        std::error_code ec;
+        std::filesystem::create_directories(path, ec);
+    }
+
+    for(auto &s : slots){
+        glGenBuffers(1, &s.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, nullptr, GL_STREAM_READ);
+        s.state = SLOT_FREE;
+        s.fence = nullptr;
+        s.pixels = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    quit = false;
+    encoder = std::thread(&FrameRecorder::encoderLoop, this);
+    active = true;
+    return true;
+}
+
+void FrameRecorder::releaseDone(){
+    for(auto &s : slots){
+        if(s.state != SLOT_DONE) continue;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        s.pixels = nullptr;
+        s.state = SLOT_FREE;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameRecorder::mapOldest(bool wait){
+    if(inFlight.empty()) return;
+    Slot &s = slots[inFlight.front()];
+    GLsync fence = (GLsync)s.fence;
+    if(!wait){
+        if(glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) return;
+    } else {
+        while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED) {}
+    }
+    glDeleteSync(fence);
+    s.fence = nullptr;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    s.pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    int idx = inFlight.front();
+    inFlight.pop_front();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        s.state = SLOT_MAPPED;
+        queue.push_back(idx);
+    }
+    cv.notify_all();
+}
+
+void FrameRecorder::capture(int frameNumber){
+    if(!active) return;
+    auto t0 = std::chrono::steady_clock::now();
+    releaseDone();
+    // hand over every frame whose readback already finished, without waiting
+    size_t before;
+    do { before = inFlight.size(); mapOldest(false); } while(!inFlight.empty() && inFlight.size() < before);
+
+    Slot &s = slots[nextSlot];
+    // ring full: force the oldest readback, then wait for the encoder if it is behind
+    while(s.state == SLOT_READING) mapOldest(true);
+    if(s.state == SLOT_MAPPED){
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]{ return s.state != SLOT_MAPPED; });
+    }
+    releaseDone();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.fence = (void*)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush(); // make sure the fence reaches the GPU even without a swap (headless)
+    s.frameNumber = frameNumber >= 0 ? frameNumber : frameIndex;
+    s.state = SLOT_READING;
+    inFlight.push_back(nextSlot);
+    nextSlot = (nextSlot + 1) % RING;
+    ++frameIndex;
+    ++framesCaptured;
+    lastCaptureMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void FrameRecorder::stop(){
+    if(!active) return;
+    while(!inFlight.empty()) mapOldest(true);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]{
+            for(auto &s : slots) if(s.state == SLOT_MAPPED) return false;
+            return true;
+        });
+        quit = true;
+    }
+    cv.notify_all();
+    encoder.join();
+    releaseDone();
+    for(auto &s : slots){ glDeleteBuffers(1, &s.pbo); s.pbo = 0; }
+    if(stream){ fclose(stream); stream = nullptr; }
+    active = false;
+}
+
+void FrameRecorder::encoderLoop(){
+    for(;;){
+        int idx;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]{ return quit || !queue.empty(); });
+            if(queue.empty()) return;
+            idx = queue.front();
+            queue.pop_front();
+        }
+        encode(slots[idx]);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slots[idx].state = SLOT_DONE;
+        }
+        cv.notify_all();
+        ++framesWritten;
+    }
+}
+
+void FrameRecorder::encode(const Slot& s){
+    if(!s.pixels) return;
+    if(format == RECORD_PNG){
+        char name[64];
+        snprintf(name, sizeof(name), "/frame_%06d.png", s.frameNumber);
+        if(!writePNG((path + name).c_str(), width, height, s.pixels)) std::cerr << "recorder: failed to write " << path << name << "\n";
+        return;
+    }
+
+    // RGBA (bottom-up) -> I420 full-range BT.601, chroma averaged over 2x2 blocks
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+    yuv.resize((size_t)width * height + 2 * (size_t)cw * ch);
+    unsigned char* Y = yuv.data();
+    unsigned char* U = Y + (size_t)width * height;
+    unsigned char* V = U + (size_t)cw * ch;
+    const size_t stride = (size_t)width * 4;
+    auto luma = [](const unsigned char* p){ return (unsigned char)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8); };
+    // two output rows per pass; source rows are bottom-up
+    for(int cy=0;cy<ch;++cy){
+        int y0 = cy * 2, y1 = std::min(y0 + 1, height - 1);
+        const unsigned char* row0 = s.pixels + stride * (height - 1 - y0);
+        const unsigned char* row1 = s.pixels + stride * (height - 1 - y1);
+        unsigned char* Y0 = Y + (size_t)y0 * width;
+        unsigned char* Y1 = Y + (size_t)y1 * width;
+        for(int cx=0;cx<cw;++cx){
+            int x0 = cx * 2, x1 = std::min(x0 + 1, width - 1);
+            const unsigned char *a = row0 + x0 * 4, *b = row0 + x1 * 4, *c = row1 + x0 * 4, *d = row1 + x1 * 4;
+            Y0[x0] = luma(a); Y0[x1] = luma(b);
+            Y1[x0] = luma(c); Y1[x1] = luma(d);
+            int r = (a[0] + b[0] + c[0] + d[0] + 2) >> 2;
+            int g = (a[1] + b[1] + c[1] + d[1] + 2) >> 2;
+            int bl = (a[2] + b[2] + c[2] + d[2] + 2) >> 2;
+            U[(size_t)cy * cw + cx] = (unsigned char)(((-43 * r - 85 * g + 128 * bl + 128) >> 8) + 128);
+            V[(size_t)cy * cw + cx] = (unsigned char)(((128 * r - 107 * g - 21 * bl + 128) >> 8) + 128);
+        }
+    }
+    fputs("FRAME\n", stream);
+    fwrite(yuv.data(), 1, yuv.size(), stream);
+}
@@ -0,0 +1,72 @@
+//recorder.h
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cstddef>
+
+// Frame capture without pipeline stalls: glReadPixels goes into a ring of pixel
+// buffer objects guarded by fences, and a PBO is only mapped once its fence has
+// signaled (at the latest RING-1 frames later). The mapped memory is handed
+// directly to an encoder thread that writes a PNG sequence or an uncompressed
+// Y4M (I420) stream; the render thread only unmaps the buffer afterwards.
+
+enum RecordFormat{
+    RECORD_PNG = 0,   // <path>/frame_000000.png, ...
+    RECORD_Y4M = 1    // single <path> .y4m stream
+};
+
+class FrameRecorder{
+public:
+    ~FrameRecorder();
+
+    // must be called with the GL context current; width/height of the captured framebuffer
+    bool start(const std::string& path, RecordFormat format, int width, int height, int fps = 30);
+    // queue a readback of the currently bound read framebuffer; frameNumber names PNG files (-1 = running index)
+    void capture(int frameNumber = -1);
+    // drain all in-flight frames, join the encoder and close the output
+    void stop();
+    bool recording() const { return active; }
+
+    double lastCaptureMs = 0.0;     // render-thread cost of the last capture()
+    size_t framesCaptured = 0;
+    std::atomic<size_t> framesWritten{0};
+
+private:
+    static const int RING = 3;
+    enum SlotState{ SLOT_FREE, SLOT_READING, SLOT_MAPPED, SLOT_DONE };
+    struct Slot{
+        unsigned int pbo = 0;
+        void* fence = nullptr;      // GLsync
+        std::atomic<int> state{SLOT_FREE};
+        const unsigned char* pixels = nullptr;
+        int frameNumber = 0;
+    };
+
+    Slot slots[RING];
+    std::deque<int> inFlight;       // READING slots in capture order
+    int nextSlot = 0;
+    bool active = false;
+    RecordFormat format = RECORD_PNG;
+    std::string path;
+    int width = 0, height = 0, fps = 30, frameIndex = 0;
+    FILE* stream = nullptr;
+    std::vector<unsigned char> yuv; // encoder-thread scratch for Y4M
+
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<int> queue;          // MAPPED slots waiting for the encoder
+    bool quit = false;
+
+    void releaseDone();
+    void mapOldest(bool wait);
+    void encoderLoop();
+    void encode(const Slot& slot);
+};
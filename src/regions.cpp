@@ -0,0 +1,115 @@
+//regions.cpp
+
+#include "regions.h"
+#include <algorithm>
+#include <cmath>
+
+static const double kEps = 1e-9;
+
+static double cross(double ax, double ay, double bx, double by){ return ax * by - ay * bx; }
+
+void ArgmaxRegions::build(const LogisticModel& model, float x0, float y0, float x1, float y1){
+    edges.clear();
+    junctions.clear();
+    nonEmpty = 0;
+    const int K = model.numClasses;
+    planes.reserve(K + 3);
+    hull.resize(K + 3);
+    vx.resize(K + 3); vy.resize(K + 3);
+
+    // logits at the rectangle corners: a class beaten at all four corners by one
+    // other class is beaten on the whole rectangle (the difference is linear),
+    // which rejects most empty regions before any sorting
+    const float cx[4] = { x0, x1, x1, x0 }, cy[4] = { y0, y0, y1, y1 };
+    corners.resize((size_t)K * 4);
+    for(int c=0;c<K;++c)
+        for(int k=0;k<4;++k) corners[c*4+k] = model.W[c][0] + model.W[c][1] * cx[k] + model.W[c][2] * cy[k];
+    auto dominated = [&](int c){
+        const float* lc = &corners[c*4];
+        for(int j=0;j<K;++j){
+            const float* lj = &corners[j*4];
+            if(j != c && lj[0] > lc[0] && lj[1] > lc[1] && lj[2] > lc[2] && lj[3] > lc[3]) return true;
+        }
+        return false;
+    };
+
+    for(int c=0;c<K;++c){
+        if(dominated(c)) continue;
+        planes.clear();
+        // rectangle sides, inside on the left: bottom, right, top, left
+        planes.push_back({x0, y0, 1.0, 0.0, 0.0, -1});
+        planes.push_back({x1, y0, 0.0, 1.0, 0.0, -1});
+        planes.push_back({x1, y1, -1.0, 0.0, 0.0, -1});
+        planes.push_back({x0, y1, 0.0, -1.0, 0.0, -1});
+        bool empty = false;
+        for(int j=0;j<K && !empty;++j){
+            if(j == c) continue;
+            // a x + b y + d >= 0 keeps class c ahead of class j
+            double a = (double)model.W[c][1] - model.W[j][1];
+            double b = (double)model.W[c][2] - model.W[j][2];
+            double d = (double)model.W[c][0] - model.W[j][0];
+            double len = std::sqrt(a * a + b * b);
+            if(len < kEps){
+                // parallel logits: j beats c everywhere or nowhere (ties go to the lower index)
+                if(d < 0.0 || (d == 0.0 && j < c)) empty = true;
+                continue;
+            }
+            a /= len; b /= len; d /= len;
+            planes.push_back({-a * d, -b * d, b, -a, 0.0, j});
+        }
+        if(empty || !intersect()) continue;
+        ++nonEmpty;
+
+        const size_t n = tail - head;
+        for(size_t i=0;i<n;++i){
+            const HalfPlane &p = hull[head + i], &q = hull[head + (i + 1) % n];
+            double t = cross(q.dx, q.dy, q.px - p.px, q.py - p.py) / cross(q.dx, q.dy, p.dx, p.dy);
+            vx[i] = p.px + p.dx * t;
+            vy[i] = p.py + p.dy * t;
+        }
+        for(size_t i=0;i<n;++i){
+            // the edge on plane i runs from vertex i-1 to vertex i
+            const HalfPlane &p = hull[head + i];
+            size_t prev = (i + n - 1) % n;
+            if(p.src > c && std::fabs(vx[i] - vx[prev]) + std::fabs(vy[i] - vy[prev]) > 1e-7)
+                edges.push_back({(float)vx[prev], (float)vy[prev], (float)vx[i], (float)vy[i], c, p.src});
+            // vertex i joins planes i and i+1; three classes meet there, reported by the lowest
+            const HalfPlane &q = hull[head + (i + 1) % n];
+            if(p.src > c && q.src > c && p.src != q.src) junctions.push_back({(float)vx[i], (float)vy[i]});
+        }
+    }
+}
+
+bool ArgmaxRegions::intersect(){
+    // pseudo-angle in (-2, 2], monotone in atan2(dy, dx) but without the trig;
+    // dy == 0 counts as the upper half, so (-1, -0) sorts at 2 like (-1, 0)
+    for(auto &p : planes){
+        double t = p.dx / (std::fabs(p.dx) + std::fabs(p.dy));
+        p.angle = p.dy >= 0.0 ? 1.0 - t : t - 1.0;
+    }
+    std::sort(planes.begin(), planes.end(), [](const HalfPlane& a, const HalfPlane& b){ return a.angle < b.angle; });
+    auto out = [](const HalfPlane& p, double x, double y){ return cross(p.dx, p.dy, x - p.px, y - p.py) < -kEps; };
+    auto meet = [](const HalfPlane& p, const HalfPlane& q, double &x, double &y){
+        double t = cross(q.dx, q.dy, q.px - p.px, q.py - p.py) / cross(q.dx, q.dy, p.dx, p.dy);
+        x = p.px + p.dx * t; y = p.py + p.dy * t;
+    };
+
+    // only the back grows, so the deque is the window [head, tail) of hull
+    head = tail = 0;
+    double x, y;
+    for(const HalfPlane &h : planes){
+        while(tail - head > 1){ meet(hull[tail-2], hull[tail-1], x, y); if(!out(h, x, y)) break; --tail; }
+        while(tail - head > 1){ meet(hull[head], hull[head+1], x, y); if(!out(h, x, y)) break; ++head; }
+        if(tail > head && std::fabs(cross(h.dx, h.dy, hull[tail-1].dx, hull[tail-1].dy)) < kEps){
+            // parallel: opposite directions here mean an empty intersection,
+            // equal directions keep the more restrictive plane
+            if(h.dx * hull[tail-1].dx + h.dy * hull[tail-1].dy < 0.0) return false;
+            if(!out(h, hull[tail-1].px, hull[tail-1].py)) continue;
+            --tail;
+        }
+        hull[tail++] = h;
+    }
+    while(tail - head > 2){ meet(hull[tail-2], hull[tail-1], x, y); if(!out(hull[head], x, y)) break; --tail; }
+    while(tail - head > 2){ meet(hull[head], hull[head+1], x, y); if(!out(hull[tail-1], x, y)) break; ++head; }
+    return tail - head >= 3;
+}
@@ -0,0 +1,44 @@
+//regions.h
+#pragma once
+
+#include <vector>
+#include "model.h"
+
+// Exact argmax regions of a linear softmax model inside a view rectangle.
+// Class c wins where (W[c] - W[j]) . (1, x, y) >= 0 for every j != c, so its
+// region is the intersection of K-1 half-planes and the 4 rectangle sides: a
+// convex polygon, found by the sort-by-angle half-plane intersection in
+// O(K log K). All K regions cost O(K^2 log K); each shared boundary segment
+// is reported once, and so is each point where three or more regions meet.
+struct ArgmaxRegions{
+    struct Edge{
+        float x0, y0, x1, y1;
+        int a, b;                   // the two classes it separates, a < b
+    };
+    struct Junction{
+        float x, y;
+    };
+
+    std::vector<Edge> edges;
+    std::vector<Junction> junctions;
+    int nonEmpty = 0;               // classes with a visible region
+
+    // buffers are reused, so a steady build does not allocate
+    void build(const LogisticModel& model, float x0, float y0, float x1, float y1);
+
+private:
+    struct HalfPlane{
+        double px, py;              // point on the line
+        double dx, dy;              // unit direction, inside on the left
+        double angle;
+        int src;                    // competing class, -1 for a rectangle side
+    };
+    std::vector<HalfPlane> planes;
+    std::vector<HalfPlane> hull;    // deque of the intersection, used as [head, tail)
+    std::vector<double> vx, vy;
+    std::vector<float> corners;     // K x 4 corner logits
+
+    size_t head = 0, tail = 0;
+
+    bool intersect();               // polygon of planes in hull[head, tail), false if empty
+};
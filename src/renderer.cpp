@@ -1,28 +1,43 @@
 //renderer.cpp
 
 #include "renderer.h"
+#include "scene.h"
+#include "profiler.h"
+#include "gpu_timer.h"
+#include "palette.h"
 #include <GLEW/glew.h>
 #include <GLFW/glfw3.h>
 #include <cmath>
 #include <cstdio>
+#include <algorithm>
 
 //GPU rendering
 unsigned int VAO_points = 0, VBO_points = 0;
+size_t point_capacity = 0;
 unsigned int VAO_axes = 0, VBO_axes = 0;
 unsigned int shaderProgram = 0;
 unsigned int VAO_boundary = 0, VBO_boundary = 0;
+int boundary_capacity = 0, boundary_count = 0;
 unsigned int VAO_bg = 0, VBO_bg = 0;
+unsigned int VAO_bgquad = 0, VBO_bgquad = 0;
+int bgquad_capacity = 0, bgquad_count = 0;
+unsigned int VAO_contour = 0, VBO_contour = 0;
+int contour_capacity = 0, contour_count = 0;
 unsigned int VAO_loss = 0, VBO_loss = 0;
 unsigned int VAO_test = 0, VBO_test = 0;
 unsigned int VAO_inter = 0, VBO_inter = 0;
+unsigned int densityProgram = 0, VAO_density = 0, VBO_density = 0, densityTexture = 0;
+int density_w = 0, density_h = 0;
 int bg_cols = 0, bg_rows = 0;
 int loss_point_count = 0;
 int test_point_count = 0;
-int inter_point_count = 0;
+int inter_capacity = 0, inter_point_count = 0;
+int axis_vertex_count = 0;
 
 //global variable
 int windowWidth = 800;
 int windowHeight = 600;
+ViewTransform currentView;
 
 int mapX(float xNorm, int width){
     return int((xNorm + 1.0f) * 0.5f * width);
@@ -53,7 +68,8 @@ static GLuint createSimpleProgram(){
                      "layout(location = 0) in vec2 aPos;\n"
                      "layout(location = 1) in vec3 aColor;\n"
                      "out vec3 vColor;\n"
-                     "void main(){ vColor = aColor; gl_Position = vec4(aPos, 0.0, 1.0); }\n";
+                     "uniform vec4 u_view; // xy = scale, zw = offset\n"
+                     "void main(){ vColor = aColor; gl_Position = vec4(aPos * u_view.xy + u_view.zw, 0.0, 1.0); }\n";
     const char* fs = "#version 330 core\n"
                      "in vec3 vColor;\n"
                      "out vec4 FragColor;\n"
@@ -76,6 +92,40 @@ static GLuint createSimpleProgram(){
     return p;
 }
 
+static GLuint createTextureProgram(){
+    const char* vs = "#version 330 core\n"
+                     "layout(location = 0) in vec2 aPos;\n"
+                     "layout(location = 1) in vec2 aUV;\n"
+                     "out vec2 vUV;\n"
+                     "void main(){ vUV = aUV; gl_Position = vec4(aPos, 0.0, 1.0); }\n";
+    const char* fs = "#version 330 core\n"
+                     "in vec2 vUV;\n"
+                     "out vec4 FragColor;\n"
+                     "uniform sampler2D u_tex;\n"
+                     "void main(){ FragColor = texture(u_tex, vUV); }\n";
+    GLuint v = compileShader(GL_VERTEX_SHADER, vs);
+    GLuint f = compileShader(GL_FRAGMENT_SHADER, fs);
+    GLuint p = glCreateProgram();
+    glAttachShader(p, v);
+    glAttachShader(p, f);
+    glLinkProgram(p);
+    GLint ok = 0; glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if(!ok){ char buf[1024]; buf[0]=0; glGetProgramInfoLog(p, sizeof(buf), NULL, buf); fprintf(stderr, "Program link error: %s\n", buf); }
+    glDeleteShader(v); glDeleteShader(f);
+    return p;
+}
+
+void setViewTransform(const ViewTransform& view){
+    currentView = view;
+}
+
+// upload the view uniform: data-space passes use the zoom/pan, overlays use identity
+static void applyView(bool dataSpace){
+    GLint loc_view = glGetUniformLocation(shaderProgram, "u_view");
+    if(dataSpace) glUniform4f(loc_view, currentView.zoom, currentView.zoom, -currentView.cx * currentView.zoom, -currentView.cy * currentView.zoom);
+    else glUniform4f(loc_view, 1.0f, 1.0f, 0.0f, 0.0f);
+}
+
 void initRenderer(const std::vector<Vertex>& pointVertices, const std::vector<Vertex>& axisVertices){
     // create shader program
     shaderProgram = createSimpleProgram();
@@ -86,6 +136,7 @@ void initRenderer(const std::vector<Vertex>& pointVertices, const std::vector<Ve
     glBindVertexArray(VAO_points);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_points);
     glBufferData(GL_ARRAY_BUFFER, pointVertices.size()*sizeof(Vertex), pointVertices.data(), GL_DYNAMIC_DRAW);
+    point_capacity = pointVertices.size();
     // Position attribute
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
     glEnableVertexAttribArray(0);
@@ -99,22 +150,20 @@ void initRenderer(const std::vector<Vertex>& pointVertices, const std::vector<Ve
     glBindVertexArray(VAO_axes);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_axes);
     glBufferData(GL_ARRAY_BUFFER, axisVertices.size()*sizeof(Vertex), axisVertices.data(), GL_STATIC_DRAW);
+    axis_vertex_count = (int)axisVertices.size();
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2*sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    // Boundary VAO/VBO (up to three pairwise lines -> 6 vertices)
+    // Boundary VAO/VBO: region boundary line list, grown by updateBoundaryLines
     glGenVertexArrays(1, &VAO_boundary);
     glGenBuffers(1, &VBO_boundary);
     glBindVertexArray(VAO_boundary);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_boundary);
-    Vertex boundaryInit[6] = {
-        {-1.0f, 0.0f, 1,1,0}, {1.0f, 0.0f, 1,1,0},
-        {-1.0f, 0.0f, 1,1,0}, {1.0f, 0.0f, 1,1,0},
-        {-1.0f, 0.0f, 1,1,0}, {1.0f, 0.0f, 1,1,0}
-    };
-    glBufferData(GL_ARRAY_BUFFER, sizeof(boundaryInit), boundaryInit, GL_DYNAMIC_DRAW);
+    boundary_capacity = 64;
+    boundary_count = 0;
+    glBufferData(GL_ARRAY_BUFFER, boundary_capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2*sizeof(float)));
@@ -163,8 +212,11 @@ void updateBackgroundGrid(const std::vector<Vertex>& gridVertices){
 }
 
 void drawBackgroundGrid(){
+    PROFILE_SCOPE("drawBackgroundGrid");
+    GPU_PASS_SCOPE("drawBackgroundGrid");
     if(!shaderProgram || !VAO_bg) return;
     glUseProgram(shaderProgram);
+    applyView(true);
     glBindVertexArray(VAO_bg);
     // Subtle, slightly transparent points blended with a smoky base
     GLint loc_smoke = glGetUniformLocation(shaderProgram, "u_smoke_color");
@@ -182,6 +234,119 @@ void drawBackgroundGrid(){
     glUseProgram(0);
 }
 
+void initBackgroundQuads(int maxVertices){
+    if(VAO_bgquad) { glDeleteVertexArrays(1, &VAO_bgquad); glDeleteBuffers(1, &VBO_bgquad); }
+    glGenVertexArrays(1, &VAO_bgquad);
+    glGenBuffers(1, &VBO_bgquad);
+    glBindVertexArray(VAO_bgquad);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_bgquad);
+    glBufferData(GL_ARRAY_BUFFER, maxVertices * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2*sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    bgquad_capacity = maxVertices;
+    bgquad_count = 0;
+}
+
+void updateBackgroundQuads(const std::vector<Vertex>& triangles){
+    PROFILE_SCOPE("updateBackgroundQuads");
+    if(!VAO_bgquad || !VBO_bgquad) return;
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_bgquad);
+    if((int)triangles.size() > bgquad_capacity){
+        // grow geometrically so refinement changes don't reallocate every frame
+        bgquad_capacity = std::max((int)triangles.size(), bgquad_capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, bgquad_capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, triangles.size()*sizeof(Vertex), triangles.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    bgquad_count = (int)triangles.size();
+}
+
+void drawBackgroundQuads(){
+    PROFILE_SCOPE("drawBackgroundQuads");
+    GPU_PASS_SCOPE("drawBackgroundQuads");
+    if(!shaderProgram || !VAO_bgquad) return;
+    glUseProgram(shaderProgram);
+    applyView(true);
+    glBindVertexArray(VAO_bgquad);
+    // same smoky blend as the point grid
+    GLint loc_smoke = glGetUniformLocation(shaderProgram, "u_smoke_color");
+    GLint loc_mix = glGetUniformLocation(shaderProgram, "u_smoke_mix");
+    GLint loc_alpha = glGetUniformLocation(shaderProgram, "u_alpha");
+    glUniform3f(loc_smoke, 0.08f, 0.09f, 0.12f);
+    glUniform1f(loc_mix, 0.45f);
+    glUniform1f(loc_alpha, 0.85f);
+    if(bgquad_count > 0) glDrawArrays(GL_TRIANGLES, 0, bgquad_count);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+void initDensityTexture(){
+    if(!densityProgram) densityProgram = createTextureProgram();
+    if(VAO_density) { glDeleteVertexArrays(1, &VAO_density); glDeleteBuffers(1, &VBO_density); }
+    if(densityTexture) glDeleteTextures(1, &densityTexture);
+    // full-view quad as a triangle strip: x, y, u, v
+    const float quad[16] = {
+        -1.0f, -1.0f, 0.0f, 0.0f,
+         1.0f, -1.0f, 1.0f, 0.0f,
+        -1.0f,  1.0f, 0.0f, 1.0f,
+         1.0f,  1.0f, 1.0f, 1.0f
+    };
+    glGenVertexArrays(1, &VAO_density);
+    glGenBuffers(1, &VBO_density);
+    glBindVertexArray(VAO_density);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_density);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)(2*sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    glGenTextures(1, &densityTexture);
+    glBindTexture(GL_TEXTURE_2D, densityTexture);
+    // one texel per screen pixel, no filtering
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    density_w = 0; density_h = 0;
+}
+
+void updateDensityTexture(int width, int height, const std::vector<unsigned char>& rgba){
+    PROFILE_SCOPE("updateDensityTexture");
+    if(!densityTexture || rgba.size() < (size_t)width * height * 4) return;
+    glBindTexture(GL_TEXTURE_2D, densityTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if(width != density_w || height != density_h){
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        density_w = width; density_h = height;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void drawDensity(){
+    PROFILE_SCOPE("drawDensity");
+    GPU_PASS_SCOPE("drawDensity");
+    if(!densityProgram || !VAO_density || !density_w) return;
+    glUseProgram(densityProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, densityTexture);
+    glUniform1i(glGetUniformLocation(densityProgram, "u_tex"), 0);
+    glBindVertexArray(VAO_density);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+
 void initLossPlot(int maxPoints){
     if(VAO_loss) { glDeleteVertexArrays(1, &VAO_loss); glDeleteBuffers(1, &VBO_loss); }
     glGenVertexArrays(1, &VAO_loss);
@@ -198,6 +363,7 @@ void initLossPlot(int maxPoints){
 }
 
 void updateLossPlot(const std::vector<Vertex>& plotVertices){
+    PROFILE_SCOPE("updateLossPlot");
     if(!VAO_loss || !VBO_loss) return;
     glBindBuffer(GL_ARRAY_BUFFER, VBO_loss);
     glBufferSubData(GL_ARRAY_BUFFER, 0, plotVertices.size()*sizeof(Vertex), plotVertices.data());
@@ -206,8 +372,11 @@ void updateLossPlot(const std::vector<Vertex>& plotVertices){
 }
 
 void drawLossPlot(){
+    PROFILE_SCOPE("drawLossPlot");
+    GPU_PASS_SCOPE("drawLossPlot");
     if(!shaderProgram || !VAO_loss) return;
     glUseProgram(shaderProgram);
+    applyView(false);
     glBindVertexArray(VAO_loss);
     // ensure full opacity for plot lines
     GLint loc_mix = glGetUniformLocation(shaderProgram, "u_smoke_mix");
@@ -221,8 +390,11 @@ void drawLossPlot(){
 }
 
 void drawPoints(size_t numPoints){
+    PROFILE_SCOPE("drawPoints");
+    GPU_PASS_SCOPE("drawPoints");
     if(!shaderProgram) return;
     glUseProgram(shaderProgram);
+    applyView(true);
     glBindVertexArray(VAO_points);
     // Draw dataset points fully opaque (no smoke mix)
     GLint loc_mix = glGetUniformLocation(shaderProgram, "u_smoke_mix");
@@ -238,8 +410,11 @@ void drawPoints(size_t numPoints){
 }
 
 void drawLines(size_t numVertices){
+    PROFILE_SCOPE("drawLines");
+    GPU_PASS_SCOPE("drawLines");
     if(!shaderProgram) return;
     glUseProgram(shaderProgram);
+    applyView(true);
     glBindVertexArray(VAO_axes);
     // Axes are opaque
     GLint loc_mix = glGetUniformLocation(shaderProgram, "u_smoke_mix");
@@ -254,6 +429,8 @@ void drawLines(size_t numVertices){
 }
 
 void updateVertices(const std::vector<Vertex>& vertices){
+    // the buffer holds the visible points only, so it is sized by them
+    reservePointVertices(vertices.size());
     glBindBuffer(GL_ARRAY_BUFFER, VBO_points);
     glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size()*sizeof(Vertex), vertices.data());
 }
@@ -262,6 +439,7 @@ void setPointVertices(const std::vector<Vertex>& vertices){
     glBindVertexArray(VAO_points);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_points);
     glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(Vertex), vertices.data(), GL_DYNAMIC_DRAW);
+    point_capacity = vertices.size();
     // re-specify attributes in case driver state changed
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
     glEnableVertexAttribArray(0);
@@ -271,6 +449,16 @@ void setPointVertices(const std::vector<Vertex>& vertices){
     glBindVertexArray(0);
 }
 
+void reservePointVertices(size_t count){
+    if(count <= point_capacity) return;
+    // doubling keeps the reallocations of a growing dataset amortized O(1) per point;
+    // the contents are rewritten by updateVertices every frame anyway
+    point_capacity = std::max(count, point_capacity * 2);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_points);
+    glBufferData(GL_ARRAY_BUFFER, point_capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 // Convert Iris dataset to Vertex array
 std::vector<Vertex> irisToVertex(const std::vector<point2D>& data){
     std::vector<Vertex> vertices;
@@ -278,9 +466,7 @@ std::vector<Vertex> irisToVertex(const std::vector<point2D>& data){
         Vertex v;
         v.x = p.x;
         v.y = p.y;
-        if(p.label == 0){ v.r=0; v.g=0; v.b=1; }       // Blue
-        else if(p.label==1){ v.r=0; v.g=1; v.b=0; }    // Green
-        else{ v.r=1; v.g=0; v.b=0; }                   // Red
+        classColor(p.label, v.r, v.g, v.b);
         vertices.push_back(v);
     }
     return vertices;
@@ -348,28 +534,76 @@ void drawLineManual(int x0, int y0, int x1, int y1, int r, int g, int b){
 }
 
 void updateBoundaryLines(const std::vector<Vertex>& lineVertices){
-    // Expect up to 6 vertices (3 lines). If fewer provided, pad with off-screen values.
-    Vertex tmp[6];
-    size_t n = lineVertices.size();
-    for(size_t i=0;i<6;++i){
-        if(i < n) tmp[i] = lineVertices[i];
-        else tmp[i] = {10.0f, 10.0f, 1,1,0};
-    }
+    if(!VAO_boundary || !VBO_boundary) return;
     glBindBuffer(GL_ARRAY_BUFFER, VBO_boundary);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(tmp), tmp);
+    if((int)lineVertices.size() > boundary_capacity){
+        boundary_capacity = std::max((int)lineVertices.size(), boundary_capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, boundary_capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, lineVertices.size()*sizeof(Vertex), lineVertices.data());
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    boundary_count = (int)lineVertices.size();
 }
 
 void drawBoundary(){
+    PROFILE_SCOPE("drawBoundary");
+    GPU_PASS_SCOPE("drawBoundary");
     if(!shaderProgram) return;
     glUseProgram(shaderProgram);
+    applyView(true);
     glBindVertexArray(VAO_boundary);
     // Decision boundary lines should remain visible
     GLint loc_mix = glGetUniformLocation(shaderProgram, "u_smoke_mix");
     GLint loc_alpha = glGetUniformLocation(shaderProgram, "u_alpha");
     glUniform1f(loc_mix, 0.0f);
     glUniform1f(loc_alpha, 1.0f);
-    glDrawArrays(GL_LINES, 0, 6);
+    if(boundary_count > 0) glDrawArrays(GL_LINES, 0, boundary_count);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+void initContours(int maxVertices){
+    if(VAO_contour){ glDeleteVertexArrays(1, &VAO_contour); glDeleteBuffers(1, &VBO_contour); }
+    glGenVertexArrays(1, &VAO_contour);
+    glGenBuffers(1, &VBO_contour);
+    glBindVertexArray(VAO_contour);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_contour);
+    glBufferData(GL_ARRAY_BUFFER, maxVertices * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2*sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    contour_capacity = maxVertices;
+    contour_count = 0;
+}
+
+void updateContours(const std::vector<Vertex>& lineVertices){
+    PROFILE_SCOPE("updateContours");
+    if(!VAO_contour || !VBO_contour) return;
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_contour);
+    if((int)lineVertices.size() > contour_capacity){
+        contour_capacity = std::max((int)lineVertices.size(), contour_capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, contour_capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, lineVertices.size()*sizeof(Vertex), lineVertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    contour_count = (int)lineVertices.size();
+}
+
+void drawContours(){
+    PROFILE_SCOPE("drawContours");
+    GPU_PASS_SCOPE("drawContours");
+    if(!shaderProgram || !VAO_contour) return;
+    glUseProgram(shaderProgram);
+    applyView(true);
+    glBindVertexArray(VAO_contour);
+    GLint loc_mix = glGetUniformLocation(shaderProgram, "u_smoke_mix");
+    GLint loc_alpha = glGetUniformLocation(shaderProgram, "u_alpha");
+    glUniform1f(loc_mix, 0.0f);
+    glUniform1f(loc_alpha, 0.9f);
+    if(contour_count > 0) glDrawArrays(GL_LINES, 0, contour_count);
     glBindVertexArray(0);
     glUseProgram(0);
 }
@@ -398,8 +632,11 @@ void updateTestPoints(const std::vector<Vertex>& testVertices){
 }
 
 void drawTestPoints(){
+    PROFILE_SCOPE("drawTestPoints");
+    GPU_PASS_SCOPE("drawTestPoints");
     if(!shaderProgram || !VAO_test) return;
     glUseProgram(shaderProgram);
+    applyView(true);
     glBindVertexArray(VAO_test);
     // Test points should be prominent
     GLint loc_mix = glGetUniformLocation(shaderProgram, "u_smoke_mix");
@@ -425,20 +662,28 @@ void initIntersections(int maxPoints){
     glEnableVertexAttribArray(1);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+    inter_capacity = maxPoints;
     inter_point_count = 0;
 }
 
 void updateIntersections(const std::vector<Vertex>& pts){
     if(!VAO_inter || !VBO_inter) return;
     glBindBuffer(GL_ARRAY_BUFFER, VBO_inter);
+    if((int)pts.size() > inter_capacity){
+        inter_capacity = std::max((int)pts.size(), inter_capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, inter_capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    }
     glBufferSubData(GL_ARRAY_BUFFER, 0, pts.size()*sizeof(Vertex), pts.data());
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     inter_point_count = (int)pts.size();
 }
 
 void drawIntersections(){
+    PROFILE_SCOPE("drawIntersections");
+    GPU_PASS_SCOPE("drawIntersections");
     if(!shaderProgram || !VAO_inter) return;
     glUseProgram(shaderProgram);
+    applyView(true);
     glBindVertexArray(VAO_inter);
     glPointSize(6.0f);
     // ensure full opacity
@@ -449,4 +694,52 @@ void drawIntersections(){
     if(inter_point_count > 0) glDrawArrays(GL_POINTS, 0, inter_point_count);
     glBindVertexArray(0);
     glUseProgram(0);
-}
\ No newline at end of file
+}
+void initSceneRenderer(const std::vector<Vertex>& pointVertices, const std::vector<Vertex>& axisVertices){
+    initRenderer(pointVertices, axisVertices);
+    // initialize intersection marker buffer
+    initIntersections(8);
+    // background grid, adaptive quads, contours, loss plot and density texture
+    initBackgroundGrid(Scene::GRID_COLS, Scene::GRID_ROWS);
+    initBackgroundQuads(6 * 4096);
+    initContours(4096);
+    initLossPlot(4096);
+    initDensityTexture();
+}
+
+void uploadScene(const Scene& scene){
+    PROFILE_SCOPE("uploadScene");
+    GPU_PASS_SCOPE("uploadScene");
+    static unsigned uploadedDensityVersion = 0;
+    if(scene.opts.adaptiveBackground) updateBackgroundQuads(scene.fieldTriangles);
+    else updateBackgroundGrid(scene.gridVertices);
+    if(!scene.useDensity()) updateVertices(scene.visibleVertices);
+    else if(scene.densityVersion != uploadedDensityVersion){
+        updateDensityTexture(scene.density.width, scene.density.height, scene.density.rgba);
+        uploadedDensityVersion = scene.densityVersion;
+    }
+    updateBoundaryLines(scene.lines);
+    updateIntersections(scene.inters);
+    if(scene.opts.showContours) updateContours(scene.contourVertices);
+}
+
+void drawScene(const Scene& scene){
+    PROFILE_SCOPE("drawScene");
+    GPU_PASS_SCOPE("drawScene");
+    setViewTransform(scene.view);
+    // Draw background confidence first (subtle)
+    if(scene.opts.adaptiveBackground) drawBackgroundQuads();
+    else drawBackgroundGrid();
+    if(scene.useDensity()) drawDensity();
+    else drawPoints(scene.visibleVertices.size());
+    // draw any user test points on top of dataset points
+    drawTestPoints();
+    drawLines(axis_vertex_count);
+    // Draw confidence contours, then the exact region boundaries on top
+    if(scene.opts.showContours) drawContours();
+    if(scene.opts.showRegionBoundaries){
+        drawBoundary();
+        // markers where three regions meet
+        drawIntersections();
+    }
+}
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
 #include "dataset.h"
 
 struct Vertex{
@@ -12,34 +13,66 @@ struct Vertex{
 extern int windowHeight;
 extern int windowWidth;
 
+// Zoom/pan: data coordinates map to NDC via ndc = (p - center) * zoom
+struct ViewTransform{
+    float cx = 0.0f, cy = 0.0f;
+    float zoom = 1.0f;
+    float minX() const { return cx - 1.0f / zoom; }
+    float maxX() const { return cx + 1.0f / zoom; }
+    float minY() const { return cy - 1.0f / zoom; }
+    float maxY() const { return cy + 1.0f / zoom; }
+};
+// applied to every data-space pass (grid, points, axes, boundaries, markers)
+void setViewTransform(const ViewTransform& view);
+
 //Modern OpenGL Functions
 void initRenderer(const std::vector<Vertex>& pointVertices, const std::vector<Vertex>& axisVertices);
 void drawPoints(size_t numPoints);
 void drawLines(size_t numVertices);
 void updateVertices(const std::vector<Vertex>& vertices);
 void setPointVertices(const std::vector<Vertex>& vertices); // reallocate point VBO for different dataset sizes
+void reservePointVertices(size_t count); // room for count points, growing geometrically (updateVertices calls it)
 // Test points (user-provided)
 void initTestPoints(int maxPoints);
 void updateTestPoints(const std::vector<Vertex>& testVertices);
 void drawTestPoints();
 
-// Decision boundary support (up to three pairwise lines -> 6 vertices total)
-void updateBoundaryLines(const std::vector<Vertex>& lineVertices); // expect 6 vertices (3 lines)
+// Decision boundaries: argmax region boundary segments as a line list (see regions.h)
+void updateBoundaryLines(const std::vector<Vertex>& lineVertices); // grows the buffer when needed
 void drawBoundary();
-// Intersection markers (small points where pairwise boundaries cross)
+// Iso-probability contours as a line list (see contour.h)
+void initContours(int maxVertices);
+void updateContours(const std::vector<Vertex>& lineVertices); // grows the buffer when needed
+void drawContours();
+// Junction markers (small points where three regions meet)
 void initIntersections(int maxPoints);
-void updateIntersections(const std::vector<Vertex>& pts);
+void updateIntersections(const std::vector<Vertex>& pts); // grows the buffer when needed
 void drawIntersections();
 // Background/confidence grid
 void initBackgroundGrid(int cols, int rows);
 void updateBackgroundGrid(const std::vector<Vertex>& gridVertices);
 void drawBackgroundGrid();
+// Adaptive background: variable-size quads as a triangle list (see adaptive_field.h)
+void initBackgroundQuads(int maxVertices);
+void updateBackgroundQuads(const std::vector<Vertex>& triangles); // grows the buffer when needed
+void drawBackgroundQuads();
+// Density texture (aggregated rendering of very large point sets, see density.h)
+void initDensityTexture();
+void updateDensityTexture(int width, int height, const std::vector<unsigned char>& rgba);
+void drawDensity();
 
 // Loss plot
 void initLossPlot(int maxPoints);
 void updateLossPlot(const std::vector<Vertex>& plotVertices);
 void drawLossPlot();
 
+// Scene passes (see scene.h): buffer setup, per-frame upload and the draw order
+// shared by the interactive window and the headless renderer
+struct Scene;
+void initSceneRenderer(const std::vector<Vertex>& pointVertices, const std::vector<Vertex>& axisVertices);
+void uploadScene(const Scene& scene);
+void drawScene(const Scene& scene);
+
 //Manual Drawing
 void drawCircleManual(int xc, int yc, int radius, float r, float g, float b);
 void drawLineManual(int x0, int y0, int x1, int y1, int r, int g, int b);
@@ -0,0 +1,207 @@
+//scene.cpp
+
+#include "scene.h"
+#include "profiler.h"
+#include "thread_pool.h"
+#include "frame_arena.h"
+#include "palette.h"
+#include <algorithm>
+
+static AdaptiveField::ProbFn modelProbs(const LogisticModel& model){
+    return [&model](float x, float y, float* probs){ model.predict_probs(x, y, probs); };
+}
+
+// How far the softmax probabilities of two weight sets can be apart over a
+// rectangle: the logit changes dz are linear in x and y, so their spread
+// max dz - min dz is convex and peaks at a corner, and no probability moves by
+// more than a quarter of that spread (dp_c = p_c (dz_c - sum_k p_k dz_k)).
+static ContourEngine::ChangeBound softmaxChangeBound(int numClasses){
+    return [numClasses](const float* from, const float* to, float x0, float y0, float x1, float y1){
+        const float cx[4] = { x0, x1, x1, x0 }, cy[4] = { y0, y0, y1, y1 };
+        float spread = 0.0f;
+        for(int k=0;k<4;++k){
+            float lo = 0.0f, hi = 0.0f;
+            for(int c=0;c<numClasses;++c){
+                const float* a = from + 3 * c;
+                const float* b = to + 3 * c;
+                float dz = (b[0] - a[0]) + (b[1] - a[1]) * cx[k] + (b[2] - a[2]) * cy[k];
+                lo = c ? std::min(lo, dz) : dz;
+                hi = c ? std::max(hi, dz) : dz;
+            }
+            spread = std::max(spread, hi - lo);
+        }
+        return 0.25f * spread;
+    };
+}
+
+Scene::Scene(){
+    // Marching-squares confidence levels; the region boundaries themselves come
+    // exactly from ArgmaxRegions, so no per-class margin levels (K of them) are needed
+    contours.levels = {
+        { CONTOUR_MAX, 0, 0.6f, 0.55f, 0.55f, 0.6f },
+        { CONTOUR_MAX, 0, 0.8f, 0.75f, 0.75f, 0.8f },
+        { CONTOUR_MAX, 0, 0.95f, 0.95f, 0.95f, 1.0f }
+    };
+
+    // Per-frame stages: only recolor and density depend on the visible-point query
+    int visible = stages.add([this]{ updateVisible(frameWidth, frameHeight); });
+    int recolor = stages.add([this]{ recolorPoints(frameModel, *frameData); });
+    int dens = stages.add([this]{ updateDensity(*frameData, frameWidth, frameHeight); });
+    stages.depend(recolor, visible);
+    stages.depend(dens, visible);
+    stages.add([this]{ updateBackground(frameModel); });
+    stages.add([this]{ updateBoundaries(frameModel); });
+    stages.add([this]{ if(opts.showContours) updateContours(frameModel); });
+}
+
+void Scene::setDataset(const std::vector<point2D>& data){
+    SpatialIndex index;
+    index.build(data);
+    setDataset(data, std::move(index));
+}
+
+void Scene::setDataset(const std::vector<point2D>& data, SpatialIndex&& index){
+    numPoints = indexedPoints = data.size();
+    numClasses = countClasses(data);
+    pointIndex = std::move(index);
+    visibleDirty = true;
+    densityDirty = true;
+}
+
+void Scene::appendData(const std::vector<point2D>& data){
+    if(data.size() == numPoints) return;
+    for(size_t i=numPoints;i<data.size();++i) numClasses = std::max(numClasses, (int)data[i].label + 1);
+    numPoints = data.size();
+    if(numPoints - indexedPoints > indexedPoints / 4){
+        pointIndex.build(data);
+        indexedPoints = numPoints;
+    }
+    visibleDirty = true;
+}
+
+bool Scene::useDensity() const{
+    return opts.pointMode == POINTS_DENSITY || (opts.pointMode == POINTS_AUTO && numPoints > DENSITY_POINT_THRESHOLD);
+}
+
+void Scene::update(const LogisticModel& model, const std::vector<point2D>& data, int fbWidth, int fbHeight){
+    PROFILE_SCOPE("Scene::update");
+    beginUpdate(model, data, fbWidth, fbHeight);
+    endUpdate();
+}
+
+void Scene::beginUpdate(const LogisticModel& model, const std::vector<point2D>& data, int fbWidth, int fbHeight){
+    // the stages read this W snapshot, so the caller may keep training or editing the model
+    frameModel = model;
+    frameData = &data;
+    frameWidth = fbWidth; frameHeight = fbHeight;
+    stages.launch();
+}
+
+void Scene::endUpdate(){
+    PROFILE_SCOPE("Scene::wait");
+    stages.wait();
+}
+
+void Scene::updateVisible(int fbWidth, int fbHeight){
+    PROFILE_SCOPE("Scene::updateVisible");
+    // Re-query the visible points when the view or dataset changed. Density mode bins
+    // every visible point; point mode uses coarser representative levels when zoomed out.
+    bool dens = useDensity();
+    if(!visibleDirty && dens == lastUseDensity) return;
+    float ppuX = fbWidth * 0.5f * view.zoom, ppuY = fbHeight * 0.5f * view.zoom;
+    visibleLevel = dens ? 0 : pointIndex.chooseLevel(ppuX, ppuY);
+    visibleIdx.clear();
+    pointIndex.query(view.minX(), view.minY(), view.maxX(), view.maxY(), visibleLevel, visibleIdx);
+    // appended points not in the index yet: all of them at any level of detail
+    const std::vector<point2D> &data = *frameData;
+    for(size_t i=indexedPoints;i<numPoints;++i){
+        const point2D &p = data[i];
+        if(p.x >= view.minX() && p.x <= view.maxX() && p.y >= view.minY() && p.y <= view.maxY()) visibleIdx.push_back((uint32_t)i);
+    }
+    visibleDirty = false;
+    densityDirty = true;
+    lastUseDensity = dens;
+}
+
+void Scene::updateBackground(const LogisticModel& model){
+    PROFILE_SCOPE("Scene::updateBackground");
+    // Update background confidence field: adaptive quadtree or a regular grid
+    if(opts.adaptiveBackground){
+        field.numClasses = model.numClasses;
+        field.build(modelProbs(model), view.minX(), view.minY(), view.maxX(), view.maxY(), fieldTriangles);
+        return;
+    }
+    gridVertices.resize(GRID_COLS * GRID_ROWS);
+    ThreadPool::instance().parallel_for(GRID_ROWS, 8, [&](size_t r0, size_t r1){
+        FrameVector<float> probs(model.numClasses);
+        for(int r=(int)r0;r<(int)r1;++r){
+            for(int c=0;c<GRID_COLS;++c){
+                float nx = view.minX() + (float)c / (GRID_COLS-1) * (view.maxX() - view.minX());
+                float ny = view.minY() + (float)r / (GRID_ROWS-1) * (view.maxY() - view.minY());
+                model.predict_probs(nx, ny, probs.data());
+                // color blend by probability weighted sum of class colors
+                float cr, cg, cb;
+                blendClassColors(probs.data(), model.numClasses, cr, cg, cb);
+                gridVertices[r * GRID_COLS + c] = { nx, ny, cr, cg, cb };
+            }
+        }
+    });
+}
+
+void Scene::recolorPoints(const LogisticModel& model, const std::vector<point2D>& data){
+    PROFILE_SCOPE("Scene::recolorPoints");
+    // Rebuild visible vertices colored by multiclass predicted label
+    // (density mode shows true labels, so it skips this pass)
+    visibleVertices.clear();
+    if(useDensity()) return;
+    visibleVertices.resize(visibleIdx.size());
+    ThreadPool::instance().parallel_for(visibleIdx.size(), 4096, [&](size_t b, size_t e){
+        for(size_t k=b;k<e;++k){
+            const point2D &p = data[visibleIdx[k]];
+            Vertex &v = visibleVertices[k];
+            v.x = p.x; v.y = p.y;
+            classColor(model.predict_label(p.x, p.y), v.r, v.g, v.b);
+        }
+    });
+}
+
+void Scene::updateBoundaries(const LogisticModel& model){
+    PROFILE_SCOPE("Scene::updateBoundaries");
+    // Exact argmax region boundaries clipped to the view; a boundary takes the
+    // sum of its two class colors (cyan, magenta, yellow for three classes)
+    regions.build(model, view.minX(), view.minY(), view.maxX(), view.maxY());
+    lines.clear();
+    for(const auto &e : regions.edges){
+        float ar, ag, ab, br, bg, bb;
+        classColor(e.a, ar, ag, ab);
+        classColor(e.b, br, bg, bb);
+        float r = std::min(1.0f, ar + br), g = std::min(1.0f, ag + bg), b = std::min(1.0f, ab + bb);
+        lines.push_back({e.x0, e.y0, r, g, b});
+        lines.push_back({e.x1, e.y1, r, g, b});
+    }
+    // white markers where three regions meet
+    inters.clear();
+    for(const auto &j : regions.junctions) inters.push_back({j.x, j.y, 1.0f, 1.0f, 1.0f});
+}
+
+void Scene::updateContours(const LogisticModel& model){
+    PROFILE_SCOPE("Scene::updateContours");
+    // Iso-probability contours; only the tiles the weight change since their last
+    // evaluation can have moved are evaluated and re-contoured (none while paused)
+    contours.setGrid(CONTOUR_RES, CONTOUR_RES, model.numClasses, view.minX(), view.minY(), view.maxX(), view.maxY());
+    contours.sample(modelProbs(model), &model.W[0][0], (size_t)model.weightCount(), softmaxChangeBound(model.numClasses));
+    contours.toLineVertices(contourVertices);
+}
+
+void Scene::updateDensity(const std::vector<point2D>& data, int fbWidth, int fbHeight){
+    PROFILE_SCOPE("Scene::updateDensity");
+    // Re-aggregate only when the data, mapping, view or framebuffer size changed
+    if(!useDensity()) return;
+    const int classes = std::max(1, numClasses);
+    if(!densityDirty && density.width == fbWidth && density.height == fbHeight && density.numClasses == classes) return;
+    density.resize(fbWidth, fbHeight, classes);
+    density.bin(data, view.minX(), view.minY(), view.maxX(), view.maxY(), &visibleIdx);
+    density.colorize((DensityMapping)opts.densityMapping);
+    densityDirty = false;
+    ++densityVersion;
+}
@@ -0,0 +1,103 @@
+//scene.h
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "renderer.h"
+#include "dataset.h"
+#include "model.h"
+#include "density.h"
+#include "spatial_index.h"
+#include "adaptive_field.h"
+#include "contour.h"
+#include "regions.h"
+#include "task_graph.h"
+
+// CPU side of one visualization frame: background field, visible point colors,
+// boundaries and contours for the current model and view, for any class count. Shared by the
+// interactive window and the headless batch renderer; uploading and drawing
+// happen in renderer.cpp (uploadScene / drawScene).
+//
+// The passes run as a task graph on the shared thread pool, so a frame costs
+// about as much as its longest pass. Between beginUpdate() and endUpdate() the
+// scene belongs to the stages: the caller may build its UI meanwhile, but it
+// must not touch the scene, its options or its view, or the dataset.
+
+enum PointMode{ POINTS_AUTO = 0, POINTS_ALWAYS = 1, POINTS_DENSITY = 2 };
+
+struct SceneOptions{
+    int pointMode = POINTS_AUTO;    // auto switches to density above DENSITY_POINT_THRESHOLD
+    int densityMapping = DENSITY_LOG;
+    bool adaptiveBackground = true;
+    bool showContours = true;
+    bool showRegionBoundaries = true;
+};
+
+struct Scene{
+    static const int GRID_COLS = 80;
+    static const int GRID_ROWS = 80;
+    static const int CONTOUR_RES = 129;
+
+    SceneOptions opts;
+    ViewTransform view;
+
+    // visible points (spatial index query), recolored by predicted label
+    SpatialIndex pointIndex;
+    std::vector<uint32_t> visibleIdx;
+    std::vector<Vertex> visibleVertices;
+    int visibleLevel = 0;
+    bool visibleDirty = true;
+    bool lastUseDensity = false;
+    size_t numPoints = 0;
+    size_t indexedPoints = 0;       // points in pointIndex; later ones are appended (see appendData)
+    int numClasses = 0;             // labels in the dataset (the model may have a different count)
+
+    // background confidence: adaptive quads or the uniform point grid
+    AdaptiveField field;
+    std::vector<Vertex> fieldTriangles;
+    std::vector<Vertex> gridVertices;
+
+    // confidence contours, and the exact argmax region boundaries as a line list
+    // with markers where three regions meet
+    ContourEngine contours;
+    std::vector<Vertex> contourVertices;
+    ArgmaxRegions regions;
+    std::vector<Vertex> lines;
+    std::vector<Vertex> inters;
+
+    // aggregated points (rebuilt only when data, view, mapping or size change)
+    DensityGrid density;
+    bool densityDirty = true;
+    unsigned densityVersion = 0;    // bumped on every rebuild so the texture is re-uploaded
+
+    Scene();
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+    void setDataset(const std::vector<point2D>& data);
+    // same with an index already built for data (e.g. by DatasetLoader off the render thread)
+    void setDataset(const std::vector<point2D>& data, SpatialIndex&& index);
+    // data grew at the end (follow mode). The new points are drawn unindexed until
+    // they are a quarter of the data; then the index is rebuilt, so the rebuild
+    // cost stays amortized O(1) per appended point.
+    void appendData(const std::vector<point2D>& data);
+    bool useDensity() const;
+
+    // all CPU passes for one frame at the given framebuffer size
+    void update(const LogisticModel& model, const std::vector<point2D>& data, int fbWidth, int fbHeight);
+    // the same split in two: start the passes on a snapshot of the model's weights, then wait
+    void beginUpdate(const LogisticModel& model, const std::vector<point2D>& data, int fbWidth, int fbHeight);
+    void endUpdate();
+
+    void updateVisible(int fbWidth, int fbHeight);
+    void updateBackground(const LogisticModel& model);
+    void recolorPoints(const LogisticModel& model, const std::vector<point2D>& data);
+    void updateBoundaries(const LogisticModel& model);
+    void updateContours(const LogisticModel& model);
+    void updateDensity(const std::vector<point2D>& data, int fbWidth, int fbHeight);
+
+private:
+    TaskGraph stages;
+    LogisticModel frameModel;
+    const std::vector<point2D>* frameData = nullptr;
+    int frameWidth = 0, frameHeight = 0;
+};
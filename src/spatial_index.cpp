@@ -0,0 +1,111 @@
+//spatial_index.cpp
+
+#include "spatial_index.h"
+#include <algorithm>
+#include <cmath>
+
+// interleave the low 16 bits of x and y (x in even bits)
+static uint32_t morton2(uint32_t x, uint32_t y){
+    auto spread = [](uint32_t v){
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+void SpatialIndex::clear(){
+    dim = 0;
+    order.clear(); cellStart.clear(); levels.clear();
+}
+
+void SpatialIndex::build(const std::vector<point2D>& data){
+    clear();
+    if(data.empty()) return;
+
+    minX = maxX = data[0].x; minY = maxY = data[0].y;
+    for(const auto &p : data){
+        minX = std::min(minX, p.x); maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y); maxY = std::max(maxY, p.y);
+    }
+    // pad so points on the max edge land inside the last cell
+    float padX = std::max(1e-3f, (maxX - minX) * 1e-4f), padY = std::max(1e-3f, (maxY - minY) * 1e-4f);
+    minX -= padX; maxX += padX; minY -= padY; maxY += padY;
+
+    // ~8 points per finest cell on average, capped at 1024x1024 cells
+    dim = 1;
+    while(dim < 1024 && (size_t)dim * dim * 8 < data.size()) dim *= 2;
+    const size_t numCells = (size_t)dim * dim;
+    const float sx = dim / (maxX - minX), sy = dim / (maxY - minY);
+
+    // counting sort of the points by finest Morton cell
+    std::vector<uint32_t> codes(data.size());
+    cellStart.assign(numCells + 1, 0);
+    for(size_t i=0;i<data.size();++i){
+        uint32_t cx = (uint32_t)std::min(dim - 1, std::max(0, (int)((data[i].x - minX) * sx)));
+        uint32_t cy = (uint32_t)std::min(dim - 1, std::max(0, (int)((data[i].y - minY) * sy)));
+        codes[i] = morton2(cx, cy);
+        cellStart[codes[i] + 1] += 1;
+    }
+    for(size_t c=0;c<numCells;++c) cellStart[c+1] += cellStart[c];
+    order.resize(data.size());
+    std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+    for(size_t i=0;i<data.size();++i) order[fill[codes[i]]++] = (uint32_t)i;
+
+    // representatives: first point of each class per cell, merged bottom-up
+    auto addRep = [&](std::vector<uint32_t>& reps, size_t first, uint32_t idx){
+        for(size_t k=first;k<reps.size();++k) if(data[reps[k]].label == data[idx].label) return;
+        reps.push_back(idx);
+    };
+    levels.resize(1);
+    for(int l=1;(dim >> l) >= 1;++l){
+        Level L;
+        L.dim = dim >> l;
+        size_t cells = (size_t)L.dim * L.dim;
+        L.repStart.assign(cells + 1, 0);
+        const Level &child = levels[l-1];
+        for(size_t m=0;m<cells;++m){
+            size_t first = L.reps.size();
+            if(l == 1){
+                for(uint32_t k=cellStart[m*4];k<cellStart[m*4+4];++k) addRep(L.reps, first, order[k]);
+            } else {
+                for(uint32_t k=child.repStart[m*4];k<child.repStart[m*4+4];++k) addRep(L.reps, first, child.reps[k]);
+            }
+            L.repStart[m+1] = (uint32_t)L.reps.size();
+        }
+        levels.push_back(std::move(L));
+    }
+}
+
+int SpatialIndex::chooseLevel(float pixelsPerUnitX, float pixelsPerUnitY, float lodPixels) const{
+    for(int l=(int)levels.size()-1;l>=1;--l){
+        int d = levels[l].dim;
+        float cellPx = std::max((maxX - minX) / d * pixelsPerUnitX, (maxY - minY) / d * pixelsPerUnitY);
+        if(cellPx <= lodPixels) return l;
+    }
+    return 0;
+}
+
+void SpatialIndex::query(float x0, float y0, float x1, float y1, int level, std::vector<uint32_t>& out) const{
+    if(empty()) return;
+    if(x1 < minX || y1 < minY || x0 > maxX || y0 > maxY) return;
+    level = std::min(std::max(level, 0), (int)levels.size() - 1);
+    const int d = dim >> level;
+    const float sx = d / (maxX - minX), sy = d / (maxY - minY);
+    int cx0 = std::max(0, (int)std::floor((x0 - minX) * sx)), cx1 = std::min(d - 1, (int)std::floor((x1 - minX) * sx));
+    int cy0 = std::max(0, (int)std::floor((y0 - minY) * sy)), cy1 = std::min(d - 1, (int)std::floor((y1 - minY) * sy));
+    for(int cy=cy0;cy<=cy1;++cy){
+        for(int cx=cx0;cx<=cx1;++cx){
+            uint32_t m = morton2((uint32_t)cx, (uint32_t)cy);
+            if(level == 0){
+                out.insert(out.end(), order.begin() + cellStart[m], order.begin() + cellStart[m+1]);
+            } else {
+                const Level &L = levels[level];
+                out.insert(out.end(), L.reps.begin() + L.repStart[m], L.reps.begin() + L.repStart[m+1]);
+            }
+        }
+    }
+}
@@ -0,0 +1,33 @@
+//spatial_index.h
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "dataset.h"
+
+// Multi-level uniform grid over the dataset bounding box, built once per dataset.
+// Points are sorted by the Morton code of their finest cell, so every cell of every
+// coarser level is a contiguous range of that order. Coarser levels additionally
+// keep one representative point per class and cell, used when zoomed far out.
+struct SpatialIndex{
+    struct Level{
+        int dim = 0;                     // dim x dim cells
+        std::vector<uint32_t> repStart;  // per Morton cell offsets into reps (dim*dim+1)
+        std::vector<uint32_t> reps;      // representative point indices (one per class)
+    };
+
+    float minX = -1.0f, minY = -1.0f, maxX = 1.0f, maxY = 1.0f;
+    int dim = 0;                         // finest level resolution (power of two)
+    std::vector<uint32_t> order;         // point indices sorted by finest Morton cell
+    std::vector<uint32_t> cellStart;     // finest Morton cell offsets into order (dim*dim+1)
+    std::vector<Level> levels;           // levels[0] unused (all points), levels[l].dim = dim >> l
+
+    void build(const std::vector<point2D>& data);
+    void clear();
+    bool empty() const { return order.empty(); }
+
+    // pick the level whose cells are at most lodPixels wide on screen (0 = all points)
+    int chooseLevel(float pixelsPerUnitX, float pixelsPerUnitY, float lodPixels = 3.0f) const;
+    // append indices of points in cells overlapping [x0,x1]x[y0,y1] at the given level
+    void query(float x0, float y0, float x1, float y1, int level, std::vector<uint32_t>& out) const;
+};
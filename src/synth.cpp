@@ -0,0 +1,237 @@
+//synth.cpp
+
+#include "synth.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* kShapeNames[SYNTH_SHAPES] = { "blobs", "rings", "spirals", "xor", "moons" };
+static const float kPi = 3.14159265358979f;
+static const uint64_t kMaxPoints = 1000000000ull;
+// points generated and written per block when streaming to a file
+static const size_t kBlockPoints = 1 << 20;
+
+const char* synthShapeName(int shape){
+    return shape >= 0 && shape < SYNTH_SHAPES ? kShapeNames[shape] : "?";
+}
+
+bool parseSynthSpec(const char* text, SynthSpec& spec){
+    SynthSpec s;
+    const char* colon = strchr(text, ':');
+    std::string shape(text, colon ? colon - text : strlen(text));
+    s.shape = (int)(std::find(kShapeNames, kShapeNames + SYNTH_SHAPES, shape) - kShapeNames);
+    if(s.shape == SYNTH_SHAPES) return false;
+    for(const char* p = colon ? colon + 1 : ""; *p;){
+        const char* end = strchr(p, ',');
+        if(!end) end = p + strlen(p);
+        std::string item(p, end);
+        p = *end ? end + 1 : end;
+        size_t eq = item.find('=');
+        if(eq == std::string::npos) return false;
+        std::string key = item.substr(0, eq);
+        double v = atof(item.c_str() + eq + 1);
+        if(key == "n") s.count = (uint64_t)v;
+        else if(key == "k") s.classes = (int)v;
+        else if(key == "noise") s.noise = (float)v;
+        else if(key == "seed") s.seed = strtoull(item.c_str() + eq + 1, nullptr, 10);
+        else return false;
+    }
+    if(s.count < 1 || s.count > kMaxPoints || s.classes < 1 || s.classes > LabelDictionary::MAX_LABELS || s.noise < 0.0f) return false;
+    spec = s;
+    return true;
+}
+
+std::string synthSpecString(const SynthSpec& spec){
+    char buf[160];
+    snprintf(buf, sizeof(buf), "%s:n=%llu,k=%d,noise=%g,seed=%llu", synthShapeName(spec.shape),
+             (unsigned long long)spec.count, spec.classes, spec.noise, (unsigned long long)spec.seed);
+    return buf;
+}
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"):
+// ten multiply/xor rounds turn (counter, key) into four independent 32-bit words
+static void philox4x32(uint32_t c[4], uint32_t k0, uint32_t k1){
+    for(int r=0;r<10;++r){
+        if(r){ k0 += 0x9E3779B9u; k1 += 0xBB67AE85u; }
+        uint64_t p0 = (uint64_t)0xD2511F53u * c[0];
+        uint64_t p1 = (uint64_t)0xCD9E8D57u * c[2];
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c[1] ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c[3] ^ k1;
+        c[0] = n0; c[1] = (uint32_t)p1; c[2] = n2; c[3] = (uint32_t)p0;
+    }
+}
+
+// block `stream` of point i
+static void randomWords(const SynthSpec& spec, uint64_t i, uint32_t stream, uint32_t out[4]){
+    out[0] = (uint32_t)i; out[1] = (uint32_t)(i >> 32); out[2] = stream; out[3] = 0;
+    philox4x32(out, (uint32_t)spec.seed, (uint32_t)(spec.seed >> 32));
+}
+
+// [0, 1) and (0, 1] from the top 24 bits
+static float unit(uint32_t u){ return (float)(u >> 8) * (1.0f / 16777216.0f); }
+static float unitOpen(uint32_t u){ return (float)((u >> 8) + 1) * (1.0f / 16777216.0f); }
+
+point2D synthPoint(const SynthSpec& spec, uint64_t i){
+    uint32_t u[4];
+    randomWords(spec, i, 0, u);
+    const int K = spec.classes;
+    const int c = (int)(i % (uint64_t)K);
+    // Box-Muller: two gaussians for the noise
+    float rad = std::sqrt(-2.0f * std::log(unitOpen(u[0])));
+    float phi = 2.0f * kPi * unit(u[1]);
+    float gx = rad * std::cos(phi) * spec.noise, gy = rad * std::sin(phi) * spec.noise;
+    float t = unit(u[2]);
+    float x = 0.0f, y = 0.0f;
+    switch(spec.shape){
+    case SYNTH_BLOBS: {
+        // centers evenly spaced on a circle
+        float a = 2.0f * kPi * c / K, r = K > 1 ? 0.6f : 0.0f;
+        x = r * std::cos(a); y = r * std::sin(a);
+        break;
+    }
+    case SYNTH_RINGS: {
+        float r = 0.9f * (c + 1) / K, a = 2.0f * kPi * t;
+        x = r * std::cos(a); y = r * std::sin(a);
+        break;
+    }
+    case SYNTH_SPIRALS: {
+        // K arms of 1.5 turns each, rotated evenly
+        float r = 0.05f + 0.85f * t, a = 2.0f * kPi * c / K + 3.0f * kPi * t;
+        x = r * std::cos(a); y = r * std::sin(a);
+        break;
+    }
+    case SYNTH_XOR: {
+        // K x K checkerboard with class (column + row) % K; two classes give the XOR quadrants
+        uint32_t v[4];
+        randomWords(spec, i, 1, v);
+        int n = std::max(K, 2);
+        int col = (int)(((uint64_t)v[0] * (uint32_t)n) >> 32);
+        int row = ((c - col) % K + K) % K;
+        if(K == 1) row = (int)(((uint64_t)v[1] * 2u) >> 32);
+        x = -1.0f + 2.0f * (col + t) / n;
+        y = -1.0f + 2.0f * (row + unit(v[2])) / n;
+        break;
+    }
+    case SYNTH_MOONS: {
+        // interleaved half circles along x, alternately opening down and up
+        float R = 1.8f / (K + 1), cx = (c - 0.5f * (K - 1)) * R;
+        float cy = c % 2 ? 0.25f * R : -0.25f * R;
+        float a = kPi * t + (c % 2 ? kPi : 0.0f);
+        x = cx + R * std::cos(a); y = cy + R * std::sin(a);
+        break;
+    }
+    }
+    return { x + gx, y + gy, (uint16_t)c };
+}
+
+void synthLabels(const SynthSpec& spec, LabelDictionary& labels){
+    labels.clear();
+    const size_t digits = std::to_string(spec.classes - 1).size();
+    for(int c=0;c<spec.classes;++c){
+        std::string id = std::to_string(c);
+        labels.intern("c" + std::string(digits - id.size(), '0') + id);
+    }
+    labels.freeze();
+}
+
+static void generateRange(const SynthSpec& spec, uint64_t first, point2D* out, size_t n, LoadProgress* progress = nullptr){
+    ThreadPool::instance().parallel_for(n, 4096, [&](size_t b, size_t e){
+        const size_t step = 1 << 16;
+        for(size_t s=b;s<e;s+=step){
+            if(progress && progress->cancelled()) return;
+            size_t se = std::min(e, s + step);
+            for(size_t k=s;k<se;++k) out[k] = synthPoint(spec, first + k);
+            if(progress) progress->done += se - s;
+        }
+    });
+}
+
+std::vector<point2D> generateSynthetic(const SynthSpec& spec, LabelDictionary* labels, LoadProgress* progress){
+    if(progress) progress->total = spec.count;
+    std::vector<point2D> data(spec.count);
+    generateRange(spec, 0, data.data(), data.size(), progress);
+    if(progress && progress->cancelled()) return {};
+    if(labels) synthLabels(spec, *labels);
+    return data;
+}
+
+// numpy structured array: x, y as float32 and label as the class name writeCsv
+// writes, a fixed-width byte string ('S', NUL-padded), packed (little-endian like
+// the hosts we build on); either file loads with the same class names
+static bool writeNpy(const SynthSpec& spec, FILE* f){
+    LabelDictionary labels;
+    synthLabels(spec, labels);
+    const size_t width = labels.name(0).size();     // names are zero-padded to one width
+    const size_t record = 8 + width;
+    char dict[256];
+    int len = snprintf(dict, sizeof(dict), "{'descr': [('x', '<f4'), ('y', '<f4'), ('label', '|S%zu')], "
+                       "'fortran_order': False, 'shape': (%llu,), }", width, (unsigned long long)spec.count);
+    // magic + version + length + dict, padded with spaces to 64 bytes and ended by a newline
+    size_t total = (10 + len + 1 + 63) / 64 * 64;
+    std::string header("\x93NUMPY\x01\x00", 8);
+    uint16_t hlen = (uint16_t)(total - 10);
+    header.push_back((char)(hlen & 0xff));
+    header.push_back((char)(hlen >> 8));
+    header.append(dict, len);
+    header.append(total - 1 - header.size(), ' ');
+    header.push_back('\n');
+    fwrite(header.data(), 1, header.size(), f);
+
+    std::vector<point2D> block(std::min<uint64_t>(spec.count, kBlockPoints));
+    std::vector<char> bytes(block.size() * record);
+    for(uint64_t first=0; first<spec.count; first+=block.size()){
+        size_t n = (size_t)std::min<uint64_t>(block.size(), spec.count - first);
+        generateRange(spec, first, block.data(), n);
+        for(size_t k=0;k<n;++k){
+            char* r = &bytes[k*record];
+            memcpy(r, &block[k].x, 4);
+            memcpy(r+4, &block[k].y, 4);
+            memcpy(r+8, labels.name(block[k].label).data(), width);
+        }
+        if(fwrite(bytes.data(), record, n, f) != n) return false;
+    }
+    return true;
+}
+
+static bool writeCsv(const SynthSpec& spec, FILE* f){
+    LabelDictionary labels;
+    synthLabels(spec, labels);
+    fputs("x,y,label\n", f);
+    ThreadPool &pool = ThreadPool::instance();
+    const size_t parts = (size_t)pool.size() * 4;
+    std::vector<std::string> text(parts);
+    for(uint64_t first=0; first<spec.count; first+=kBlockPoints){
+        size_t n = (size_t)std::min<uint64_t>(kBlockPoints, spec.count - first);
+        // each part formats its own slice; the slices are written in order
+        pool.parallel_for(parts, 1, [&](size_t pb, size_t pe){
+            char line[64];
+            for(size_t part=pb;part<pe;++part){
+                size_t b = n * part / parts, e = n * (part + 1) / parts;
+                std::string &out = text[part];
+                out.clear();
+                for(size_t k=b;k<e;++k){
+                    point2D p = synthPoint(spec, first + k);
+                    int len = snprintf(line, sizeof(line), "%.6g,%.6g,", p.x, p.y);
+                    out.append(line, len);
+                    out += labels.name(p.label);
+                    out += '\n';
+                }
+            }
+        });
+        for(const auto &t : text) if(fwrite(t.data(), 1, t.size(), f) != t.size()) return false;
+    }
+    return true;
+}
+
+bool writeSynthetic(const SynthSpec& spec, const char* path){
+    FILE* f = fopen(path, "wb");
+    if(!f) return false;
+    size_t len = strlen(path);
+    bool npy = len >= 4 && !strcmp(path + len - 4, ".npy");
+    bool ok = npy ? writeNpy(spec, f) : writeCsv(spec, f);
+    ok = !ferror(f) && ok;
+    return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,42 @@
+//synth.h
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "dataset.h"
+
+// In-process synthetic datasets for scale testing: no files to ship, any size.
+// Point i depends only on (seed, i) through a Philox4x32-10 counter-based
+// generator, so the points come out the same for any thread count or chunking,
+// and any slice can be generated on its own. Points are already in model space
+// (about [-1, 1]); label i is i % classes, so classes are balanced.
+
+enum SynthShape{ SYNTH_BLOBS = 0, SYNTH_RINGS, SYNTH_SPIRALS, SYNTH_XOR, SYNTH_MOONS, SYNTH_SHAPES };
+
+struct SynthSpec{
+    int shape = SYNTH_BLOBS;    // SynthShape
+    int classes = 3;
+    uint64_t count = 10000;     // up to 10^9
+    float noise = 0.1f;         // gaussian sigma in model units
+    uint64_t seed = 1;
+};
+
+const char* synthShapeName(int shape);
+// "spirals:n=1e6,k=5,noise=0.05,seed=7"; the shape alone takes the defaults
+bool parseSynthSpec(const char* text, SynthSpec& spec);
+std::string synthSpecString(const SynthSpec& spec);
+
+point2D synthPoint(const SynthSpec& spec, uint64_t i);
+
+// the whole dataset in memory, filled in parallel; labels (if given) gets the
+// class names c0..c{K-1} (zero-padded, so their sorted order is the id order).
+// A cancelled progress (see LoadProgress) gives an empty vector.
+std::vector<point2D> generateSynthetic(const SynthSpec& spec, LabelDictionary* labels = nullptr, LoadProgress* progress = nullptr);
+void synthLabels(const SynthSpec& spec, LabelDictionary& labels);
+
+// Streams the dataset to a file in blocks without holding it in memory: ".npy"
+// writes a structured array (x, y float32, label a byte string), anything else
+// a CSV with an "x,y,label" header (load it with --x x --y y --label label). Both
+// name the classes as synthLabels does.
+bool writeSynthetic(const SynthSpec& spec, const char* path);
@@ -0,0 +1,43 @@
+//task_graph.cpp
+
+#include "task_graph.h"
+#include "thread_pool.h"
+
+int TaskGraph::add(std::function<void()> fn){
+    std::unique_ptr<Node> n(new Node());
+    n->graph = this;
+    n->fn = std::move(fn);
+    nodes.push_back(std::move(n));
+    return (int)nodes.size() - 1;
+}
+
+void TaskGraph::depend(int task, int before){
+    nodes[before]->dependents.push_back(task);
+    ++nodes[task]->deps;
+}
+
+void TaskGraph::launch(){
+    if(nodes.empty()) return;
+    // all counters are armed before the first task can finish and release others
+    for(auto &n : nodes) n->pending.store(n->deps, std::memory_order_relaxed);
+    remaining.store((int)nodes.size(), std::memory_order_release);
+    ThreadPool &pool = ThreadPool::instance();
+    home = pool.currentQueue();
+    for(auto &n : nodes) if(n->deps == 0) pool.submit(&TaskGraph::runNode, n.get(), home);
+}
+
+void TaskGraph::wait(){
+    ThreadPool::instance().wait(remaining);
+}
+
+void TaskGraph::runNode(void* ctx){
+    Node* n = static_cast<Node*>(ctx);
+    TaskGraph* g = n->graph;
+    n->fn();
+    for(int d : n->dependents){
+        Node* next = g->nodes[d].get();
+        if(next->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) ThreadPool::instance().submit(&TaskGraph::runNode, next, g->home);
+    }
+    // last touch of the graph: wait() may return and the graph be relaunched right after
+    g->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
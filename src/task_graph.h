@@ -0,0 +1,45 @@
+//task_graph.h
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include <atomic>
+
+// A fixed dependency graph of tasks that is built once and re-run on the
+// shared ThreadPool, e.g. once per frame. launch() submits the tasks without
+// dependencies and returns immediately, so the caller can do other work (such
+// as building the UI). Each finished task releases its dependents into the
+// launching thread's queue, and wait() runs tasks from there until the whole
+// graph has finished (never other threads' work, see ThreadPool). Re-running an
+// unchanged graph does not allocate.
+
+class TaskGraph{
+public:
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    // returns the task id
+    int add(std::function<void()> fn);
+    // task runs only after `before` has finished
+    void depend(int task, int before);
+
+    void launch();
+    void wait();
+    bool running() const { return remaining.load(std::memory_order_acquire) > 0; }
+
+private:
+    struct Node{
+        TaskGraph* graph;
+        std::function<void()> fn;
+        std::vector<int> dependents;
+        int deps = 0;
+        std::atomic<int> pending{0};
+    };
+    std::vector<std::unique_ptr<Node>> nodes;   // stable addresses for the pool's ctx pointers
+    std::atomic<int> remaining{0};
+    int home = -1;      // the pool queue of the thread that launched the graph
+
+    static void runNode(void* ctx);
+};
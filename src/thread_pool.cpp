@@ -0,0 +1,244 @@
+//thread_pool.cpp
+
+#include "thread_pool.h"
+#include <cstdlib>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+static int g_configuredThreads = -1;    // -1: not configured, use the environment
+static bool g_configuredPin = false;
+static thread_local int t_worker = -1;  // queue index of a pool worker, -1 elsewhere
+
+// Injection queue slots of threads outside the pool, held until the thread
+// exits (the dataset loader starts a thread per load). A queue is never
+// shared, or one thread's wait() could run another's tasks: with every slot
+// taken, the next thread blocks until one is released. Never destroyed, so a
+// thread exiting after the pool is gone still releases safely.
+struct ExternalSlots{
+    std::mutex mutex;
+    std::condition_variable released;
+    uint32_t used = 0;
+};
+static ExternalSlots& externalSlots(){
+    static ExternalSlots* slots = new ExternalSlots();
+    return *slots;
+}
+struct ExternalSlot{
+    int index = -1;
+    ~ExternalSlot(){
+        if(index < 0) return;
+        ExternalSlots &s = externalSlots();
+        { std::lock_guard<std::mutex> lock(s.mutex); s.used &= ~(1u << index); }
+        s.released.notify_one();
+    }
+    int get(int count){
+        if(index >= 0) return index;
+        ExternalSlots &s = externalSlots();
+        const uint32_t all = (1u << count) - 1;
+        std::unique_lock<std::mutex> lock(s.mutex);
+        s.released.wait(lock, [&]{ return (s.used & all) != all; });
+        for(index=0; s.used & (1u << index); ++index) {}
+        s.used |= 1u << index;
+        return index;
+    }
+};
+static thread_local ExternalSlot t_external;
+
+static void pinToCore(int core){
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(_WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core);
+#else
+    (void)core;
+#endif
+}
+
+void ThreadPool::configure(int threads, bool pinThreads){
+    g_configuredThreads = std::max(0, threads);
+    g_configuredPin = pinThreads;
+}
+
+ThreadPool& ThreadPool::instance(){
+    static ThreadPool pool = [](){
+        int threads = 0;
+        bool pin = false;
+        if(g_configuredThreads >= 0){
+            threads = g_configuredThreads;
+            pin = g_configuredPin;
+        } else {
+            if(const char* env = getenv("ML_VIS_THREADS")) threads = atoi(env);
+            if(const char* env = getenv("ML_VIS_PIN_THREADS")) pin = atoi(env) != 0;
+        }
+        if(threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        return ThreadPool(threads, pin);
+    }();
+    return pool;
+}
+
+ThreadPool::ThreadPool(int threads, bool pinThreads){
+    // the calling thread takes part in every parallel_for, so spawn one fewer
+    int n = std::max(1, threads) - 1;
+    for(int i=0;i<n+EXTERNAL_QUEUES;++i) queues.push_back(new Queue());
+    for(int i=0;i<n;++i) workers.emplace_back(&ThreadPool::workerLoop, this, i, pinThreads);
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for(auto &w : workers) w.join();
+    for(Queue* q : queues) delete q;
+}
+
+void ThreadPool::Queue::pushBack(Task t){
+    if(count == ring.size()){
+        std::vector<Task> grown(std::max<size_t>(16, ring.size() * 2));
+        for(size_t i=0;i<count;++i) grown[i] = ring[(head + i) % ring.size()];
+        ring.swap(grown);
+        head = 0;
+    }
+    ring[(head + count++) % ring.size()] = t;
+}
+
+bool ThreadPool::Queue::popBack(Task& t){
+    if(!count) return false;
+    t = ring[(head + --count) % ring.size()];
+    return true;
+}
+
+bool ThreadPool::Queue::popFront(Task& t){
+    if(!count) return false;
+    t = ring[head];
+    head = (head + 1) % ring.size();
+    --count;
+    return true;
+}
+
+size_t ThreadPool::chunkSize(size_t n, size_t grain) const{
+    if(workers.empty()) return n;
+    // a few chunks per thread balance uneven chunk costs without much counter traffic
+    size_t target = (size_t)size() * 4;
+    return std::max(std::max<size_t>(grain, 1), (n + target - 1) / target);
+}
+
+void ThreadPool::work(Job& job){
+    for(size_t c; (c = job.next.fetch_add(1, std::memory_order_relaxed)) < job.chunks;) job.body(job.ctx, c);
+}
+
+void ThreadPool::run(size_t chunks, void (*body)(void*, size_t), void* ctx){
+    Job job;
+    job.body = body;
+    job.ctx = ctx;
+    job.chunks = chunks;
+    const int helpers = (int)std::min<size_t>(chunks - 1, workers.size());
+    job.helpers.store(helpers, std::memory_order_relaxed);
+
+    const int self = currentQueue();
+    if(helpers > 0) push(self, Task{&job, nullptr, nullptr}, helpers);
+
+    work(job);
+    // helpers still queued are either picked up here or finish on their worker;
+    // meanwhile a worker runs other tasks so nested jobs keep making progress
+    wait(job.helpers);
+}
+
+int ThreadPool::currentQueue() const{
+    return t_worker >= 0 ? t_worker : (int)workers.size() + t_external.get(EXTERNAL_QUEUES);
+}
+
+void ThreadPool::push(int self, Task t, int count){
+    {
+        std::lock_guard<std::mutex> lock(queues[self]->mutex);
+        for(int i=0;i<count;++i) queues[self]->pushBack(t);
+    }
+    queued.fetch_add(count, std::memory_order_seq_cst);
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    if(count == 1) wake.notify_one(); else wake.notify_all();
+    // the thread owning the queue may be asleep in wait()
+    if(waiting.load(std::memory_order_seq_cst) > 0) finished.notify_all();
+}
+
+void ThreadPool::notifyWaiters(){
+    // pairs with the waiter's increment: either it sees the finished task or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(waiting.load(std::memory_order_relaxed) == 0) return;
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    finished.notify_all();
+}
+
+bool ThreadPool::hasTask(int self){
+    std::lock_guard<std::mutex> lock(queues[self]->mutex);
+    return queues[self]->count > 0;
+}
+
+void ThreadPool::submit(void (*fn)(void*), void* ctx, int home){
+    if(workers.empty()){ fn(ctx); return; }
+    push(home >= 0 ? home : currentQueue(), Task{nullptr, fn, ctx}, 1);
+}
+
+void ThreadPool::wait(const std::atomic<int>& pending){
+    const int self = currentQueue();
+    const bool stealing = t_worker >= 0;
+    while(pending.load(std::memory_order_acquire) > 0){
+        if(runOne(self, stealing)) continue;
+        // nothing to run: sleep until a task finishes or one is queued that we may run
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        waiting.fetch_add(1, std::memory_order_seq_cst);
+        finished.wait(lock, [&]{
+            return pending.load(std::memory_order_seq_cst) <= 0 || (stealing ? queued.load(std::memory_order_seq_cst) > 0 : hasTask(self));
+        });
+        waiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+bool ThreadPool::steal(int self, Task& out){
+    const int n = (int)queues.size();
+    for(int k=1;k<n;++k){
+        Queue* q = queues[(self + k) % n];
+        std::lock_guard<std::mutex> lock(q->mutex);
+        if(q->popFront(out)) return true;
+    }
+    return false;
+}
+
+bool ThreadPool::runOne(int self, bool stealing){
+    Task t{nullptr, nullptr, nullptr};
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(queues[self]->mutex);
+        found = queues[self]->popBack(t);
+    }
+    if(!found && (!stealing || !steal(self, t))) return false;
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    if(!t.job) t.fn(t.ctx);
+    else {
+        work(*t.job);
+        t.job->helpers.fetch_sub(1, std::memory_order_release);
+    }
+    notifyWaiters();
+    return true;
+}
+
+void ThreadPool::workerLoop(int index, bool pin){
+    t_worker = index;
+    // core 0 is left to the main thread
+    if(pin) pinToCore((index + 1) % (int)std::max(1u, std::thread::hardware_concurrency()));
+    for(;;){
+        if(runOne(index, true)) continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [&]{ return quit || queued.load(std::memory_order_acquire) > 0; });
+        if(quit) return;
+    }
+}
@@ -0,0 +1,134 @@
+//thread_pool.h
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+// One process-wide work-stealing scheduler shared by loading, training and the
+// scene passes instead of per-subsystem std::thread spawning. Each worker owns a
+// deque (LIFO for itself, FIFO for thieves); threads outside the pool (the
+// render loop, the dataset loader) each get an injection queue of their own
+// (EXTERNAL_QUEUES at once; further threads wait for one to be released). A
+// parallel_for publishes one job with an atomic chunk counter plus up to
+// size()-1 helper tasks, and the caller works on the chunks too. While waiting
+// for helpers a worker runs other queued tasks, so nested parallel_for calls
+// reuse the same fixed set of threads and never oversubscribe or deadlock. A
+// thread outside the pool only runs tasks from its own queue while it waits
+// (its own helpers and task graphs), so a background load's chunks never end up
+// running inside a frame. With nothing it may run, a waiting thread sleeps
+// until a task finishes or one is queued for it.
+//
+// Size defaults to std::thread::hardware_concurrency(); ML_VIS_THREADS and
+// ML_VIS_PIN_THREADS=1 in the environment (or configure() before first use)
+// override the thread count and pin worker i to core i+1 (core 0 stays with
+// the main thread).
+
+class ThreadPool{
+public:
+    static ThreadPool& instance();
+    // takes effect only before the first instance() call; threads <= 0 = hardware concurrency
+    static void configure(int threads, bool pinThreads);
+
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // threads taking part in a parallel_for (workers + the calling thread)
+    int size() const { return (int)workers.size() + 1; }
+
+    // fn(begin, end) over [0,n) in chunks of at least `grain`; returns when all chunks ran
+    template<typename Fn>
+    void parallel_for(size_t n, size_t grain, Fn&& fn){
+        if(n == 0) return;
+        size_t chunk = chunkSize(n, grain);
+        size_t chunks = (n + chunk - 1) / chunk;
+        if(chunks <= 1){ fn((size_t)0, n); return; }
+        auto body = [&](size_t c){ size_t b = c * chunk; fn(b, std::min(n, b + chunk)); };
+        run(chunks, [](void* ctx, size_t c){ (*static_cast<decltype(body)*>(ctx))(c); }, &body);
+    }
+
+    // map(begin, end) -> T per chunk, folded with combine in chunk order (deterministic
+    // for a given size()); T must be default-constructible
+    template<typename T, typename Map, typename Combine>
+    T parallel_reduce(size_t n, size_t grain, T init, Map&& map, Combine&& combine){
+        if(n == 0) return init;
+        size_t chunk = chunkSize(n, grain);
+        size_t chunks = (n + chunk - 1) / chunk;
+        if(chunks <= 1) return combine(init, map((size_t)0, n));
+        // partials live on the stack for the usual chunk counts, so a reduce per frame doesn't allocate
+        T inlinePartial[INLINE_PARTIALS];
+        std::vector<T> heapPartial(chunks > INLINE_PARTIALS ? chunks : 0);
+        T* partial = chunks > INLINE_PARTIALS ? heapPartial.data() : inlinePartial;
+        auto body = [&](size_t c){ size_t b = c * chunk; partial[c] = map(b, std::min(n, b + chunk)); };
+        run(chunks, [](void* ctx, size_t c){ (*static_cast<decltype(body)*>(ctx))(c); }, &body);
+        T result = init;
+        for(size_t c=0;c<chunks;++c) result = combine(result, partial[c]);
+        return result;
+    }
+
+    // run fn(ctx) asynchronously on a worker; without workers it runs inline.
+    // Completion is tracked by the caller, e.g. with a counter passed to wait().
+    // The task goes to queue home (see currentQueue(); default the caller's), so
+    // the thread waiting for it can pick it up too.
+    void submit(void (*fn)(void*), void* ctx, int home = -1);
+    // run queued tasks on the calling thread until pending drops to 0, sleeping
+    // while there are none it may run
+    void wait(const std::atomic<int>& pending);
+    // the calling thread's queue
+    int currentQueue() const;
+
+private:
+    struct Job{
+        void (*body)(void*, size_t);
+        void* ctx;
+        size_t chunks;
+        std::atomic<size_t> next{0};
+        std::atomic<int> helpers{0};
+    };
+    // a helper for a parallel_for job, or a submitted fn(ctx)
+    struct Task{
+        Job* job;
+        void (*fn)(void*);
+        void* ctx;
+    };
+    // growable ring: steady-state pushes and pops never allocate (std::deque frees and
+    // reallocates its blocks as tasks pass through)
+    struct Queue{
+        std::mutex mutex;
+        std::vector<Task> ring;
+        size_t head = 0, count = 0;
+        void pushBack(Task t);
+        bool popBack(Task& t);
+        bool popFront(Task& t);
+    };
+    static const size_t INLINE_PARTIALS = 64;
+    // injection queues after the workers' ones; more live threads outside the
+    // pool block on their first use until one of them exits
+    static const int EXTERNAL_QUEUES = 8;
+
+    explicit ThreadPool(int threads, bool pinThreads);
+
+    size_t chunkSize(size_t n, size_t grain) const;
+    void run(size_t chunks, void (*body)(void*, size_t), void* ctx);
+    static void work(Job& job);
+    bool runOne(int self, bool stealing);
+    void push(int self, Task t, int count);
+    void notifyWaiters();
+    bool hasTask(int self);
+    bool steal(int self, Task& out);
+    void workerLoop(int index, bool pin);
+
+    std::vector<std::thread> workers;
+    std::vector<Queue*> queues;       // one per worker + EXTERNAL_QUEUES injection queues
+    std::atomic<int> queued{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;       // idle workers: a task was queued
+    std::condition_variable finished;   // threads in wait(): a task finished or was queued
+    std::atomic<int> waiting{0};
+    bool quit = false;
+};
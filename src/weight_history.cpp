@@ -0,0 +1,90 @@
+//weight_history.cpp
+
+#include "weight_history.h"
+#include <algorithm>
+#include <cstring>
+
+WeightHistory::WeightHistory(size_t budgetBytes, int numTiers_)
+    : budget(budgetBytes), numTiers(std::max(numTiers_, 1)){}
+
+void WeightHistory::reset(int weightCount){
+    weights = weightCount;
+    recordSize = 1 + (size_t)weightCount;
+    // even capacity so a full last tier halves exactly
+    capacity = std::max<size_t>(budget / (numTiers * recordSize * sizeof(float)), 2) & ~(size_t)1;
+    tiers.assign(numTiers, Tier());
+    for(int t=0;t<numTiers;++t){
+        tiers[t].stride = 1 << t;
+        tiers[t].data.assign(capacity * recordSize, 0.0f);
+    }
+    newestEpoch = -1;
+}
+
+void WeightHistory::clear(){
+    tiers.clear();
+    weights = 0;
+    newestEpoch = -1;
+}
+
+void WeightHistory::push(int epoch, float loss, const float* W, int weightCount){
+    if(weightCount != weights || tiers.empty() || newestEpoch < 0 || epoch != newestEpoch + 1) reset(weightCount);
+    newestEpoch = epoch;
+
+    for(int t=0;t<numTiers;++t){
+        Tier &T = tiers[t];
+        if(epoch % T.stride != 0) continue;
+        if(T.count == capacity){
+            if(t + 1 < numTiers){
+                // ring: overwrite the oldest entry
+                T.head = (T.head + 1) % capacity;
+                T.first += T.stride;
+                --T.count;
+            } else {
+                // last tier: keep entries on the doubled stride, then retry this epoch;
+                // unrolling the ring first lets the compaction run in place
+                std::rotate(T.data.begin(), T.data.begin() + T.head * recordSize, T.data.end());
+                T.head = 0;
+                size_t n = 0;
+                int newFirst = -1;
+                for(size_t i=0;i<T.count;++i){
+                    int e = T.first + (int)i * T.stride;
+                    if(e % (T.stride * 2) != 0) continue;
+                    if(newFirst < 0) newFirst = e;
+                    if(n != i) std::memcpy(record(T, n), record(T, i), recordSize * sizeof(float));
+                    ++n;
+                }
+                T.count = n;
+                T.first = newFirst;
+                T.stride *= 2;
+                if(epoch % T.stride != 0) continue;
+            }
+        }
+        if(T.count == 0) T.first = epoch;
+        float* r = record(T, T.count++);
+        r[0] = loss;
+        std::memcpy(r + 1, W, weights * sizeof(float));
+    }
+}
+
+int WeightHistory::oldest() const{
+    if(empty()) return -1;
+    // the coarsest non-empty tier reaches back furthest
+    for(int t=numTiers-1;t>=0;--t) if(tiers[t].count) return tiers[t].first;
+    return newestEpoch;
+}
+
+int WeightHistory::lookup(int epoch, float* W, float* loss) const{
+    if(empty()) return -1;
+    epoch = std::max(oldest(), std::min(epoch, newestEpoch));
+    // finest tier whose range covers the epoch
+    for(int t=0;t<numTiers;++t){
+        const Tier &T = tiers[t];
+        if(T.count == 0 || epoch < T.first) continue;
+        size_t i = std::min((size_t)((epoch - T.first) / T.stride), T.count - 1);
+        const float* r = record(T, i);
+        if(loss) *loss = r[0];
+        std::memcpy(W, r + 1, weights * sizeof(float));
+        return T.first + (int)i * T.stride;
+    }
+    return -1;
+}
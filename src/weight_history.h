@@ -0,0 +1,48 @@
+//weight_history.h
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// Append-only record of the model after every epoch (loss + flattened W) within a
+// fixed memory budget. Tier t keeps every 2^t-th epoch in a ring of equal size, so
+// recent epochs are at full resolution and older ones progressively sparser; the
+// last tier drops every other entry and doubles its stride when full, so the
+// whole run stays reachable. Epochs are implicit (tier stride * slot), a record is
+// just 1 + weightCount floats, and lookup is arithmetic over a fixed tier count.
+class WeightHistory{
+public:
+    explicit WeightHistory(size_t budgetBytes = 1 << 20, int tiers = 8);
+
+    // epochs must arrive consecutively; anything else (e.g. a loaded model) restarts the history
+    void push(int epoch, float loss, const float* W, int weightCount);
+    void clear();
+    bool empty() const { return newestEpoch < 0; }
+    int oldest() const;                  // first epoch still retrievable
+    int newest() const { return newestEpoch; }
+
+    // nearest stored epoch <= `epoch` (clamped to the stored range); returns that
+    // epoch or -1 when empty. W receives weightCount() floats.
+    int lookup(int epoch, float* W, float* loss = nullptr) const;
+    int weightCount() const { return weights; }
+    size_t capacityPerTier() const { return capacity; }
+
+private:
+    struct Tier{
+        int stride = 1;                  // epochs between entries
+        int first = 0;                   // epoch of the oldest entry
+        size_t head = 0, count = 0;
+        std::vector<float> data;         // capacity * recordSize floats
+    };
+
+    size_t budget;
+    int numTiers;
+    int weights = 0;
+    size_t recordSize = 0, capacity = 0;
+    int newestEpoch = -1;
+    std::vector<Tier> tiers;
+
+    void reset(int weightCount);
+    float* record(Tier& t, size_t i) { return &t.data[((t.head + i) % capacity) * recordSize]; }
+    const float* record(const Tier& t, size_t i) const { return &t.data[((t.head + i) % capacity) * recordSize]; }
+};
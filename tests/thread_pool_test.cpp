@@ -0,0 +1,91 @@
+//thread_pool_test.cpp
+// Scheduling guarantees of the shared ThreadPool that the frame loop relies on.
+// Plain executable for ctest: prints the failed checks and exits with 1.
+
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what){
+    if(!ok){ printf("FAILED: %s\n", what); ++failures; }
+}
+
+// Two threads shaped like dataset loads (parallel_for over chunks of about 10 ms,
+// again and again, so their helpers queue up behind busy workers) while this
+// thread keeps running short parallel_for passes like the scene update. A
+// waiting frame only runs its own tasks: none of the loads' chunks may run here.
+static void testFrameSkipsLoaderChunks(){
+    ThreadPool &pool = ThreadPool::instance();
+    const std::thread::id frame = std::this_thread::get_id();
+    std::atomic<bool> stop{false};
+    std::atomic<int> foreign{0};
+    std::thread loads[2];
+    for(auto &t : loads) t = std::thread([&]{
+        while(!stop){
+            pool.parallel_for((size_t)pool.size() * 4, 1, [&](size_t b, size_t e){
+                for(size_t k=b;k<e;++k){
+                    if(std::this_thread::get_id() == frame) ++foreign;
+                    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+                    while(!stop && std::chrono::steady_clock::now() < until) {}
+                }
+            });
+        }
+    });
+
+    std::atomic<size_t> done{0};
+    size_t expected = 0;
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while(std::chrono::steady_clock::now() < until){
+        pool.parallel_for(4096, 64, [&](size_t b, size_t e){ done += e - b; });
+        expected += 4096;
+    }
+    stop = true;
+    for(auto &t : loads) t.join();
+
+    check(done == expected, "frame passes ran every chunk");
+    if(foreign > 0) printf("the frame thread ran %d background load chunks\n", foreign.load());
+    check(foreign == 0, "frame thread ran no background load chunks");
+}
+
+// More threads outside the pool than it has injection queues, all running
+// parallel_for passes at once: the extra ones wait for a queue instead of
+// sharing one, so no thread's wait() runs another outside thread's chunks.
+static void testExternalThreadsNeverShareQueues(){
+    ThreadPool &pool = ThreadPool::instance();
+    const int threads = 12;     // above the pool's 8 injection queues
+    std::thread::id ids[threads];
+    std::atomic<int> ready{0}, foreign{0};
+    std::atomic<size_t> done{0};
+    std::thread outside[threads];
+    for(int i=0;i<threads;++i) outside[i] = std::thread([&, i]{
+        ids[i] = std::this_thread::get_id();
+        ++ready;
+        while(ready < threads) std::this_thread::yield();
+        for(int pass=0;pass<20;++pass){
+            pool.parallel_for(64, 1, [&](size_t b, size_t e){
+                std::thread::id self = std::this_thread::get_id();
+                for(int j=0;j<threads;++j) if(j != i && ids[j] == self) ++foreign;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                done += e - b;
+            });
+        }
+    });
+    for(auto &t : outside) t.join();
+
+    check(done == (size_t)threads * 20 * 64, "outside threads ran every chunk");
+    if(foreign > 0) printf("outside threads ran %d chunks of other outside threads\n", foreign.load());
+    check(foreign == 0, "outside threads ran only their own chunks");
+}
+
+int main(){
+    // more workers than loads, as on the machines the app runs on
+    ThreadPool::configure(4, false);
+    testFrameSkipsLoaderChunks();
+    testExternalThreadsNeverShareQueues();
+    if(failures == 0) printf("thread_pool_test: all checks passed\n");
+    return failures ? 1 : 0;
+}